@@ -30,3 +30,18 @@ function(generate_json_header HEADER_PATH JSON_PATH)
     WORKING_DIRECTORY "${CMAKE_CURRENT_LIST_DIR}"
   )
 endfunction()
+
+# Like generate_json_header, but the header contains the buffers of the parsed
+# document instead of its JSON (see LOAD_STATIC_JSON_IMAGE), so that the
+# compiler does not have to parse it in constant evaluation
+function(generate_json_image_header HEADER_PATH JSON_PATH)
+  # Unlike file(WRITE), the tool does not create missing directories
+  get_filename_component(HEADER_DIR "${HEADER_PATH}" DIRECTORY)
+  add_custom_command(
+    OUTPUT "${HEADER_PATH}"
+    COMMAND "${CMAKE_COMMAND}" -E make_directory "${HEADER_DIR}"
+    COMMAND json_to_header -f "${JSON_PATH}" -o "${HEADER_PATH}"
+    DEPENDS "${JSON_PATH}" json_to_header
+    WORKING_DIRECTORY "${CMAKE_CURRENT_LIST_DIR}"
+  )
+endfunction()
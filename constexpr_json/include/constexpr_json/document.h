@@ -3,10 +3,13 @@
 
 #include "constexpr_json/document_info.h"
 #include "constexpr_json/impl/document_access.h"
+#include "constexpr_json/impl/hashing.h"
 
+#include <algorithm>
 #include <array>
 #include <functional>
 #include <string_view>
+#include <vector>
 namespace cjson {
 struct DocumentInterface {
   using EntityRef = impl::EntityRefImpl<DocumentInterface>;
@@ -26,17 +29,161 @@ struct DocumentInterface {
   virtual const Entity *
   getProperty(const intptr_t theObjIdx,
               const std::string_view theKey) const noexcept = 0;
+  virtual const uint64_t *
+  findStructuralHash(const Entity &) const noexcept {
+    return nullptr;
+  }
   /// @}
 
   virtual EntityRef getRoot() const noexcept = 0;
-  bool operator==(const DocumentInterface &theOther) const noexcept {
+  bool operator==(const DocumentInterface &theOther) const {
     return getRoot() == theOther.getRoot();
   }
 };
 
-template <typename Storage> struct DocumentBase {
+namespace impl {
+/// The JSON input that a borrowing document (see Storage::IS_BORROWING)
+/// references its unescaped strings in
+template <typename Storage, bool = Storage::IS_BORROWING>
+struct DocumentSource {};
+template <typename Storage> struct DocumentSource<Storage, true> {
+  typename Storage::Source itsSource{};
+};
+
+/// Hash tables over the keys of large objects of documents with
+/// Storage::HAS_PROPERTY_INDEX (see DocumentBase::buildPropertyIndex)
+template <typename Storage, bool = Storage::HAS_PROPERTY_INDEX>
+struct DocumentPropertyIndex {};
+template <typename Storage> struct DocumentPropertyIndex<Storage, true> {
+  /// One open addressing table per indexed object. The first slot holds the
+  /// number of remaining slots minus one, the others hold 1 + the index of a
+  /// property or 0 if empty.
+  typename Storage::template Buffer<intptr_t, Storage::MAX_OBJECT_PROPS()>
+      itsPropertyIndex;
+  /// Position of the table of each object in itsPropertyIndex or -1 if the
+  /// object is not indexed. Empty if no object is indexed.
+  typename Storage::template Buffer<intptr_t, Storage::MAX_OBJECTS()>
+      itsPropertyIndexPos;
+};
+
+/// The cached hashes of the arrays and objects of documents with
+/// Storage::CACHES_HASHES (see DocumentBase::buildStructuralHashes)
+template <typename Storage, bool = Storage::CACHES_HASHES>
+struct DocumentHashCache {};
+template <typename Storage> struct DocumentHashCache<Storage, true> {
+  /// Hash of each array and object, or empty if they are not cached
+  /// @{
+  typename Storage::template Buffer<uint64_t, Storage::MAX_ARRAYS()>
+      itsArrayHashes;
+  typename Storage::template Buffer<uint64_t, Storage::MAX_OBJECTS()>
+      itsObjectHashes;
+  /// @}
+};
+
+/// The properties of every object of documents with Storage::SORTS_KEYS,
+/// ordered by key (see DocumentBase::sortKeys)
+template <typename Storage, bool = Storage::SORTS_KEYS>
+struct DocumentKeyOrder {};
+template <typename Storage> struct DocumentKeyOrder<Storage, true> {
+  /// Index of each property within its object, in the same slots as
+  /// itsObjectProps. The properties with equal keys are ordered by index.
+  typename Storage::template Buffer<typename Storage::Indices::Size,
+                                    Storage::MAX_OBJECT_PROPS()>
+      itsKeyOrder{};
+};
+
+/// String with escape sequences of a document with Storage::DECODES_LAZILY
+struct EscapedString {
+  /// Offset of the unquoted string literal in the source
+  intptr_t itsSourcePos;
+  size_t itsSourceSize;
+  /// Offset of the decoded string in itsDecodedChars, where itsSourceSize
+  /// chars are set aside for it, since decoding never makes it longer
+  intptr_t itsDecodedPos;
+  /// Size of the decoded string or -1 if it has not been read yet
+  intptr_t itsDecodedSize;
+};
+
+/// Numbers and strings with escape sequences of documents with
+/// Storage::DECODES_LAZILY, which are only located and validated while
+/// parsing and decoded when they are first read. String entities with a
+/// negative payload reference itsEscapedStrings by its bitwise complement.
+///
+/// Reading values fills in the caches, so documents of such storage must not
+/// be read by several threads at once.
+template <typename Storage, bool = Storage::DECODES_LAZILY>
+struct DocumentLazyValues {};
+template <typename Storage> struct DocumentLazyValues<Storage, true> {
+  template <typename T, size_t N>
+  using Buffer = typename Storage::template Buffer<T, N>;
+  using Encoding = typename Storage::Encoding;
+
+  /// Offset of every number in the source
+  Buffer<intptr_t, Storage::MAX_NUMBERS()> itsNumberPositions;
+  /// Values of the numbers, NaN (which JSON cannot express) until read
+  mutable Buffer<double, Storage::MAX_NUMBERS()> itsDecodedNumbers;
+  mutable Buffer<EscapedString, Storage::MAX_STRINGS()> itsEscapedStrings;
+  mutable Buffer<char, Storage::MAX_CHARS()> itsDecodedChars;
+
+  double getLazyNumber(const std::string_view theSource,
+                       const intptr_t theIdx) const {
+    double &aNumber = itsDecodedNumbers[theIdx];
+    if (aNumber != aNumber)
+      aNumber = parsing<Encoding>{}
+                    .parseNumber(theSource.substr(itsNumberPositions[theIdx]))
+                    .first;
+    return aNumber;
+  }
+
+  std::string_view getEscapedString(const std::string_view theSource,
+                                    const intptr_t theIdx) const {
+    EscapedString &aStr = itsEscapedStrings[theIdx];
+    char *const aDest = itsDecodedChars.data() + aStr.itsDecodedPos;
+    if (aStr.itsDecodedSize < 0) {
+      using P = parsing<Encoding>;
+      const P p{};
+      std::string_view aRemaining =
+          theSource.substr(aStr.itsSourcePos, aStr.itsSourceSize);
+      intptr_t aSize = 0;
+      while (!aRemaining.empty()) {
+        if (const size_t aNumPlain = P::countPlainStringBytes(aRemaining)) {
+          std::copy(aRemaining.begin(), aRemaining.begin() + aNumPlain,
+                    aDest + aSize);
+          aSize += aNumPlain;
+          aRemaining.remove_prefix(aNumPlain);
+          continue;
+        }
+        // The string has been validated while parsing
+        const auto [aChar, aCharWidth] = p.parseFirstStringChar(aRemaining);
+        const auto [aBytes, aBytesUsed] = Encoding{}.encode(aChar);
+        std::copy(aBytes.begin(), aBytes.begin() + aBytesUsed, aDest + aSize);
+        aSize += aBytesUsed;
+        aRemaining.remove_prefix(aCharWidth);
+      }
+      aStr.itsDecodedSize = aSize;
+    }
+    return {aDest, static_cast<size_t>(aStr.itsDecodedSize)};
+  }
+};
+} // namespace impl
+
+template <typename Storage>
+struct DocumentBase : impl::DocumentSource<Storage>,
+                      impl::DocumentPropertyIndex<Storage>,
+                      impl::DocumentHashCache<Storage>,
+                      impl::DocumentKeyOrder<Storage>,
+                      impl::DocumentLazyValues<Storage> {
+  /// Default minimum number of properties of objects to be indexed by
+  /// buildPropertyIndex
+  static constexpr size_t PROPERTY_INDEX_THRESHOLD = 16;
+
   template <typename T, size_t N>
   using Buffer = typename Storage::template Buffer<T, N>;
+  using Indices = typename Storage::Indices;
+  using Array = BasicArray<Indices>;
+  using Object = BasicObject<Indices>;
+  using Property = BasicProperty<Indices>;
+  using String = BasicString<Indices>;
 
   Buffer<double, Storage::MAX_NUMBERS()> itsNumbers;
   Buffer<char, Storage::MAX_CHARS()> itsChars;
@@ -51,7 +198,7 @@ template <typename Storage> struct DocumentBase {
                                                   Storage::MAX_NUMBERS()>(
             theDocInfo.itsNumNumbers)},
         itsChars{Storage::template createBuffer<char, Storage::MAX_CHARS()>(
-            theDocInfo.itsNumChars)},
+            Storage::IS_BORROWING ? 0 : theDocInfo.itsNumChars)},
         itsEntities{
             Storage::template createBuffer<Entity, Storage::MAX_ENTITIES()>(
                 theDocInfo.itsNumObjectProperties +
@@ -70,10 +217,22 @@ template <typename Storage> struct DocumentBase {
                 theDocInfo.itsNumStrings)} {}
 
   constexpr double getNumber(intptr_t theIdx) const {
-    return itsNumbers[theIdx];
+    if constexpr (Storage::DECODES_LAZILY)
+      return this->getLazyNumber(this->itsSource, theIdx);
+    else
+      return itsNumbers[theIdx];
   }
   constexpr std::string_view getString(intptr_t theIdx) const {
+    if constexpr (Storage::DECODES_LAZILY) {
+      if (theIdx < 0)
+        return this->getEscapedString(this->itsSource, ~theIdx);
+    }
     const String &aStr = itsStrings[theIdx];
+    if constexpr (Storage::IS_BORROWING) {
+      if (aStr.itsPosition < 0)
+        return std::string_view{this->itsSource.data() + ~aStr.itsPosition,
+                                aStr.itsSize};
+    }
     return std::string_view{itsChars.data() + aStr.itsPosition, aStr.itsSize};
   }
   constexpr const Entity *array_begin(intptr_t theIdx) const {
@@ -96,11 +255,53 @@ template <typename Storage> struct DocumentBase {
     const Entity &aValue = itsEntities[aObject.itsValuesPos + thePropIdx];
     return std::make_pair(aKey, &aValue);
   }
+  /// @return the key of property thePropIdx of theObject
+  constexpr std::string_view getKey(const Object &theObject,
+                                    const intptr_t thePropIdx) const {
+    return getString(
+        itsObjectProps[theObject.itsKeysPos + thePropIdx].itsKeyPos);
+  }
   constexpr const Entity *
   getProperty(const intptr_t theObjIdx,
               const std::string_view theKey) const noexcept {
-    // perform linear search
     const Object &aObject = itsObjects[theObjIdx];
+    if constexpr (Storage::HAS_PROPERTY_INDEX) {
+      if (!this->itsPropertyIndexPos.empty() &&
+          this->itsPropertyIndexPos[theObjIdx] >= 0) {
+        const intptr_t *const aTable =
+            &this->itsPropertyIndex[this->itsPropertyIndexPos[theObjIdx]];
+        const auto aMask = static_cast<uint64_t>(aTable[0]);
+        for (uint64_t aSlot = impl::hashString(theKey) & aMask;;
+             aSlot = (aSlot + 1) & aMask) {
+          const intptr_t aPropIdx = aTable[1 + aSlot] - 1;
+          if (aPropIdx < 0)
+            return nullptr;
+          if (getString(itsObjectProps[aObject.itsKeysPos + aPropIdx]
+                            .itsKeyPos) == theKey)
+            return &itsEntities[aObject.itsValuesPos + aPropIdx];
+        }
+      }
+    }
+    if constexpr (Storage::SORTS_KEYS) {
+      // Find the first property whose key is not less than theKey
+      size_t aBegin = 0;
+      size_t aEnd = aObject.itsNumProperties;
+      while (aBegin < aEnd) {
+        const size_t aMid = aBegin + (aEnd - aBegin) / 2;
+        if (getKey(aObject, this->itsKeyOrder[aObject.itsKeysPos + aMid]) <
+            theKey)
+          aBegin = aMid + 1;
+        else
+          aEnd = aMid;
+      }
+      if (aBegin == aObject.itsNumProperties)
+        return nullptr;
+      const intptr_t aPropIdx = this->itsKeyOrder[aObject.itsKeysPos + aBegin];
+      if (getKey(aObject, aPropIdx) != theKey)
+        return nullptr;
+      return &itsEntities[aObject.itsValuesPos + aPropIdx];
+    }
+    // perform linear search
     for (intptr_t aPropIdx = 0;
          static_cast<size_t>(aPropIdx) < aObject.itsNumProperties; ++aPropIdx) {
       const auto aProp = itsObjectProps[aObject.itsKeysPos + aPropIdx];
@@ -110,9 +311,138 @@ template <typename Storage> struct DocumentBase {
     return nullptr;
   }
 
+  /// Orders the properties of every object by key in itsKeyOrder, so that
+  /// getProperty can look them up with a binary search. The parsers call this
+  /// for documents with Storage::SORTS_KEYS once they are complete.
+  constexpr void sortKeys() {
+    for (size_t aObjIdx = 0; aObjIdx < itsObjects.size(); ++aObjIdx)
+      sortKeys(aObjIdx);
+  }
+  /// Orders the properties of object theObjIdx only, e.g. when it has just
+  /// been filled in by a DocumentAllocator
+  constexpr void sortKeys(const size_t theObjIdx) {
+    static_assert(Storage::SORTS_KEYS, "Documents without key order");
+    using Size = typename Indices::Size;
+    const Object &aObject = itsObjects[theObjIdx];
+    Size *const aOrder = this->itsKeyOrder.data() + aObject.itsKeysPos;
+    const size_t aSize = aObject.itsNumProperties;
+    const auto aLess = [&](const Size theLhs, const Size theRhs) {
+      const std::string_view aLhsKey = getKey(aObject, theLhs);
+      const std::string_view aRhsKey = getKey(aObject, theRhs);
+      return aLhsKey < aRhsKey || (aLhsKey == aRhsKey && theLhs < theRhs);
+    };
+    // Heapsort, since std::sort cannot be used in constant expressions
+    const auto aSiftDown = [&](size_t theRoot, const size_t theEnd) {
+      for (size_t aChild = 2 * theRoot + 1; aChild < theEnd;
+           theRoot = aChild, aChild = 2 * theRoot + 1) {
+        if (aChild + 1 < theEnd && aLess(aOrder[aChild], aOrder[aChild + 1]))
+          ++aChild;
+        if (!aLess(aOrder[theRoot], aOrder[aChild]))
+          break;
+        const Size aTmp = aOrder[theRoot];
+        aOrder[theRoot] = aOrder[aChild];
+        aOrder[aChild] = aTmp;
+      }
+    };
+    for (size_t aPropIdx = 0; aPropIdx < aSize; ++aPropIdx)
+      aOrder[aPropIdx] = static_cast<Size>(aPropIdx);
+    for (size_t aRoot = aSize / 2; aRoot-- > 0;)
+      aSiftDown(aRoot, aSize);
+    for (size_t aEnd = aSize; aEnd > 1; --aEnd) {
+      const Size aTmp = aOrder[0];
+      aOrder[0] = aOrder[aEnd - 1];
+      aOrder[aEnd - 1] = aTmp;
+      aSiftDown(0, aEnd - 1);
+    }
+  }
+
   constexpr const Entity &getRootEntity() const noexcept {
     return itsEntities[0];
   }
+
+  /// @return the cached hash of theEntity if it is an array or object and
+  /// buildStructuralHashes has been called, null otherwise
+  constexpr const uint64_t *
+  findStructuralHash(const Entity &theEntity) const noexcept {
+    if constexpr (Storage::CACHES_HASHES) {
+      if (theEntity.itsKind == Entity::ARRAY && !this->itsArrayHashes.empty())
+        return &this->itsArrayHashes[theEntity.itsPayload];
+      if (theEntity.itsKind == Entity::OBJECT &&
+          !this->itsObjectHashes.empty())
+        return &this->itsObjectHashes[theEntity.itsPayload];
+    }
+    return nullptr;
+  }
+
+  /// Caches the hash (see EntityRefImpl::hash) of every array and object, so
+  /// that hashing any value takes constant time and comparing arrays or
+  /// objects with other ones with cached hashes mostly does, too, if they
+  /// differ. Hashes cached before are discarded, so this has to be called
+  /// again whenever the document has been modified.
+  void buildStructuralHashes() {
+    static_assert(Storage::IS_GROWABLE && Storage::CACHES_HASHES,
+                  "Only growable documents can cache hashes");
+    this->itsArrayHashes.clear();
+    this->itsObjectHashes.clear();
+    auto aArrayHashes =
+        Storage::template createBuffer<uint64_t, Storage::MAX_ARRAYS()>(
+            itsArrays.size());
+    auto aObjectHashes =
+        Storage::template createBuffer<uint64_t, Storage::MAX_OBJECTS()>(
+            itsObjects.size());
+    const auto aStore = [&](const Entity &theEntity, const uint64_t theHash) {
+      if (theEntity.itsKind == Entity::ARRAY)
+        aArrayHashes[theEntity.itsPayload] = theHash;
+      else
+        aObjectHashes[theEntity.itsPayload] = theHash;
+    };
+    impl::hashEntity(*this, getRootEntity(), aStore);
+    this->itsArrayHashes = std::move(aArrayHashes);
+    this->itsObjectHashes = std::move(aObjectHashes);
+  }
+
+  /// Builds hash tables over the keys of all objects with at least
+  /// theMinProperties properties, so that looking up a key in them does not
+  /// need to compare it to every key of the object. Tables built before are
+  /// discarded, so this has to be called again whenever the document has
+  /// been modified.
+  ///
+  /// DynamicDocument::parseJson calls this with PROPERTY_INDEX_THRESHOLD.
+  void buildPropertyIndex(
+      const size_t theMinProperties = PROPERTY_INDEX_THRESHOLD) {
+    static_assert(Storage::IS_GROWABLE && Storage::HAS_PROPERTY_INDEX,
+                  "Only growable documents can build a property index");
+    this->itsPropertyIndex.clear();
+    this->itsPropertyIndexPos.clear();
+    for (size_t aObjIdx = 0; aObjIdx < itsObjects.size(); ++aObjIdx) {
+      const Object &aObject = itsObjects[aObjIdx];
+      if (aObject.itsNumProperties < theMinProperties ||
+          !aObject.itsNumProperties)
+        continue;
+      if (this->itsPropertyIndexPos.empty())
+        this->itsPropertyIndexPos.assign(itsObjects.size(), -1);
+      // Keep the load factor at or below 1/2 to have short probe sequences
+      size_t aNumSlots = 1;
+      while (aNumSlots < 2 * aObject.itsNumProperties)
+        aNumSlots *= 2;
+      const size_t aTablePos = this->itsPropertyIndex.size();
+      this->itsPropertyIndexPos[aObjIdx] = static_cast<intptr_t>(aTablePos);
+      this->itsPropertyIndex.resize(aTablePos + 1 + aNumSlots, 0);
+      intptr_t *const aTable = &this->itsPropertyIndex[aTablePos];
+      aTable[0] = static_cast<intptr_t>(aNumSlots - 1);
+      // Inserting in order makes duplicate keys resolve to the first one, just
+      // like the linear search does
+      for (size_t aPropIdx = 0; aPropIdx < aObject.itsNumProperties;
+           ++aPropIdx) {
+        const std::string_view aKey =
+            getString(itsObjectProps[aObject.itsKeysPos + aPropIdx].itsKeyPos);
+        uint64_t aSlot = impl::hashString(aKey) & (aNumSlots - 1);
+        while (aTable[1 + aSlot])
+          aSlot = (aSlot + 1) & (aNumSlots - 1);
+        aTable[1 + aSlot] = static_cast<intptr_t>(aPropIdx + 1);
+      }
+    }
+  }
 };
 
 template <typename Base>
@@ -153,6 +483,58 @@ struct DocumentInterfaceImpl : public DocumentInterface, Base {
               const std::string_view theKey) const noexcept override {
     return Base::getProperty(theObjIdx, theKey);
   }
+  const uint64_t *
+  findStructuralHash(const Entity &theEntity) const noexcept override {
+    return Base::findStructuralHash(theEntity);
+  }
+};
+
+/// Type-erased view of a document of type DocTy, which has to outlive it.
+/// Unlike DocumentInterfaceImpl, it does not copy the document.
+template <typename DocTy>
+struct DocumentInterfaceView : public DocumentInterface {
+  using EntityRef = DocumentInterface::EntityRef;
+
+  explicit DocumentInterfaceView(const DocTy &theDoc) noexcept
+      : itsDoc{&theDoc} {}
+
+  EntityRef getRoot() const noexcept override {
+    return {*this, itsDoc->getRootEntity()};
+  }
+  double getNumber(intptr_t theIdx) const override {
+    return itsDoc->getNumber(theIdx);
+  }
+  std::string_view getString(intptr_t theIdx) const override {
+    return itsDoc->getString(theIdx);
+  }
+  const Entity *array_begin(intptr_t theIdx) const override {
+    return itsDoc->array_begin(theIdx);
+  }
+  const Entity *array_end(intptr_t theIdx) const override {
+    return itsDoc->array_end(theIdx);
+  }
+  size_t array_size(intptr_t theIdx) const override {
+    return itsDoc->array_size(theIdx);
+  }
+  size_t getNumProperties(intptr_t theObjIdx) const override {
+    return itsDoc->getNumProperties(theObjIdx);
+  }
+  std::pair<std::string_view, const Entity *>
+  getProperty(intptr_t theObjIdx, intptr_t thePropIdx) const override {
+    return itsDoc->getProperty(theObjIdx, thePropIdx);
+  }
+  const Entity *
+  getProperty(const intptr_t theObjIdx,
+              const std::string_view theKey) const noexcept override {
+    return itsDoc->getProperty(theObjIdx, theKey);
+  }
+  const uint64_t *
+  findStructuralHash(const Entity &theEntity) const noexcept override {
+    return itsDoc->findStructuralHash(theEntity);
+  }
+
+private:
+  const DocTy *itsDoc;
 };
 } // namespace cjson
 #endif // CONSTEXPR_JSON_DOCUMENT_H
@@ -2,7 +2,12 @@
 #define CONSTEXPR_JSON_DOCUMENT_INFO_H
 
 #include "constexpr_json/error_codes.h"
+#include "constexpr_json/impl/compiler_support.h"
+#include "constexpr_json/impl/nesting_stack.h"
 #include "constexpr_json/impl/parsing_utils.h"
+#include "constexpr_json/impl/structural_index.h"
+
+#include <optional>
 
 namespace cjson {
 struct DocumentInfo {
@@ -87,161 +92,43 @@ struct DocumentInfo {
 
   using ResultTy = std::pair<DocumentInfo, intptr_t>;
 
+  /// Deep documents are supported during constant evaluation up to this
+  /// nesting level (or MaxDepth, if larger).
+  static constexpr intptr_t CONSTEXPR_MAX_DEPTH = 4096;
+
   /**
+   * Documents are scanned iteratively, keeping track of the enclosing
+   * aggregates with one bit per nesting level. At runtime, the depth of
+   * documents is therefore only limited by MaxDepth and available memory.
+   *
+   * @tparam MaxDepth the maximum nesting level of values, negative for no
+   * limit
    * @return .first is the DocInfo, .second is the number of read chars (i.e.
    * bytes, not code points)
    */
   template <typename SourceEncodingTy, typename DestEncodingTy,
-            typename ErrorHandlingTy, intptr_t MaxRecursionDepth = 100>
+            typename ErrorHandlingTy, intptr_t MaxDepth = -1>
   constexpr static typename ErrorHandlingTy::template ErrorOr<ResultTy>
   compute(const std::string_view theJsonString,
           const SourceEncodingTy theSrcEnc = SourceEncodingTy{},
-          const DestEncodingTy theDestEnc = DestEncodingTy{},
-          const intptr_t theRecursionDepth = 0) {
-    // setup
-    using P = parsing<SourceEncodingTy>;
-    const P p{theSrcEnc};
-    using Type = typename P::Type;
-    std::string_view aRemaining = theJsonString;
-#define CJSON_CURRENT_POSITION theJsonString.size() - aRemaining.size()
-    aRemaining = p.removeLeadingWhitespace(aRemaining);
-
-    // limit recursion
-    if (MaxRecursionDepth >= 0 && theRecursionDepth > MaxRecursionDepth)
-      return makeError<ErrorHandlingTy>(ErrorCode::MAX_DEPTH_EXCEEDED,
-                                        CJSON_CURRENT_POSITION);
-
-    const auto aTypeOpt = p.detectElementType(aRemaining);
-    if (!aTypeOpt)
-      return makeError<ErrorHandlingTy>(ErrorCode::TYPE_DEDUCTION_FAILED,
-                                        CJSON_CURRENT_POSITION);
-    switch (*aTypeOpt) {
-    case Type::NUL:
-      if (const auto aNullLen = p.readNull(aRemaining).size(); aNullLen > 0) {
-        aRemaining.remove_prefix(aNullLen);
-        return std::make_pair(DocumentInfo::SingleNull(),
-                              CJSON_CURRENT_POSITION);
-      } else
-        return makeError<ErrorHandlingTy>(ErrorCode::NULL_READ_FAILED,
-                                          CJSON_CURRENT_POSITION);
-    case Type::BOOL:
-      if (const auto aBoolLen = p.parseBool(aRemaining).second; aBoolLen > 0) {
-        aRemaining.remove_prefix(aBoolLen);
-        return std::make_pair(DocumentInfo::SingleBool(),
-                              CJSON_CURRENT_POSITION);
-      } else
-        return makeError<ErrorHandlingTy>(ErrorCode::BOOL_READ_FAILED,
-                                          CJSON_CURRENT_POSITION);
-    case Type::NUMBER:
-      if (const auto aNumLen = p.readNumber(aRemaining).size(); aNumLen > 0) {
-        aRemaining.remove_prefix(aNumLen);
-        return std::make_pair(DocumentInfo::SingleNumber(),
-                              CJSON_CURRENT_POSITION);
-      } else
-        return makeError<ErrorHandlingTy>(ErrorCode::NUMBER_READ_FAILED,
-                                          CJSON_CURRENT_POSITION);
-    case Type::STRING: {
-      const std::string_view aStr = p.readString(aRemaining);
-      if (const auto aStrLen = aStr.size(); aStrLen > 0) {
-        aRemaining.remove_prefix(aStrLen);
-        const auto aNumChars = p.template computeEncodedSize<DestEncodingTy>(
-            p.stripQuotes(aStr), theDestEnc);
-        return std::make_pair(DocumentInfo::SingleString(aNumChars),
-                              CJSON_CURRENT_POSITION);
-      } else
-        return makeError<ErrorHandlingTy>(ErrorCode::STRING_READ_FAILED,
-                                          CJSON_CURRENT_POSITION);
-    }
-    case Type::ARRAY: {
-      DocumentInfo aResult = DocumentInfo::EmptyArray();
-      aRemaining.remove_prefix(theSrcEnc.encode('[').second);
-      for (bool aIsFirst = true;; aIsFirst = false) {
-        aRemaining = p.removeLeadingWhitespace(aRemaining);
-        const auto [aChar, aCharWidth] = theDestEnc.decodeFirst(aRemaining);
-        if (aCharWidth <= 0)
-          return makeError<ErrorHandlingTy>(ErrorCode::ARRAY_UNEXPECTED_TOKEN,
-                                            CJSON_CURRENT_POSITION);
-        if (aChar == ']') {
-          aRemaining.remove_prefix(aCharWidth);
-          return std::make_pair(aResult, CJSON_CURRENT_POSITION);
-        }
-        if (!aIsFirst && aChar != ',')
-          return makeError<ErrorHandlingTy>(ErrorCode::ARRAY_EXPECTED_COMMA,
-                                            CJSON_CURRENT_POSITION);
-        if (aChar == ',')
-          aRemaining.remove_prefix(aCharWidth);
-        const auto aSubDocOrError =
-            compute<SourceEncodingTy, DestEncodingTy, ErrorHandlingTy>(
-                aRemaining, theSrcEnc, theDestEnc, theRecursionDepth + 1);
-        if (ErrorHandlingTy::isError(aSubDocOrError))
-          return ErrorHandlingTy::template convertError<ResultTy>(
-              aSubDocOrError, CJSON_CURRENT_POSITION); // Propagate error
-        const auto [aSubDoc, aLen] = ErrorHandlingTy::unwrap(aSubDocOrError);
-        aResult += aSubDoc;
-        ++aResult.itsNumArrayEntries;
-        aRemaining.remove_prefix(aLen);
-      }
-      return makeError<ErrorHandlingTy>(ErrorCode::UNREACHABLE, -1);
-    }
-    case Type::OBJECT: {
-      DocumentInfo aResult = DocumentInfo::EmptyObject();
-      aRemaining.remove_prefix(theSrcEnc.encode('{').second);
-      for (bool aIsFirst = true;; aIsFirst = false) {
-        aRemaining = p.removeLeadingWhitespace(aRemaining);
-        { // first char introspection
-          const auto [aChar, aCharWidth] = theSrcEnc.decodeFirst(aRemaining);
-          if (aCharWidth <= 0)
-            return makeError<ErrorHandlingTy>(
-                ErrorCode::OBJECT_UNEXPECTED_TOKEN, CJSON_CURRENT_POSITION);
-          if (aChar == '}') {
-            aRemaining.remove_prefix(aCharWidth);
-            return std::make_pair(aResult, CJSON_CURRENT_POSITION);
-          }
-          if (!aIsFirst && aChar != ',')
-            return makeError<ErrorHandlingTy>(ErrorCode::OBJECT_EXPECTED_COMMA,
-                                              CJSON_CURRENT_POSITION);
-          if (aChar == ',') {
-            aRemaining.remove_prefix(aCharWidth);
-            // need to strip whitespace - readString expects to start on '"'
-            aRemaining = p.removeLeadingWhitespace(aRemaining);
-          }
-        }
-        { // consume key
-          const std::string_view aKey = p.readString(aRemaining);
-          if (aKey.size() == 0)
-            return makeError<ErrorHandlingTy>(ErrorCode::OBJECT_KEY_READ_FAILED,
-                                              CJSON_CURRENT_POSITION);
-          ++aResult.itsNumStrings;
-          aResult.itsNumChars += p.template computeEncodedSize<DestEncodingTy>(
-              p.stripQuotes(aKey), theDestEnc);
-          aRemaining.remove_prefix(aKey.size());
-        }
-        { // consume colon
-          aRemaining = p.removeLeadingWhitespace(aRemaining);
-          const auto [aColon, aColonWidth] = theSrcEnc.decodeFirst(aRemaining);
-          if (aColon != ':')
-            return makeError<ErrorHandlingTy>(ErrorCode::OBJECT_EXPECTED_COLON,
-                                              CJSON_CURRENT_POSITION);
-          aRemaining.remove_prefix(aColonWidth);
-        }
-        const auto aSubDocOrError =
-            compute<SourceEncodingTy, DestEncodingTy, ErrorHandlingTy>(
-                aRemaining, theSrcEnc, theDestEnc, theRecursionDepth + 1);
-        if (ErrorHandlingTy::isError(aSubDocOrError))
-          return ErrorHandlingTy::template convertError<ResultTy>(
-              aSubDocOrError, CJSON_CURRENT_POSITION); // Propagate error
-        const auto [aSubDoc, aLen] = ErrorHandlingTy::unwrap(aSubDocOrError);
-        aResult += aSubDoc;
-        ++aResult.itsNumObjectProperties;
-        aRemaining.remove_prefix(aLen);
+          const DestEncodingTy theDestEnc = DestEncodingTy{}) {
+    if constexpr (impl::IsAsciiCompatible<SourceEncodingTy>::value) {
+      if (!CJSON_IS_CONSTANT_EVALUATED()) {
+        if (const auto aResult = computeIndexed(theJsonString, theSrcEnc,
+                                                theDestEnc, MaxDepth))
+          return *aResult;
+        // Malformed documents are scanned again below to report the error
       }
-      return makeError<ErrorHandlingTy>(ErrorCode::UNREACHABLE,
-                                        CJSON_CURRENT_POSITION);
     }
+    if (CJSON_IS_CONSTANT_EVALUATED()) {
+      constexpr intptr_t aCapacity =
+          MaxDepth > CONSTEXPR_MAX_DEPTH ? MaxDepth : CONSTEXPR_MAX_DEPTH;
+      return computeScalar<ErrorHandlingTy,
+                           impl::FixedNestingStack<aCapacity / 64 + 1>>(
+          theJsonString, theSrcEnc, theDestEnc, MaxDepth);
     }
-    return makeError<ErrorHandlingTy>(ErrorCode::UNREACHABLE,
-                                      CJSON_CURRENT_POSITION);
-#undef CJSON_CURRENT_POSITION
+    return computeScalar<ErrorHandlingTy, impl::DynamicNestingStack>(
+        theJsonString, theSrcEnc, theDestEnc, MaxDepth);
   }
 
   template <typename JSON>
@@ -282,6 +169,222 @@ struct DocumentInfo {
   }
 
 private:
+  /// Character-based implementation of compute
+  /// @tparam StackTy one of the impl::*NestingStack types
+  template <typename ErrorHandlingTy, typename StackTy,
+            typename SourceEncodingTy, typename DestEncodingTy>
+  constexpr static typename ErrorHandlingTy::template ErrorOr<ResultTy>
+  computeScalar(const std::string_view theJsonString,
+                const SourceEncodingTy theSrcEnc,
+                const DestEncodingTy theDestEnc, const intptr_t theMaxDepth) {
+    // setup
+    using P = parsing<SourceEncodingTy>;
+    const P p{theSrcEnc};
+    using Type = typename P::Type;
+    std::string_view aRemaining = theJsonString;
+    DocumentInfo aResult;
+    StackTy aStack;
+#define CJSON_CURRENT_POSITION theJsonString.size() - aRemaining.size()
+
+    // Reads `"key" :` of the next object property
+    const auto consumeKey = [&]() -> std::optional<ErrorCode> {
+      aRemaining = p.removeLeadingWhitespace(aRemaining);
+      const std::string_view aKey = p.readString(aRemaining);
+      if (aKey.size() == 0)
+        return ErrorCode::OBJECT_KEY_READ_FAILED;
+      ++aResult.itsNumStrings;
+      ++aResult.itsNumObjectProperties;
+      aResult.itsNumChars += p.template computeEncodedSize<DestEncodingTy>(
+          p.stripQuotes(aKey), theDestEnc);
+      aRemaining.remove_prefix(aKey.size());
+      aRemaining = p.removeLeadingWhitespace(aRemaining);
+      const auto [aColon, aColonWidth] = theSrcEnc.decodeFirst(aRemaining);
+      if (aColon != ':')
+        return ErrorCode::OBJECT_EXPECTED_COLON;
+      aRemaining.remove_prefix(aColonWidth);
+      return std::nullopt;
+    };
+
+    for (;;) {
+      // Step 1: Read a value
+      aRemaining = p.removeLeadingWhitespace(aRemaining);
+      if (theMaxDepth >= 0 &&
+          static_cast<intptr_t>(aStack.size()) > theMaxDepth)
+        return makeError<ErrorHandlingTy>(ErrorCode::MAX_DEPTH_EXCEEDED,
+                                          CJSON_CURRENT_POSITION);
+      const auto aTypeOpt = p.detectElementType(aRemaining);
+      if (!aTypeOpt)
+        return makeError<ErrorHandlingTy>(ErrorCode::TYPE_DEDUCTION_FAILED,
+                                          CJSON_CURRENT_POSITION);
+      switch (*aTypeOpt) {
+      case Type::NUL:
+        if (const auto aNullLen = p.readNull(aRemaining).size(); aNullLen > 0) {
+          ++aResult.itsNumNulls;
+          aRemaining.remove_prefix(aNullLen);
+          break;
+        } else
+          return makeError<ErrorHandlingTy>(ErrorCode::NULL_READ_FAILED,
+                                            CJSON_CURRENT_POSITION);
+      case Type::BOOL:
+        if (const auto aBoolLen = p.parseBool(aRemaining).second;
+            aBoolLen > 0) {
+          ++aResult.itsNumBools;
+          aRemaining.remove_prefix(aBoolLen);
+          break;
+        } else
+          return makeError<ErrorHandlingTy>(ErrorCode::BOOL_READ_FAILED,
+                                            CJSON_CURRENT_POSITION);
+      case Type::NUMBER:
+        if (const auto aNumLen = p.readNumber(aRemaining).size();
+            aNumLen > 0) {
+          ++aResult.itsNumNumbers;
+          aRemaining.remove_prefix(aNumLen);
+          break;
+        } else
+          return makeError<ErrorHandlingTy>(ErrorCode::NUMBER_READ_FAILED,
+                                            CJSON_CURRENT_POSITION);
+      case Type::STRING: {
+        const std::string_view aStr = p.readString(aRemaining);
+        if (aStr.size() == 0)
+          return makeError<ErrorHandlingTy>(ErrorCode::STRING_READ_FAILED,
+                                            CJSON_CURRENT_POSITION);
+        ++aResult.itsNumStrings;
+        aResult.itsNumChars += p.template computeEncodedSize<DestEncodingTy>(
+            p.stripQuotes(aStr), theDestEnc);
+        aRemaining.remove_prefix(aStr.size());
+        break;
+      }
+      case Type::ARRAY:
+      case Type::OBJECT: {
+        const bool aIsObject = *aTypeOpt == Type::OBJECT;
+        if (!aStack.push(aIsObject))
+          return makeError<ErrorHandlingTy>(ErrorCode::MAX_DEPTH_EXCEEDED,
+                                            CJSON_CURRENT_POSITION);
+        ++(aIsObject ? aResult.itsNumObjects : aResult.itsNumArrays);
+        aRemaining.remove_prefix(
+            theSrcEnc.encode(aIsObject ? '{' : '[').second);
+        aRemaining = p.removeLeadingWhitespace(aRemaining);
+        const auto [aChar, aCharWidth] = theSrcEnc.decodeFirst(aRemaining);
+        if (aCharWidth <= 0)
+          return makeError<ErrorHandlingTy>(
+              aIsObject ? ErrorCode::OBJECT_UNEXPECTED_TOKEN
+                        : ErrorCode::ARRAY_UNEXPECTED_TOKEN,
+              CJSON_CURRENT_POSITION);
+        if (aChar == (aIsObject ? '}' : ']'))
+          // Empty aggregates are closed by Step 2
+          break;
+        if (!aIsObject) {
+          ++aResult.itsNumArrayEntries;
+        } else if (const auto aError = consumeKey()) {
+          return makeError<ErrorHandlingTy>(*aError, CJSON_CURRENT_POSITION);
+        }
+        continue;
+      }
+      }
+
+      // Step 2: Close finished aggregates until another value is expected
+      for (;;) {
+        if (aStack.empty())
+          return std::make_pair(aResult, CJSON_CURRENT_POSITION);
+        const bool aIsObject = aStack.top();
+        aRemaining = p.removeLeadingWhitespace(aRemaining);
+        const auto [aChar, aCharWidth] = theSrcEnc.decodeFirst(aRemaining);
+        if (aCharWidth <= 0)
+          return makeError<ErrorHandlingTy>(
+              aIsObject ? ErrorCode::OBJECT_UNEXPECTED_TOKEN
+                        : ErrorCode::ARRAY_UNEXPECTED_TOKEN,
+              CJSON_CURRENT_POSITION);
+        if (aChar == ',') {
+          aRemaining.remove_prefix(aCharWidth);
+          if (!aIsObject) {
+            ++aResult.itsNumArrayEntries;
+          } else if (const auto aError = consumeKey()) {
+            return makeError<ErrorHandlingTy>(*aError,
+                                              CJSON_CURRENT_POSITION);
+          }
+          break;
+        }
+        if (aChar != (aIsObject ? '}' : ']'))
+          return makeError<ErrorHandlingTy>(
+              aIsObject ? ErrorCode::OBJECT_EXPECTED_COMMA
+                        : ErrorCode::ARRAY_EXPECTED_COMMA,
+              CJSON_CURRENT_POSITION);
+        aRemaining.remove_prefix(aCharWidth);
+        aStack.pop();
+      }
+    }
+#undef CJSON_CURRENT_POSITION
+  }
+
+  /// Runtime implementation of compute based on a StructuralIndex
+  /// @return std::nullopt if theJsonString is malformed
+  template <typename SourceEncodingTy, typename DestEncodingTy>
+  static std::optional<ResultTy>
+  computeIndexed(const std::string_view theJsonString,
+                 const SourceEncodingTy theSrcEnc,
+                 const DestEncodingTy theDestEnc,
+                 const intptr_t theMaxDepth) {
+    using P = parsing<SourceEncodingTy>;
+    struct Counter {
+      const P p;
+      const DestEncodingTy itsDestEnc;
+      DocumentInfo itsInfo = {};
+      intptr_t itsNumValues = 0;
+
+      intptr_t onScalar(intptr_t, const std::string_view theRest) {
+        ++itsNumValues;
+        switch (theRest.front()) {
+        case 'n':
+          ++itsInfo.itsNumNulls;
+          return p.readNull(theRest).size();
+        case 't':
+        case 'f':
+          ++itsInfo.itsNumBools;
+          return p.parseBool(theRest).second;
+        default:
+          ++itsInfo.itsNumNumbers;
+          return p.readNumber(theRest).size();
+        }
+      }
+      bool onString(intptr_t, const std::string_view theQuoted) {
+        ++itsNumValues;
+        return countString(theQuoted);
+      }
+      bool onKey(intptr_t, const std::string_view theQuoted) {
+        ++itsInfo.itsNumObjectProperties;
+        return countString(theQuoted);
+      }
+      bool onOpen(intptr_t, const bool theIsObject) {
+        ++itsNumValues;
+        ++(theIsObject ? itsInfo.itsNumObjects : itsInfo.itsNumArrays);
+        return true;
+      }
+      bool onClose(bool) { return true; }
+
+      bool countString(const std::string_view theQuoted) {
+        if (p.readString(theQuoted).size() != theQuoted.size())
+          return false;
+        ++itsInfo.itsNumStrings;
+        itsInfo.itsNumChars += p.template computeEncodedSize<DestEncodingTy>(
+            p.stripQuotes(theQuoted), itsDestEnc);
+        return true;
+      }
+    };
+    impl::StructuralIndex aIndex;
+    if (!aIndex.build(theJsonString))
+      return std::nullopt;
+    Counter aCounter{P{theSrcEnc}, theDestEnc};
+    const intptr_t aEnd = impl::walkStructuralIndex(
+        theJsonString, aIndex, aCounter, theMaxDepth);
+    if (aEnd < 0)
+      return std::nullopt;
+    // Every value except for the root and object properties is an array entry
+    DocumentInfo &aInfo = aCounter.itsInfo;
+    aInfo.itsNumArrayEntries =
+        aCounter.itsNumValues - aInfo.itsNumObjectProperties - 1;
+    return std::make_pair(aInfo, aEnd);
+  }
+
   template <typename ErrorHandlingTy>
   constexpr static typename ErrorHandlingTy::template ErrorOr<ResultTy>
   makeError(const ErrorCode theCode, const intptr_t thePosition) {
@@ -3,14 +3,42 @@
 
 #include "constexpr_json/document.h"
 #include "constexpr_json/document_parser.h"
+#include "constexpr_json/impl/document_parser3.h"
+#include "constexpr_json/impl/subtree_copy.h"
 
 #include <limits>
+#include <string>
+#include <type_traits>
 
 namespace cjson {
 namespace impl {
 struct DynamicDocumentStorage {
   template <typename T, size_t N> using Buffer = std::vector<T>;
 
+  /// Buffers can be appended to while parsing (see DocumentParser3)
+  static constexpr bool IS_GROWABLE = true;
+  /// Strings are always copied into itsChars (see BorrowingDocumentStorage)
+  static constexpr bool IS_BORROWING = false;
+  /// Every key is stored separately (see InterningDocumentStorage)
+  static constexpr bool INTERNS_KEYS = false;
+  /// Numbers and short strings are stored in their Entity if possible, so
+  /// that reading them does not need to look into further buffers
+  static constexpr bool INLINES_SCALARS = true;
+  /// Large objects get hash tables over their keys after parsing (see
+  /// DocumentBase::buildPropertyIndex)
+  static constexpr bool HAS_PROPERTY_INDEX = true;
+  /// The hashes of arrays and objects can be cached to speed up comparisons
+  /// (see DocumentBase::buildStructuralHashes)
+  static constexpr bool CACHES_HASHES = true;
+  /// Keys are looked up through the property index instead (see
+  /// StaticDocumentStorage)
+  static constexpr bool SORTS_KEYS = false;
+  /// Numbers and strings are decoded while parsing (see
+  /// OnDemandDocumentStorage)
+  static constexpr bool DECODES_LAZILY = false;
+  /// Positions and sizes fit any document (see CompactDocumentStorage)
+  using Indices = WideIndices;
+
   static constexpr intptr_t MAX_NUMBERS() {
     return std::numeric_limits<intptr_t>::max();
   }
@@ -40,54 +68,279 @@ struct DynamicDocumentStorage {
     return aBuf;
   }
 };
+
+/// Detects parsers that do not need a DocumentInfo (e.g. DocumentParser3)
+template <typename Parser, typename = void>
+struct IsSinglePassParser : std::false_type {};
+template <typename Parser>
+struct IsSinglePassParser<Parser,
+                          std::void_t<decltype(Parser::IS_SINGLE_PASS)>>
+    : std::bool_constant<Parser::IS_SINGLE_PASS> {};
+} // namespace impl
+
+namespace impl {
+/// Storage of documents which reference strings without escape sequences in
+/// the JSON input instead of copying them to itsChars. The input is kept in
+/// DocumentBase::itsSource as a SourceTy.
+template <typename SourceTy>
+struct BorrowingDocumentStorage : public DynamicDocumentStorage {
+  static constexpr bool IS_BORROWING = true;
+  using Source = SourceTy;
+};
+
+/// Storage of documents which store equal object keys only once, so that
+/// e.g. arrays of records do not repeat the field names for every record.
+/// Properties with equal keys reference the same String.
+struct InterningDocumentStorage : public DynamicDocumentStorage {
+  static constexpr bool INTERNS_KEYS = true;
+};
+
+/// Storage of documents with 32 bit positions and sizes
+struct CompactDocumentStorage : public DynamicDocumentStorage {
+  using Indices = NarrowIndices;
+};
+
+/// Implementation of parseJson for the dynamic document types
+/// @param theOptions passed on to single-pass parsers in front of the
+/// encodings (e.g. a Projection)
+template <typename DocTy, typename Parser, typename... OptionsTy>
+typename Parser::error_handling::template ErrorOr<std::unique_ptr<DocTy>>
+parseDynamicDocument(const std::string_view theJson,
+                     const typename Parser::src_encoding theSrcEnc,
+                     const typename Parser::dest_encoding theDestEnc,
+                     const OptionsTy &...theOptions) {
+  static_assert(sizeof...(OptionsTy) == 0 || IsSinglePassParser<Parser>::value,
+                "Only single-pass parsers take options");
+  using ErrorHandling = typename Parser::error_handling;
+  using ResultTy = std::unique_ptr<DocTy>;
+  using Indices = typename DocTy::Indices;
+  constexpr bool aIsNarrow = !std::is_same_v<Indices, WideIndices>;
+  // Every entity, key and string takes up at least one byte of input, so
+  // only the number of chars needs to be checked separately
+  if (aIsNarrow && !Indices::fits(static_cast<intptr_t>(theJson.size())))
+    return ErrorHandling::template makeError<ResultTy>(
+        ErrorCode::DOCUMENT_TOO_LARGE, 0);
+  if constexpr (IsSinglePassParser<Parser>::value) {
+    auto aDocOrError = Parser::template parseDocument<DocTy>(
+        theJson, theOptions..., theSrcEnc, theDestEnc);
+    if (ErrorHandling::isError(aDocOrError))
+      return ErrorHandling::template convertError<ResultTy>(aDocOrError);
+    if (aIsNarrow &&
+        !Indices::fits(static_cast<intptr_t>(
+            ErrorHandling::unwrap(aDocOrError).itsChars.size())))
+      return ErrorHandling::template makeError<ResultTy>(
+          ErrorCode::DOCUMENT_TOO_LARGE, 0);
+    return {std::make_unique<DocTy>(
+        std::move(ErrorHandling::unwrap(aDocOrError)))};
+  }
+  const auto aDocInfoOrError =
+      DocumentInfo::compute<typename Parser::src_encoding,
+                            typename Parser::dest_encoding,
+                            typename Parser::error_handling>(
+          theJson, theSrcEnc, theDestEnc);
+
+  if (ErrorHandling::isError(aDocInfoOrError))
+    return ErrorHandling::template convertError<ResultTy>(aDocInfoOrError);
+  const auto aDocInfoAndLen = ErrorHandling::unwrap(aDocInfoOrError);
+  const DocumentInfo aDocInfo = aDocInfoAndLen.first;
+  const intptr_t aDocSize = aDocInfoAndLen.second;
+  assert(aDocInfo);
+  using P = parsing<typename Parser::src_encoding>;
+  const P p{theSrcEnc};
+  // Only trailing whitespace is allowed behind parsing end
+  if (!p.removeLeadingWhitespace(theJson.substr(aDocSize)).empty())
+    return ErrorHandling::template makeError<ResultTy>(
+        ErrorCode::TRAILING_CONTENT, aDocSize);
+  if (aIsNarrow && !Indices::fits(aDocInfo.itsNumChars))
+    return ErrorHandling::template makeError<ResultTy>(
+        ErrorCode::DOCUMENT_TOO_LARGE, 0);
+  auto aDocOrError = Parser::template parseDocument<DocTy>(
+      theJson, aDocInfo, theSrcEnc, theDestEnc);
+  if (ErrorHandling::isError(aDocOrError))
+    return ErrorHandling::template convertError<ResultTy>(aDocOrError);
+  // Moving takes over the buffers of the parsed document
+  return {std::make_unique<DocTy>(
+      std::move(ErrorHandling::unwrap(aDocOrError)))};
+}
 } // namespace impl
 
-struct DynamicDocument
-    : public DocumentInterfaceImpl<DocumentBase<impl::DynamicDocumentStorage>> {
-  using Base =
-      DocumentInterfaceImpl<DocumentBase<impl::DynamicDocumentStorage>>;
-  using Storage = impl::DynamicDocumentStorage;
+/// A JSON document that is parsed at runtime. StorageTy decides how it is
+/// laid out in memory (see DynamicDocument, InterningDynamicDocument and
+/// CompactDynamicDocument).
+///
+/// Its EntityRef is bound to the concrete DocumentBase, so all accesses can
+/// be inlined. Wrap it in a DocumentInterfaceView to handle it like documents
+/// of other types.
+template <typename StorageTy>
+struct BasicDynamicDocument : public DocumentBase<StorageTy> {
+  using Base = DocumentBase<StorageTy>;
+  using Storage = StorageTy;
+  using EntityRef = impl::EntityRefImpl<Base>;
+
+  BasicDynamicDocument(const DocumentInfo &theDocInfo) : Base{theDocInfo} {}
 
-  DynamicDocument(const DocumentInfo &theDocInfo) : Base{theDocInfo} {}
+  EntityRef getRoot() const noexcept { return {*this, Base::getRootEntity()}; }
+  bool operator==(const BasicDynamicDocument &theOther) const {
+    return getRoot() == theOther.getRoot();
+  }
 
   template <typename Parser>
   using ParseResult = typename Parser::error_handling::template ErrorOr<
-      std::unique_ptr<cjson::DynamicDocument>>;
+      std::unique_ptr<BasicDynamicDocument>>;
 
-  /// Parses a JSON string into a DynamicDocument using the specified Parser
-  /// type
+  /// Parses a JSON string into a document of this type using the specified
+  /// Parser type
   template <typename Parser = DocumentParser<>>
   static ParseResult<Parser>
   parseJson(const std::string_view theJson,
             const typename Parser::src_encoding theSrcEnc = {},
             const typename Parser::dest_encoding theDestEnc = {}) {
     using ErrorHandling = typename Parser::error_handling;
-    using ResultTy = std::unique_ptr<DynamicDocument>;
-    const auto aDocInfoOrError =
-        DocumentInfo::compute<typename Parser::src_encoding,
-                              typename Parser::dest_encoding,
-                              typename Parser::error_handling>(theJson, theSrcEnc, theDestEnc);
-
-    if (ErrorHandling::isError(aDocInfoOrError))
-      return ErrorHandling::template convertError<ResultTy>(aDocInfoOrError);
-    const auto aDocInfoAndLen = ErrorHandling::unwrap(aDocInfoOrError);
-    const DocumentInfo aDocInfo = aDocInfoAndLen.first;
-    const intptr_t aDocSize = aDocInfoAndLen.second;
-    assert(aDocInfo);
-    using P = parsing<typename Parser::src_encoding>;
-    const P p{theSrcEnc};
-    // Only trailing whitespace is allowed behind parsing end
-    if (!p.removeLeadingWhitespace(theJson.substr(aDocSize)).empty())
+    auto aResult = impl::parseDynamicDocument<BasicDynamicDocument, Parser>(
+        theJson, theSrcEnc, theDestEnc);
+    if (!ErrorHandling::isError(aResult))
+      ErrorHandling::unwrap(aResult)->buildPropertyIndex();
+    return aResult;
+  }
+
+  /// Parses only the values of theJson that theProjection selects, so that
+  /// the document holds nothing else. Parser has to be single-pass.
+  template <typename Parser = DocumentParser<Utf8, Utf8, ErrorWillReturnNone,
+                                             DocumentParser3>>
+  static ParseResult<Parser>
+  parseJsonProjection(const std::string_view theJson,
+                      const Projection &theProjection,
+                      const typename Parser::src_encoding theSrcEnc = {},
+                      const typename Parser::dest_encoding theDestEnc = {}) {
+    using ErrorHandling = typename Parser::error_handling;
+    auto aResult = impl::parseDynamicDocument<BasicDynamicDocument, Parser>(
+        theJson, theSrcEnc, theDestEnc, theProjection);
+    if (!ErrorHandling::isError(aResult))
+      ErrorHandling::unwrap(aResult)->buildPropertyIndex();
+    return aResult;
+  }
+
+  /// Copies theValue and everything in it into a new document of this type.
+  /// theValue may be part of a document of any type, e.g. an EntityRef of a
+  /// StaticDocument or of a DocumentInterface.
+  template <typename EntityRefTy>
+  static std::unique_ptr<BasicDynamicDocument>
+  extract(const EntityRefTy &theValue) {
+    const auto &aSrc = theValue.getDocument();
+    auto aDoc = std::make_unique<BasicDynamicDocument>(DocumentInfo{});
+    using SrcDocTy = std::decay_t<decltype(aSrc)>;
+    if constexpr (std::is_same_v<SrcDocTy, Base>) {
+      // The whole document is copied buffer by buffer
+      if (&theValue.getEntity() == &aSrc.getRootEntity()) {
+        static_cast<Base &>(*aDoc) = aSrc;
+        return aDoc;
+      }
+    }
+    impl::SubtreeCopier<BasicDynamicDocument> aCopier{*aDoc};
+    aDoc->itsEntities[0] = aCopier.append(aSrc, theValue.getEntity());
+    aDoc->buildPropertyIndex();
+    return aDoc;
+  }
+
+  /// Scratch buffers of Parser which parseInPlace reuses
+  template <typename Parser>
+  using ParseContext = typename Parser::template Context<BasicDynamicDocument>;
+
+  /// Parses theJson into this document, replacing its contents. The buffers
+  /// of the document and theContext keep their memory, so that parsing one
+  /// message after another stops allocating once they fit the largest one.
+  /// Parser has to be single-pass (see DocumentParser3).
+  /// @return this document or the error, after which the contents of the
+  /// document are unspecified
+  template <typename Parser>
+  typename Parser::error_handling::template ErrorOr<BasicDynamicDocument *>
+  parseInPlace(const std::string_view theJson,
+               ParseContext<Parser> &theContext) {
+    static_assert(impl::IsSinglePassParser<Parser>::value,
+                  "Only single-pass parsers reuse their buffers");
+    using ErrorHandling = typename Parser::error_handling;
+    using ResultTy = BasicDynamicDocument *;
+    using Indices = typename Base::Indices;
+    constexpr bool aIsNarrow = !std::is_same_v<Indices, WideIndices>;
+    if (aIsNarrow && !Indices::fits(static_cast<intptr_t>(theJson.size())))
       return ErrorHandling::template makeError<ResultTy>(
-          ErrorCode::TRAILING_CONTENT, aDocSize);
-    const auto aDocOrError =
-        Parser::template parseDocument<DynamicDocument>(theJson, aDocInfo, theSrcEnc, theDestEnc);
-    if (ErrorHandling::isError(aDocOrError))
-      return ErrorHandling::template convertError<ResultTy>(aDocOrError);
-    auto aResult = std::make_unique<DynamicDocument>(aDocInfo);
-    *aResult = std::move(ErrorHandling::unwrap(aDocOrError));
-    return {std::move(aResult)};
+          ErrorCode::DOCUMENT_TOO_LARGE, 0);
+    auto aResult = Parser::parseDocument(theJson, *this, theContext);
+    if (ErrorHandling::isError(aResult))
+      return aResult;
+    if (aIsNarrow &&
+        !Indices::fits(static_cast<intptr_t>(this->itsChars.size())))
+      return ErrorHandling::template makeError<ResultTy>(
+          ErrorCode::DOCUMENT_TOO_LARGE, 0);
+    this->buildPropertyIndex();
+    return aResult;
   }
 };
+using DynamicDocument = BasicDynamicDocument<impl::DynamicDocumentStorage>;
+/// DynamicDocument variant which stores every distinct object key only once.
+/// This saves a lot of memory for documents which repeat the same keys over
+/// and over. Within such a document, keys are equal exactly if they have the
+/// same Property::itsKeyPos.
+///
+/// DocumentParser3 allocates only what is needed, whereas DocumentParser2
+/// sizes the buffers for all keys up front and shrinks them after parsing.
+using InterningDynamicDocument =
+    BasicDynamicDocument<impl::InterningDocumentStorage>;
+/// DynamicDocument variant with 32 bit indices, which needs considerably less
+/// memory. Parsing fails with ErrorCode::DOCUMENT_TOO_LARGE for inputs of 2GiB
+/// and more.
+using CompactDynamicDocument =
+    BasicDynamicDocument<impl::CompactDocumentStorage>;
+
+/// DynamicDocument variant which only copies strings with escape sequences
+/// and references all others in the JSON input. This saves memory and
+/// copying if the input is kept around anyway. Source and destination
+/// encoding have to be the same.
+///
+/// SourceTy decides who keeps the input alive: BorrowingDynamicDocument
+/// takes ownership of it, while DynamicDocumentView requires callers to
+/// outlive the document with it.
+template <typename SourceTy>
+struct BorrowingDocument
+    : public DocumentBase<impl::BorrowingDocumentStorage<SourceTy>> {
+  using Storage = impl::BorrowingDocumentStorage<SourceTy>;
+  using Base = DocumentBase<Storage>;
+  using EntityRef = impl::EntityRefImpl<Base>;
+
+  BorrowingDocument(const DocumentInfo &theDocInfo) : Base{theDocInfo} {}
+
+  EntityRef getRoot() const noexcept { return {*this, Base::getRootEntity()}; }
+  bool operator==(const BorrowingDocument &theOther) const {
+    return getRoot() == theOther.getRoot();
+  }
+
+  template <typename Parser>
+  using ParseResult = typename Parser::error_handling::template ErrorOr<
+      std::unique_ptr<BorrowingDocument>>;
+
+  /// Parses theJson using the specified Parser type and stores it in the
+  /// resulting document
+  template <typename Parser = DocumentParser<>>
+  static ParseResult<Parser>
+  parseJson(SourceTy theJson,
+            const typename Parser::src_encoding theSrcEnc = {}) {
+    using ErrorHandling = typename Parser::error_handling;
+    auto aResult = impl::parseDynamicDocument<BorrowingDocument, Parser>(
+        theJson, theSrcEnc, theSrcEnc);
+    // Strings are referenced by offset, so moving the input is fine
+    if (!ErrorHandling::isError(aResult)) {
+      auto &aDoc = *ErrorHandling::unwrap(aResult);
+      aDoc.itsSource = std::move(theJson);
+      // Hashing borrowed keys needs the final location of the source
+      aDoc.buildPropertyIndex();
+    }
+    return aResult;
+  }
+
+  /// @return the JSON input of the document
+  std::string_view getSource() const noexcept { return this->itsSource; }
+};
+using BorrowingDynamicDocument = BorrowingDocument<std::string>;
+using DynamicDocumentView = BorrowingDocument<std::string_view>;
 } // namespace cjson
 #endif // CONSTEXPR_JSON_DYNAMIC_DOCUMENT_H
@@ -18,6 +18,9 @@ enum class ErrorCode {
   TYPE_DEDUCTION_FAILED,
   TRAILING_CONTENT,
   MAX_DEPTH_EXCEEDED,
+  DOCUMENT_TOO_LARGE,
+  IMAGE_INVALID,
+  IMAGE_READ_FAILED,
 };
 } // namespace cjson
 #endif // CONSTEXPR_JSON_ERROR_CODES_H
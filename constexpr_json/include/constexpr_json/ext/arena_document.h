@@ -0,0 +1,202 @@
+#ifndef CONSTEXPR_JSON_ARENA_DOCUMENT_H
+#define CONSTEXPR_JSON_ARENA_DOCUMENT_H
+
+#include "constexpr_json/dynamic_document.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace cjson {
+namespace impl {
+/// @return the memory resource which ArenaBuffers that are created on this
+/// thread allocate from, or null for the default resource
+inline std::pmr::memory_resource *&currentArena() noexcept {
+  thread_local std::pmr::memory_resource *aArena = nullptr;
+  return aArena;
+}
+
+/// Makes theArena the current arena of this thread while it is alive
+class ArenaScope {
+public:
+  explicit ArenaScope(std::pmr::memory_resource &theArena) noexcept
+      : itsPrevious{currentArena()} {
+    currentArena() = &theArena;
+  }
+  ArenaScope(const ArenaScope &) = delete;
+  ArenaScope &operator=(const ArenaScope &) = delete;
+  ~ArenaScope() { currentArena() = itsPrevious; }
+
+private:
+  std::pmr::memory_resource *const itsPrevious;
+};
+
+/// Growable buffer of trivially copyable Ts in a memory resource, which
+/// unlike std::vector leaves new elements uninitialized. Its resource is
+/// the current arena when it is created, copies share it.
+template <typename T> class ArenaBuffer {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Elements are copied and left uninitialized bytewise");
+
+public:
+  ArenaBuffer() noexcept
+      : itsArena{currentArena() ? currentArena()
+                                : std::pmr::get_default_resource()} {}
+  ArenaBuffer(const ArenaBuffer &theOther) : itsArena{theOther.itsArena} {
+    insert(end(), theOther.begin(), theOther.end());
+  }
+  ArenaBuffer(ArenaBuffer &&theOther) noexcept : itsArena{theOther.itsArena} {
+    swap(theOther);
+  }
+  ArenaBuffer &operator=(ArenaBuffer theOther) noexcept {
+    swap(theOther);
+    return *this;
+  }
+  ~ArenaBuffer() {
+    if (itsData)
+      itsArena->deallocate(itsData, itsCapacity * sizeof(T), alignof(T));
+  }
+
+  void swap(ArenaBuffer &theOther) noexcept {
+    std::swap(itsData, theOther.itsData);
+    std::swap(itsSize, theOther.itsSize);
+    std::swap(itsCapacity, theOther.itsCapacity);
+    std::swap(itsArena, theOther.itsArena);
+  }
+
+  T *data() noexcept { return itsData; }
+  const T *data() const noexcept { return itsData; }
+  size_t size() const noexcept { return itsSize; }
+  bool empty() const noexcept { return !itsSize; }
+  T &operator[](const size_t theIdx) noexcept { return itsData[theIdx]; }
+  const T &operator[](const size_t theIdx) const noexcept {
+    return itsData[theIdx];
+  }
+  T *begin() noexcept { return itsData; }
+  const T *begin() const noexcept { return itsData; }
+  T *end() noexcept { return itsData + itsSize; }
+  const T *end() const noexcept { return itsData + itsSize; }
+  T &back() noexcept { return itsData[itsSize - 1]; }
+  const T &back() const noexcept { return itsData[itsSize - 1]; }
+
+  /// @return the resource the elements are allocated from
+  std::pmr::memory_resource &getArena() const noexcept { return *itsArena; }
+
+  void reserve(const size_t theCapacity) {
+    if (theCapacity <= itsCapacity)
+      return;
+    T *const aData = static_cast<T *>(
+        itsArena->allocate(theCapacity * sizeof(T), alignof(T)));
+    if (itsData) {
+      std::copy(begin(), end(), aData);
+      itsArena->deallocate(itsData, itsCapacity * sizeof(T), alignof(T));
+    }
+    itsData = aData;
+    itsCapacity = theCapacity;
+  }
+  /// Leaves new elements uninitialized
+  void resize(const size_t theSize) {
+    if (theSize > itsCapacity)
+      reserve(std::max(theSize, 2 * itsCapacity));
+    itsSize = theSize;
+  }
+  void resize(const size_t theSize, const T &theValue) {
+    const size_t aOldSize = itsSize;
+    resize(theSize);
+    if (theSize > aOldSize)
+      std::fill(begin() + aOldSize, end(), theValue);
+  }
+  void assign(const size_t theSize, const T &theValue) {
+    clear();
+    resize(theSize, theValue);
+  }
+  void clear() noexcept { itsSize = 0; }
+  void push_back(const T &theValue) {
+    resize(itsSize + 1);
+    back() = theValue;
+  }
+  void pop_back() noexcept { --itsSize; }
+  /// Appends [theBegin, theEnd), which must not be part of this buffer.
+  /// Elements can only be inserted at the end.
+  template <typename IteratorTy>
+  T *insert(const T *thePos, const IteratorTy theBegin,
+            const IteratorTy theEnd) {
+    assert(thePos == end());
+    (void)thePos;
+    const size_t aOldSize = itsSize;
+    resize(itsSize + static_cast<size_t>(std::distance(theBegin, theEnd)));
+    return std::copy(theBegin, theEnd, begin() + aOldSize);
+  }
+  /// Arenas are released as a whole, so this does not give back anything
+  void shrink_to_fit() noexcept {}
+
+private:
+  T *itsData = nullptr;
+  size_t itsSize = 0;
+  size_t itsCapacity = 0;
+  std::pmr::memory_resource *itsArena;
+};
+
+/// Storage of documents whose buffers are allocated from a memory resource
+/// (see ArenaDynamicDocument)
+struct ArenaDocumentStorage : public DynamicDocumentStorage {
+  template <typename T, size_t N> using Buffer = ArenaBuffer<T>;
+
+  /// Buffers sized by a DocumentInfo are not initialized, since parsing
+  /// overwrites every element anyway
+  template <typename T, size_t N>
+  static Buffer<T, N> createBuffer(size_t theSize) {
+    Buffer<T, N> aBuf;
+    aBuf.resize(theSize);
+    return aBuf;
+  }
+};
+} // namespace impl
+
+/// DynamicDocument variant which allocates its buffers from a caller-supplied
+/// std::pmr::memory_resource instead of the heap, without initializing them.
+///
+/// With a std::pmr::monotonic_buffer_resource, parsing with DocumentParser2
+/// carves all buffers from the same block, and a whole batch of documents is
+/// freed by releasing the resource once they are destroyed. Documents
+/// parsed in parallel by DocumentParser4 are assembled on the calling
+/// thread, only their final buffers come from the resource.
+struct ArenaDynamicDocument
+    : public BasicDynamicDocument<impl::ArenaDocumentStorage> {
+  using Base = BasicDynamicDocument<impl::ArenaDocumentStorage>;
+  using Base::Base;
+
+  template <typename Parser>
+  using ParseResult = typename Parser::error_handling::template ErrorOr<
+      std::unique_ptr<ArenaDynamicDocument>>;
+
+  /// Parses a JSON string into a document whose buffers are allocated from
+  /// theArena, which has to outlive it
+  template <typename Parser = DocumentParser<>>
+  static ParseResult<Parser>
+  parseJson(const std::string_view theJson,
+            std::pmr::memory_resource &theArena =
+                *std::pmr::get_default_resource(),
+            const typename Parser::src_encoding theSrcEnc = {},
+            const typename Parser::dest_encoding theDestEnc = {}) {
+    using ErrorHandling = typename Parser::error_handling;
+    const impl::ArenaScope aScope{theArena};
+    auto aResult = impl::parseDynamicDocument<ArenaDynamicDocument, Parser>(
+        theJson, theSrcEnc, theDestEnc);
+    if (!ErrorHandling::isError(aResult))
+      ErrorHandling::unwrap(aResult)->buildPropertyIndex();
+    return aResult;
+  }
+
+  /// @return the resource the buffers of the document are allocated from
+  std::pmr::memory_resource &getArena() const noexcept {
+    return itsEntities.getArena();
+  }
+};
+} // namespace cjson
+#endif // CONSTEXPR_JSON_ARENA_DOCUMENT_H
@@ -8,6 +8,8 @@ namespace cjson {
 struct Ascii {
   using CodePointTy = char;
   static constexpr size_t MAX_BYTES = 1;
+  /// Structural characters can be found byte by byte
+  static constexpr bool ASCII_COMPATIBLE = true;
 
   constexpr std::pair<CodePointTy, size_t>
   decodeFirst(std::string_view theString) const noexcept {
@@ -0,0 +1,399 @@
+#ifndef CONSTEXPR_JSON_BINARY_IMAGE_H
+#define CONSTEXPR_JSON_BINARY_IMAGE_H
+
+#include "constexpr_json/document.h"
+#include "constexpr_json/error_codes.h"
+#include "constexpr_json/ext/error_is_detail.h"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CJSON_HAS_MMAP 1
+#else
+#include <fstream>
+#endif
+
+namespace cjson {
+namespace impl {
+/// Read-only array of T inside a binary image, which documents loaded from
+/// images use instead of their buffers
+template <typename T> class ImageBuffer {
+public:
+  constexpr ImageBuffer() noexcept = default;
+  constexpr ImageBuffer(const T *theData, const size_t theSize) noexcept
+      : itsData{theData}, itsSize{theSize} {}
+
+  constexpr const T *data() const noexcept { return itsData; }
+  constexpr size_t size() const noexcept { return itsSize; }
+  constexpr bool empty() const noexcept { return !itsSize; }
+  constexpr const T &operator[](const size_t theIdx) const noexcept {
+    return itsData[theIdx];
+  }
+  constexpr const T *begin() const noexcept { return itsData; }
+  constexpr const T *end() const noexcept { return itsData + itsSize; }
+
+private:
+  const T *itsData = nullptr;
+  size_t itsSize = 0;
+};
+
+/// Storage of documents which are served from a binary image (see
+/// BasicMappedDocument)
+template <typename IndicesTy> struct ImageDocumentStorage {
+  template <typename T, size_t N> using Buffer = ImageBuffer<T>;
+
+  static constexpr bool IS_GROWABLE = false;
+  /// Borrowed strings are copied into the image when it is written
+  static constexpr bool IS_BORROWING = false;
+  static constexpr bool INTERNS_KEYS = false;
+  /// Entities are stored as they were in the document the image was written
+  /// from, so they may contain inline scalars
+  static constexpr bool INLINES_SCALARS = true;
+  /// The property index of the document is written into the image as well
+  static constexpr bool HAS_PROPERTY_INDEX = true;
+  /// Cached hashes are not written into the image
+  static constexpr bool CACHES_HASHES = false;
+  static constexpr bool SORTS_KEYS = false;
+  static constexpr bool DECODES_LAZILY = false;
+  using Indices = IndicesTy;
+
+  static constexpr intptr_t MAX_NUMBERS() {
+    return std::numeric_limits<intptr_t>::max();
+  }
+  static constexpr intptr_t MAX_CHARS() {
+    return std::numeric_limits<intptr_t>::max();
+  }
+  static constexpr intptr_t MAX_ENTITIES() {
+    return std::numeric_limits<intptr_t>::max();
+  }
+  static constexpr intptr_t MAX_ARRAYS() {
+    return std::numeric_limits<intptr_t>::max();
+  }
+  static constexpr intptr_t MAX_OBJECTS() {
+    return std::numeric_limits<intptr_t>::max();
+  }
+  static constexpr intptr_t MAX_OBJECT_PROPS() {
+    return std::numeric_limits<intptr_t>::max();
+  }
+  static constexpr intptr_t MAX_STRINGS() {
+    return std::numeric_limits<intptr_t>::max();
+  }
+
+  /// The buffers are pointed into the image after construction
+  template <typename T, size_t N>
+  static constexpr Buffer<T, N> createBuffer(size_t) {
+    return {};
+  }
+};
+
+/// Beginning of every binary image. It is followed by the buffers of the
+/// document in the order of Section, each one starting at a multiple of
+/// ALIGNMENT. Since buffers only contain indices, images can be loaded at
+/// any address.
+struct ImageHeader {
+  static constexpr char MAGIC[8] = {'C', 'J', 'S', 'O', 'N', 'I', 'M', 'G'};
+  /// Has to be increased whenever the layout of images changes
+  static constexpr uint32_t VERSION = 1;
+  /// Written as a word, so that images from hosts with a different byte
+  /// order are rejected
+  static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+  static constexpr size_t ALIGNMENT = 8;
+
+  enum Section {
+    NUMBERS,
+    CHARS,
+    ENTITIES,
+    ARRAYS,
+    OBJECTS,
+    OBJECT_PROPS,
+    STRINGS,
+    PROPERTY_INDEX,
+    PROPERTY_INDEX_POS,
+    NUM_SECTIONS
+  };
+
+  char itsMagic[8];
+  uint32_t itsVersion;
+  uint32_t itsByteOrder;
+  /// sizeof() the elements of every section, which differ between index
+  /// widths and ABIs
+  uint32_t itsElementSizes[NUM_SECTIONS];
+  uint32_t itsReserved;
+  uint64_t itsNumElements[NUM_SECTIONS];
+
+  /// @return the header of images of documents with the given Indices
+  template <typename Indices>
+  static constexpr ImageHeader
+  create(const uint64_t (&theNumElements)[NUM_SECTIONS]) {
+    ImageHeader aHeader{{}, VERSION, BYTE_ORDER_MARK,
+                        {sizeof(double), sizeof(char), sizeof(Entity),
+                         sizeof(BasicArray<Indices>),
+                         sizeof(BasicObject<Indices>),
+                         sizeof(BasicProperty<Indices>),
+                         sizeof(BasicString<Indices>), sizeof(intptr_t),
+                         sizeof(intptr_t)},
+                        0,
+                        {}};
+    for (size_t aIdx = 0; aIdx < sizeof(MAGIC); ++aIdx)
+      aHeader.itsMagic[aIdx] = MAGIC[aIdx];
+    for (size_t aSection = 0; aSection < NUM_SECTIONS; ++aSection)
+      aHeader.itsNumElements[aSection] = theNumElements[aSection];
+    return aHeader;
+  }
+
+  static constexpr size_t alignUp(const size_t theOffset) noexcept {
+    return (theOffset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  }
+
+  /// @return the offset of theSection in the image or, for NUM_SECTIONS, the
+  /// size of the whole image. Overflows are reported as SIZE_MAX.
+  size_t getOffset(const size_t theSection) const noexcept {
+    size_t aOffset = alignUp(sizeof(ImageHeader));
+    for (size_t aSection = 0; aSection < theSection; ++aSection) {
+      const uint64_t aMaxElements =
+          (std::numeric_limits<size_t>::max() - ALIGNMENT - aOffset) /
+          itsElementSizes[aSection];
+      if (itsNumElements[aSection] > aMaxElements)
+        return std::numeric_limits<size_t>::max();
+      aOffset = alignUp(aOffset + itsNumElements[aSection] *
+                                      itsElementSizes[aSection]);
+    }
+    return aOffset;
+  }
+};
+static_assert(sizeof(ImageHeader) % ImageHeader::ALIGNMENT == 0,
+              "Sections have to be aligned");
+} // namespace impl
+
+/// Writes theDoc as a binary image, which BasicMappedDocument serves without
+/// parsing. Strings borrowed from the JSON input are copied into the image.
+/// The image can only be loaded on hosts with the same byte order and ABI.
+/// @return false if writing to theStream failed
+template <typename DocTy>
+bool writeBinaryImage(const DocTy &theDoc, std::ostream &theStream) {
+  using Storage = typename DocTy::Storage;
+  using Header = impl::ImageHeader;
+  using String = typename DocTy::String;
+  static_assert(!Storage::DECODES_LAZILY,
+                "Images are written from fully decoded documents");
+
+  // Borrowed strings are appended to the chars of the document
+  std::vector<String> aStrings(theDoc.itsStrings.begin(),
+                               theDoc.itsStrings.end());
+  std::string aBorrowedChars;
+  if constexpr (Storage::IS_BORROWING) {
+    for (String &aStr : aStrings) {
+      if (aStr.itsPosition >= 0)
+        continue;
+      const auto aPos = theDoc.itsChars.size() + aBorrowedChars.size();
+      aBorrowedChars.append(std::string_view{theDoc.itsSource}.substr(
+          ~aStr.itsPosition, aStr.itsSize));
+      aStr.itsPosition = static_cast<decltype(aStr.itsPosition)>(aPos);
+    }
+  }
+  size_t aNumIndexSlots = 0;
+  size_t aNumIndexPos = 0;
+  if constexpr (Storage::HAS_PROPERTY_INDEX) {
+    aNumIndexSlots = theDoc.itsPropertyIndex.size();
+    aNumIndexPos = theDoc.itsPropertyIndexPos.size();
+  }
+  const Header aHeader = Header::create<typename DocTy::Indices>(
+      {theDoc.itsNumbers.size(),
+       theDoc.itsChars.size() + aBorrowedChars.size(),
+       theDoc.itsEntities.size(), theDoc.itsArrays.size(),
+       theDoc.itsObjects.size(), theDoc.itsObjectProps.size(),
+       aStrings.size(), aNumIndexSlots, aNumIndexPos});
+
+  size_t aOffset = 0;
+  const auto write = [&](const void *theData, const size_t theSize) {
+    theStream.write(static_cast<const char *>(theData),
+                    static_cast<std::streamsize>(theSize));
+    aOffset += theSize;
+  };
+  const auto pad = [&] {
+    static constexpr char PADDING[Header::ALIGNMENT] = {};
+    write(PADDING, Header::alignUp(aOffset) - aOffset);
+  };
+  const auto writeSection = [&](const auto &theBuffer) {
+    write(theBuffer.data(), theBuffer.size() * sizeof(theBuffer[0]));
+    pad();
+  };
+  write(&aHeader, sizeof(aHeader));
+  writeSection(theDoc.itsNumbers);
+  write(theDoc.itsChars.data(), theDoc.itsChars.size());
+  writeSection(aBorrowedChars);
+  writeSection(theDoc.itsEntities);
+  writeSection(theDoc.itsArrays);
+  writeSection(theDoc.itsObjects);
+  writeSection(theDoc.itsObjectProps);
+  writeSection(aStrings);
+  if constexpr (Storage::HAS_PROPERTY_INDEX) {
+    writeSection(theDoc.itsPropertyIndex);
+    writeSection(theDoc.itsPropertyIndexPos);
+  }
+  return static_cast<bool>(theStream);
+}
+
+/// Read-only document which is served directly from a binary image written
+/// by writeBinaryImage, e.g. a memory-mapped file. Loading it takes constant
+/// time and processes which map the same file share its physical pages.
+///
+/// Only the header of the image is checked, its contents are trusted.
+/// IndicesTy has to match the document the image was written from.
+template <typename IndicesTy = WideIndices>
+class BasicMappedDocument
+    : public DocumentBase<impl::ImageDocumentStorage<IndicesTy>> {
+public:
+  using Storage = impl::ImageDocumentStorage<IndicesTy>;
+  using Base = DocumentBase<Storage>;
+  using EntityRef = impl::EntityRefImpl<Base>;
+
+  template <typename ErrorHandling>
+  using LoadResult = typename ErrorHandling::template ErrorOr<
+      std::unique_ptr<BasicMappedDocument>>;
+
+  BasicMappedDocument(const BasicMappedDocument &) = delete;
+  BasicMappedDocument &operator=(const BasicMappedDocument &) = delete;
+  ~BasicMappedDocument() {
+#ifdef CJSON_HAS_MMAP
+    if (itsIsMapped)
+      munmap(const_cast<char *>(itsImage.data()), itsImage.size());
+#endif
+  }
+
+  /// Serves the document from theImage, which has to outlive it and has to
+  /// be aligned to ImageHeader::ALIGNMENT
+  template <typename ErrorHandling =
+                cjson::ErrorWillReturnDetail<cjson::JsonErrorDetail>>
+  static LoadResult<ErrorHandling> fromImage(const std::string_view theImage) {
+    std::unique_ptr<BasicMappedDocument> aDoc{new BasicMappedDocument};
+    if (!aDoc->load(theImage))
+      return ErrorHandling::template makeError<
+          std::unique_ptr<BasicMappedDocument>>(ErrorCode::IMAGE_INVALID, 0);
+    return {std::move(aDoc)};
+  }
+
+  /// Maps the binary image in the file thePath into memory and serves the
+  /// document from there. Where memory mapping is not available, the file
+  /// is read instead.
+  template <typename ErrorHandling =
+                cjson::ErrorWillReturnDetail<cjson::JsonErrorDetail>>
+  static LoadResult<ErrorHandling> mapFile(const char *const thePath) {
+    using ResultTy = std::unique_ptr<BasicMappedDocument>;
+    ResultTy aDoc{new BasicMappedDocument};
+#ifdef CJSON_HAS_MMAP
+    const int aFd = open(thePath, O_RDONLY);
+    if (aFd < 0)
+      return ErrorHandling::template makeError<ResultTy>(
+          ErrorCode::IMAGE_READ_FAILED, 0);
+    struct stat aStat;
+    void *aMapping = MAP_FAILED;
+    if (!fstat(aFd, &aStat) && aStat.st_size > 0)
+      aMapping = mmap(nullptr, static_cast<size_t>(aStat.st_size), PROT_READ,
+                      MAP_SHARED, aFd, 0);
+    close(aFd);
+    if (aMapping == MAP_FAILED)
+      return ErrorHandling::template makeError<ResultTy>(
+          ErrorCode::IMAGE_READ_FAILED, 0);
+    aDoc->itsIsMapped = true;
+    const std::string_view aImage{static_cast<const char *>(aMapping),
+                                  static_cast<size_t>(aStat.st_size)};
+#else
+    std::ifstream aFile{thePath, std::ios::binary | std::ios::ate};
+    if (!aFile)
+      return ErrorHandling::template makeError<ResultTy>(
+          ErrorCode::IMAGE_READ_FAILED, 0);
+    const auto aSize = static_cast<size_t>(aFile.tellg());
+    // Copy into words to get the alignment of the sections right
+    aDoc->itsImageCopy.reset(new uint64_t[aSize / sizeof(uint64_t) + 1]);
+    aFile.seekg(0);
+    if (!aFile.read(reinterpret_cast<char *>(aDoc->itsImageCopy.get()),
+                    static_cast<std::streamsize>(aSize)))
+      return ErrorHandling::template makeError<ResultTy>(
+          ErrorCode::IMAGE_READ_FAILED, 0);
+    const std::string_view aImage{
+        reinterpret_cast<const char *>(aDoc->itsImageCopy.get()), aSize};
+#endif
+    if (!aDoc->load(aImage))
+      return ErrorHandling::template makeError<ResultTy>(
+          ErrorCode::IMAGE_INVALID, 0);
+    return {std::move(aDoc)};
+  }
+
+  EntityRef getRoot() const noexcept { return {*this, Base::getRootEntity()}; }
+  bool operator==(const BasicMappedDocument &theOther) const {
+    return getRoot() == theOther.getRoot();
+  }
+
+  /// @return the binary image the document is served from
+  std::string_view getImage() const noexcept { return itsImage; }
+
+private:
+  using Header = impl::ImageHeader;
+
+  BasicMappedDocument() : Base{DocumentInfo{}} {}
+
+  /// Points the buffers into theImage after checking its header
+  /// @return false if theImage is not a valid image for this document type
+  bool load(const std::string_view theImage) {
+    itsImage = theImage;
+    if (theImage.size() < sizeof(Header) ||
+        reinterpret_cast<uintptr_t>(theImage.data()) % Header::ALIGNMENT)
+      return false;
+    Header aHeader;
+    std::memcpy(&aHeader, theImage.data(), sizeof(aHeader));
+    const Header aExpected =
+        Header::create<IndicesTy>(aHeader.itsNumElements);
+    if (std::memcmp(&aHeader, &aExpected, sizeof(aHeader)) ||
+        aHeader.getOffset(Header::NUM_SECTIONS) > theImage.size() ||
+        !aHeader.itsNumElements[Header::ENTITIES] ||
+        (aHeader.itsNumElements[Header::PROPERTY_INDEX_POS] &&
+         aHeader.itsNumElements[Header::PROPERTY_INDEX_POS] !=
+             aHeader.itsNumElements[Header::OBJECTS]))
+      return false;
+    const auto section = [&](auto &theBuffer, const Header::Section theSec) {
+      using T = std::remove_cv_t<
+          std::remove_reference_t<decltype(*theBuffer.data())>>;
+      theBuffer = impl::ImageBuffer<T>{
+          reinterpret_cast<const T *>(theImage.data() +
+                                      aHeader.getOffset(theSec)),
+          static_cast<size_t>(aHeader.itsNumElements[theSec])};
+    };
+    section(this->itsNumbers, Header::NUMBERS);
+    section(this->itsChars, Header::CHARS);
+    section(this->itsEntities, Header::ENTITIES);
+    section(this->itsArrays, Header::ARRAYS);
+    section(this->itsObjects, Header::OBJECTS);
+    section(this->itsObjectProps, Header::OBJECT_PROPS);
+    section(this->itsStrings, Header::STRINGS);
+    section(this->itsPropertyIndex, Header::PROPERTY_INDEX);
+    section(this->itsPropertyIndexPos, Header::PROPERTY_INDEX_POS);
+    return true;
+  }
+
+  std::string_view itsImage;
+  /// Whether itsImage has been mapped by mapFile and has to be unmapped
+  bool itsIsMapped = false;
+#ifndef CJSON_HAS_MMAP
+  /// The contents of the file loaded by mapFile
+  std::unique_ptr<uint64_t[]> itsImageCopy;
+#endif
+};
+using MappedDocument = BasicMappedDocument<>;
+/// Serves images of CompactDynamicDocuments and StaticDocuments with
+/// narrow indices
+using CompactMappedDocument = BasicMappedDocument<NarrowIndices>;
+} // namespace cjson
+#endif // CONSTEXPR_JSON_BINARY_IMAGE_H
@@ -85,6 +85,12 @@ struct JsonErrorDetail {
       return "Encountered additional characters when EOF was expected";
     case ErrorCode::MAX_DEPTH_EXCEEDED:
       return "Exceeded maximum document nesting level";
+    case ErrorCode::DOCUMENT_TOO_LARGE:
+      return "Document does not fit the index width of its storage";
+    case ErrorCode::IMAGE_INVALID:
+      return "Binary image is malformed or was written for another platform";
+    case ErrorCode::IMAGE_READ_FAILED:
+      return "Failed to read binary image";
     }
     return nullptr;
   }
@@ -14,4 +14,15 @@
           theJsonStr, *aDocInfo##theOutput);                                   \
   static_assert(theOutput, "Failed to parse " theDesc)
 
+/// Counterpart of LOAD_STATIC_JSON for headers written by
+/// generate_json_image_header, which contain the buffers of the document
+/// instead of its JSON. Those headers call USE_JSON_IMAGE with the
+/// DocumentInfo and the buffers, so define it like this before including
+/// them:
+///     #define USE_JSON_IMAGE(...) LOAD_STATIC_JSON_IMAGE(aDoc, __VA_ARGS__)
+/// Like with LOAD_STATIC_JSON, theOutput is an optional document.
+#define LOAD_STATIC_JSON_IMAGE(theOutput, theDocInfo, ...)                     \
+  constexpr auto theOutput = std::make_optional(                               \
+      cjson::makeStaticDocument<CJSON_STATIC_DOCTY(theDocInfo)>(__VA_ARGS__))
+
 #endif // CONSTEXPR_JSON_EXT_MACROS_H
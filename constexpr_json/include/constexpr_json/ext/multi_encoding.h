@@ -1,6 +1,8 @@
 #ifndef CONSTEXPR_JSON_EXT_MULTI_ENCODING_H
 #define CONSTEXPR_JSON_EXT_MULTI_ENCODING_H
 
+#include "constexpr_json/impl/ascii_scanning.h"
+
 #include <algorithm>
 #include <array>
 #include <string_view>
@@ -20,6 +22,9 @@ template <typename... Encodings> struct MultiEncoding {
 
   using CodePointTy = std::common_type_t<typename Encodings::CodePointTy...>;
   static constexpr size_t MAX_BYTES = std::max({Encodings::MAX_BYTES...});
+  /// Allows fast paths for ASCII-compatible encodings if all of them are
+  static constexpr bool ASCII_COMPATIBLE =
+      (impl::IsAsciiCompatible<Encodings>::value && ...);
 
   constexpr std::pair<CodePointTy, size_t>
   decodeFirst(std::string_view theString) const noexcept {
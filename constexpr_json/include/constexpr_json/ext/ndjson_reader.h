@@ -0,0 +1,188 @@
+#ifndef CONSTEXPR_JSON_NDJSON_READER_H
+#define CONSTEXPR_JSON_NDJSON_READER_H
+
+#include "constexpr_json/dynamic_document.h"
+#include "constexpr_json/ext/error_is_detail.h"
+#include "constexpr_json/impl/document_parser3.h"
+
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+namespace cjson {
+/// Reads newline-delimited JSON (NDJSON, JSON Lines), i.e. one document per
+/// line, from a stream or a buffer.
+///
+/// All records are parsed into the same DynamicDocument, whose buffers are
+/// reused together with the read buffer and the scratch buffers of the
+/// parser. Once these have grown to fit the largest record, reading further
+/// records does not allocate any more.
+///
+/// Malformed records are reported in their Record::itsResult and reading
+/// continues with the next line. Blank lines are skipped.
+template <typename ErrorHandling =
+              cjson::ErrorWillReturnDetail<cjson::JsonErrorDetail>,
+          typename InputEncoding = cjson::Utf8,
+          typename OutputEncoding = cjson::Utf8>
+class NdjsonReader {
+  static_assert(impl::IsAsciiCompatible<InputEncoding>::value,
+                "Line breaks are searched for bytewise");
+
+public:
+  using ParserTy = cjson::DocumentParser<InputEncoding, OutputEncoding,
+                                         ErrorHandling, DocumentParser3>;
+  using Result =
+      typename ErrorHandling::template ErrorOr<const DynamicDocument *>;
+
+  struct Record {
+    /// 1-based number of the line the record was read from
+    size_t itsLineNumber = 0;
+    /// The JSON text of the record, excluding the line break
+    std::string_view itsLine;
+    /// The parsed document or the error in itsLine
+    Result itsResult = {};
+  };
+
+  /// Reads records from theStream as they are needed
+  explicit NdjsonReader(std::istream &theStream,
+                        const InputEncoding theInEnc = {},
+                        const OutputEncoding theOutEnc = {})
+      : itsStream{&theStream}, itsBuffer(INITIAL_BUFFER_SIZE, '\0'),
+        itsContext{theInEnc, theOutEnc}, itsInEnc{theInEnc} {}
+
+  /// Reads records from theInput, which has to outlive the reader
+  explicit NdjsonReader(const std::string_view theInput,
+                        const InputEncoding theInEnc = {},
+                        const OutputEncoding theOutEnc = {})
+      : itsUnread{theInput}, itsContext{theInEnc, theOutEnc},
+        itsInEnc{theInEnc} {}
+
+  /// Parses the next non-blank line into getRecord(). Documents, lines and
+  /// errors of previous records are invalidated by this.
+  ///
+  /// With ErrorWillThrow, the exception is raised after getRecord() has been
+  /// updated with the location of the malformed record, so reading may be
+  /// resumed by calling next() again.
+  ///
+  /// @return false if there are no more records or reading from the stream
+  /// failed (see hasReadError)
+  bool next() {
+    const parsing<InputEncoding> p{itsInEnc};
+    std::string_view aLine;
+    do {
+      if (!readLine(aLine))
+        return false;
+      ++itsLineNumber;
+    } while (p.removeLeadingWhitespace(aLine).empty());
+    itsRecord.itsLineNumber = itsLineNumber;
+    itsRecord.itsLine = aLine;
+    itsRecord.itsResult = ParserTy::parseDocument(aLine, itsContext);
+    if (!ErrorHandling::isError(itsRecord.itsResult)) {
+      // The document is owned by itsContext, it is only handed out as const
+      const_cast<DynamicDocument *>(ErrorHandling::unwrap(itsRecord.itsResult))
+          ->buildPropertyIndex();
+    }
+    return true;
+  }
+
+  const Record &getRecord() const noexcept { return itsRecord; }
+
+  /// @return whether reading stopped because of an error of the stream
+  bool hasReadError() const noexcept { return itsReadError; }
+
+  /// Input iterator over the remaining records, which calls next() when
+  /// advanced
+  class iterator {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = Record;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Record *;
+    using reference = const Record &;
+
+    iterator() = default;
+
+    reference operator*() const { return itsReader->getRecord(); }
+    pointer operator->() const { return &itsReader->getRecord(); }
+    iterator &operator++() {
+      if (!itsReader->next())
+        itsReader = nullptr;
+      return *this;
+    }
+    bool operator==(const iterator &theOther) const {
+      return itsReader == theOther.itsReader;
+    }
+    bool operator!=(const iterator &theOther) const {
+      return !(*this == theOther);
+    }
+
+  private:
+    friend NdjsonReader;
+    explicit iterator(NdjsonReader *theReader) : itsReader{theReader} {}
+
+    NdjsonReader *itsReader = nullptr;
+  };
+
+  iterator begin() { return iterator{next() ? this : nullptr}; }
+  iterator end() { return iterator{}; }
+
+private:
+  static constexpr size_t INITIAL_BUFFER_SIZE = 64 * 1024;
+
+  /// Cuts the next line off of itsUnread, reading more from itsStream as
+  /// necessary
+  /// @return false if the input is exhausted
+  bool readLine(std::string_view &theLine) {
+    for (size_t aSearched = 0;;) {
+      const size_t aBreak = itsUnread.find('\n', aSearched);
+      if (aBreak != std::string_view::npos) {
+        theLine = itsUnread.substr(0, aBreak);
+        itsUnread.remove_prefix(aBreak + 1);
+        return true;
+      }
+      aSearched = itsUnread.size();
+      if (!fillBuffer()) {
+        // The last line does not need to be terminated
+        theLine = itsUnread;
+        itsUnread = {};
+        return !theLine.empty();
+      }
+    }
+  }
+
+  /// Moves the unread input to the front of itsBuffer and appends as much
+  /// from itsStream as fits, growing itsBuffer if it is full already
+  /// @return false if no more input is available
+  bool fillBuffer() {
+    if (!itsStream || !*itsStream)
+      return false;
+    const size_t aNumUnread = itsUnread.size();
+    // The view is still empty (and may be null) before the first fill
+    if (aNumUnread)
+      std::memmove(itsBuffer.data(), itsUnread.data(), aNumUnread);
+    if (aNumUnread == itsBuffer.size())
+      itsBuffer.resize(2 * itsBuffer.size());
+    itsStream->read(itsBuffer.data() + aNumUnread,
+                    itsBuffer.size() - aNumUnread);
+    if (itsStream->bad())
+      itsReadError = true;
+    const auto aReadLen = static_cast<size_t>(itsStream->gcount());
+    itsUnread = std::string_view{itsBuffer.data(), aNumUnread + aReadLen};
+    return aReadLen > 0;
+  }
+
+  std::istream *itsStream = nullptr;
+  /// Holds the current and the following lines of itsStream
+  std::string itsBuffer;
+  /// Input behind the current record
+  std::string_view itsUnread;
+  typename ParserTy::template Context<DynamicDocument> itsContext;
+  const InputEncoding itsInEnc;
+  size_t itsLineNumber = 0;
+  Record itsRecord;
+  bool itsReadError = false;
+};
+} // namespace cjson
+#endif // CONSTEXPR_JSON_NDJSON_READER_H
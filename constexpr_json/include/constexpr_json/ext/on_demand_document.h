@@ -0,0 +1,90 @@
+#ifndef CONSTEXPR_JSON_ON_DEMAND_DOCUMENT_H
+#define CONSTEXPR_JSON_ON_DEMAND_DOCUMENT_H
+
+#include "constexpr_json/dynamic_document.h"
+#include "constexpr_json/impl/document_parser3.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace cjson {
+namespace impl {
+/// Storage of documents which decode numbers and strings with escape
+/// sequences only when they are read (see impl::DocumentLazyValues). Like
+/// borrowing documents, they keep the JSON input as SourceTy.
+template <typename SourceTy, typename EncodingTy>
+struct OnDemandDocumentStorage : public BorrowingDocumentStorage<SourceTy> {
+  /// Inline scalars would have to be decoded while parsing
+  static constexpr bool INLINES_SCALARS = false;
+  static constexpr bool DECODES_LAZILY = true;
+  /// Encoding of the input and of the strings read from the document
+  using Encoding = EncodingTy;
+};
+} // namespace impl
+
+/// Document which only locates the values in its JSON input while parsing
+/// and decodes them once they are read, for consumers which only look at a
+/// few values of large inputs.
+///
+/// Parsing validates the input completely, but does not convert numbers and
+/// does not copy any strings except for object keys with escape sequences.
+/// toNumber() and toString() decode the value on their first call and cache
+/// it in the document. Since reading modifies those caches, a document must
+/// not be read by several threads at once.
+///
+/// Like BorrowingDocument, SourceTy decides who keeps the input alive:
+/// OnDemandDocument takes ownership of it, while OnDemandDocumentView
+/// requires callers to outlive the document with it.
+template <typename SourceTy, typename EncodingTy = Utf8>
+struct BasicOnDemandDocument
+    : public DocumentBase<impl::OnDemandDocumentStorage<SourceTy, EncodingTy>> {
+  using Storage = impl::OnDemandDocumentStorage<SourceTy, EncodingTy>;
+  using Base = DocumentBase<Storage>;
+  using EntityRef = impl::EntityRefImpl<Base>;
+
+  BasicOnDemandDocument(const DocumentInfo &theDocInfo) : Base{theDocInfo} {}
+
+  EntityRef getRoot() const noexcept { return {*this, Base::getRootEntity()}; }
+  bool operator==(const BasicOnDemandDocument &theOther) const {
+    return getRoot() == theOther.getRoot();
+  }
+
+  template <typename Parser>
+  using ParseResult = typename Parser::error_handling::template ErrorOr<
+      std::unique_ptr<BasicOnDemandDocument>>;
+
+  /// Parses theJson and stores it in the resulting document. Parser has to
+  /// use DocumentParser3, which is the only one that knows how to defer
+  /// decoding.
+  template <typename Parser = DocumentParser<EncodingTy, EncodingTy,
+                                             ErrorWillReturnNone,
+                                             DocumentParser3>>
+  static ParseResult<Parser> parseJson(SourceTy theJson) {
+    static_assert(impl::IsSinglePassParser<Parser>::value,
+                  "Lazy decoding requires DocumentParser3");
+    static_assert(std::is_same_v<typename Parser::src_encoding, EncodingTy> &&
+                      std::is_same_v<typename Parser::dest_encoding,
+                                     EncodingTy>,
+                  "Lazily decoded strings cannot be transcoded");
+    using ErrorHandling = typename Parser::error_handling;
+    auto aResult = impl::parseDynamicDocument<BasicOnDemandDocument, Parser>(
+        theJson, {}, {});
+    // Values are located by offset, so moving the input is fine
+    if (!ErrorHandling::isError(aResult)) {
+      auto &aDoc = *ErrorHandling::unwrap(aResult);
+      aDoc.itsSource = std::move(theJson);
+      aDoc.buildPropertyIndex();
+    }
+    return aResult;
+  }
+
+  /// @return the JSON input of the document
+  std::string_view getSource() const noexcept { return this->itsSource; }
+};
+using OnDemandDocument = BasicOnDemandDocument<std::string>;
+using OnDemandDocumentView = BasicOnDemandDocument<std::string_view>;
+} // namespace cjson
+#endif // CONSTEXPR_JSON_ON_DEMAND_DOCUMENT_H
@@ -0,0 +1,413 @@
+#ifndef CONSTEXPR_JSON_PUSH_PARSER_H
+#define CONSTEXPR_JSON_PUSH_PARSER_H
+
+#include "constexpr_json/dynamic_document.h"
+#include "constexpr_json/error_codes.h"
+#include "constexpr_json/ext/error_is_detail.h"
+#include "constexpr_json/impl/document_parser3.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace cjson {
+/// Resumable parser which is fed a JSON document in chunks as they arrive,
+/// e.g. from a socket or pipe
+///
+/// Every chunk is parsed right away by the same Builder as DocumentParser3
+/// uses. Only a token which is cut off at the end of a chunk (a string,
+/// number or literal) is copied aside until the following chunks complete
+/// it, so the input as a whole is never buffered.
+///
+/// Errors are reported with the same codes and positions as DocumentParser2
+/// reports them for the whole input.
+///
+/// A PushParser parses a single document. Its source encoding has to be
+/// ASCII-compatible.
+template <typename ErrorHandling =
+              cjson::ErrorWillReturnDetail<cjson::JsonErrorDetail>,
+          typename InputEncoding = cjson::Utf8,
+          typename OutputEncoding = cjson::Utf8>
+class PushParser
+    : private DocumentParser3<InputEncoding, OutputEncoding, ErrorHandling> {
+  static_assert(impl::IsAsciiCompatible<InputEncoding>::value,
+                "Tokens are delimited bytewise");
+  using BaseClass =
+      DocumentParser3<InputEncoding, OutputEncoding, ErrorHandling>;
+  using Builder = typename BaseClass::template Builder<DynamicDocument>;
+  using P = parsing<InputEncoding>;
+
+public:
+  using ParseResult = typename ErrorHandling::template ErrorOr<
+      std::unique_ptr<cjson::DynamicDocument>>;
+
+  PushParser(const InputEncoding theInEnc = {},
+             const OutputEncoding theOutEnc = {})
+      : itsBuilder{theInEnc, theOutEnc, {}} {}
+
+  /// Parses theChunk as far as possible
+  /// @return false if the input is known to be malformed already. finish()
+  /// reports the error then and further chunks are ignored.
+  bool feed(const std::string_view theChunk) {
+    if (itsError)
+      return false;
+    size_t aPos = 0;
+    if (itsPending != Pending::NONE) {
+      // Complete the token from the previous chunk(s) first
+      const size_t aEnd = itsPending == Pending::STRING
+                              ? findStringEnd(theChunk, 0)
+                          : itsPending == Pending::SCALAR
+                              ? findScalarEnd(theChunk, 0)
+                              : findCharEnd(theChunk);
+      if (aEnd == std::string_view::npos) {
+        itsToken.append(theChunk);
+        itsOffset += theChunk.size();
+        return true;
+      }
+      itsToken.append(theChunk.substr(0, aEnd));
+      aPos = aEnd;
+      if (!finishPendingToken())
+        return false;
+    }
+    while (aPos < theChunk.size()) {
+      const char aChar = theChunk[aPos];
+      if (P::isWhiteSpace(aChar)) {
+        ++aPos;
+        continue;
+      }
+      const auto aAbsPos = static_cast<intptr_t>(itsOffset + aPos);
+      switch (itsState) {
+      case State::FIRST_VALUE:
+        if (aChar == ']') {
+          closeAggregate(false, aAbsPos);
+          ++aPos;
+          continue;
+        }
+        if (!isAscii(aChar)) {
+          if (!readChar(theChunk, aPos))
+            return false;
+          continue;
+        }
+        [[fallthrough]];
+      case State::VALUE:
+        if (aChar == '[' || aChar == '{') {
+          itsBuilder.onOpen(aAbsPos, aChar == '{');
+          itsState = aChar == '{' ? State::FIRST_KEY : State::FIRST_VALUE;
+          ++aPos;
+          continue;
+        }
+        if (aChar == '"' || isScalarChar(aChar)) {
+          if (!readToken(theChunk, aPos))
+            return false;
+          continue;
+        }
+        return fail(ErrorCode::TYPE_DEDUCTION_FAILED, aAbsPos);
+      case State::FIRST_KEY:
+        if (aChar == '}') {
+          closeAggregate(true, aAbsPos);
+          ++aPos;
+          continue;
+        }
+        if (!isAscii(aChar)) {
+          if (!readChar(theChunk, aPos))
+            return false;
+          continue;
+        }
+        [[fallthrough]];
+      case State::KEY:
+        if (aChar != '"')
+          return fail(ErrorCode::OBJECT_KEY_READ_FAILED, aAbsPos);
+        if (!readToken(theChunk, aPos))
+          return false;
+        continue;
+      case State::COLON:
+        if (aChar != ':')
+          return fail(ErrorCode::OBJECT_EXPECTED_COLON, aAbsPos);
+        itsState = State::VALUE;
+        ++aPos;
+        continue;
+      case State::COMMA: {
+        const bool aIsObject = itsBuilder.itsStack.back().itsIsObject;
+        if (aChar == ',') {
+          itsState = aIsObject ? State::KEY : State::VALUE;
+        } else if (aChar == (aIsObject ? '}' : ']')) {
+          closeAggregate(aIsObject, aAbsPos);
+        } else if (!isAscii(aChar)) {
+          if (!readChar(theChunk, aPos))
+            return false;
+          continue;
+        } else {
+          return failBehindValue(aAbsPos);
+        }
+        ++aPos;
+        continue;
+      }
+      case State::DONE:
+        return failBehindValue(aAbsPos);
+      }
+    }
+    itsOffset += theChunk.size();
+    return true;
+  }
+
+  /// Completes the document after the last chunk has been fed
+  ParseResult finish() {
+    using ResultTy = std::unique_ptr<DynamicDocument>;
+    // Scalars (and characters) are only complete at the end of the input
+    if (!itsError &&
+        (itsPending == Pending::SCALAR || itsPending == Pending::CHAR))
+      finishPendingToken();
+    if (!itsError && itsPending == Pending::STRING)
+      fail(isKeyExpected() ? ErrorCode::OBJECT_KEY_READ_FAILED
+                           : ErrorCode::STRING_READ_FAILED,
+           itsTokenPos);
+    if (!itsError && itsState != State::DONE) {
+      // The input ended where the next token was expected
+      const auto aEnd = static_cast<intptr_t>(itsOffset);
+      switch (itsState) {
+      case State::VALUE:
+        fail(ErrorCode::TYPE_DEDUCTION_FAILED, aEnd);
+        break;
+      case State::KEY:
+        fail(ErrorCode::OBJECT_KEY_READ_FAILED, aEnd);
+        break;
+      case State::COLON:
+        fail(ErrorCode::OBJECT_EXPECTED_COLON, aEnd);
+        break;
+      default:
+        fail(itsBuilder.itsStack.back().itsIsObject
+                 ? ErrorCode::OBJECT_UNEXPECTED_TOKEN
+                 : ErrorCode::ARRAY_UNEXPECTED_TOKEN,
+             aEnd);
+      }
+    }
+    // Values which cannot be decoded only count once the input turned out
+    // to be well-formed
+    if (!itsError)
+      itsError = itsDeferredError;
+    if (itsError)
+      return ErrorHandling::template makeError<ResultTy>(itsError->first,
+                                                         itsError->second);
+    auto aDoc = std::make_unique<DynamicDocument>(std::move(itsBuilder.itsDoc));
+    aDoc->buildPropertyIndex();
+    return {std::move(aDoc)};
+  }
+
+private:
+  /// What the next token has to be
+  enum class State {
+    /// any value
+    VALUE,
+    /// a value or the end of the array which has just been opened
+    FIRST_VALUE,
+    /// an object key
+    KEY,
+    /// an object key or the end of the object which has just been opened
+    FIRST_KEY,
+    /// the colon behind an object key
+    COLON,
+    /// a comma or the end of the innermost array/object
+    COMMA,
+    /// nothing, the root value is complete
+    DONE,
+  };
+  /// Kinds of tokens which can be cut off at the end of a chunk
+  enum class Pending { NONE, STRING, SCALAR, CHAR };
+  /// Number of bytes which are enough to decode any character
+  static constexpr size_t MAX_CHAR_WIDTH = 4;
+
+  static constexpr bool isAscii(const char theChar) {
+    return static_cast<unsigned char>(theChar) < 0x80;
+  }
+
+  static constexpr bool isScalarChar(const char theChar) {
+    return (theChar >= '0' && theChar <= '9') ||
+           (theChar >= 'a' && theChar <= 'z') ||
+           (theChar >= 'A' && theChar <= 'Z') || theChar == '-' ||
+           theChar == '+' || theChar == '.';
+  }
+
+  /// @return the index behind the closing quote of the string which
+  /// continues at theChunk[theBegin] or npos if it does not end in theChunk
+  size_t findStringEnd(const std::string_view theChunk, size_t theBegin) {
+    for (size_t aIdx = theBegin; aIdx < theChunk.size(); ++aIdx) {
+      if (itsEscaped) {
+        itsEscaped = false;
+        continue;
+      }
+      aIdx = theChunk.find_first_of("\"\\", aIdx);
+      if (aIdx == std::string_view::npos)
+        return aIdx;
+      if (theChunk[aIdx] == '"')
+        return aIdx + 1;
+      itsEscaped = true;
+    }
+    return std::string_view::npos;
+  }
+
+  /// @return the index behind the scalar which continues at
+  /// theChunk[theBegin] or npos if it may continue in the next chunk
+  static size_t findScalarEnd(const std::string_view theChunk,
+                              size_t theBegin) {
+    while (theBegin < theChunk.size() && isScalarChar(theChunk[theBegin]))
+      ++theBegin;
+    return theBegin < theChunk.size() ? theBegin : std::string_view::npos;
+  }
+
+  /// @return the index behind the bytes that are missing from the character
+  /// in itsToken or npos if it may continue in the next chunk
+  size_t findCharEnd(const std::string_view theChunk) const {
+    const size_t aMissing = MAX_CHAR_WIDTH - itsToken.size();
+    return aMissing < theChunk.size() ? aMissing : std::string_view::npos;
+  }
+
+  /// Reads the non-ASCII character starting at theChunk[thePos], where a
+  /// structural character was expected
+  /// @return false on error, which is always the case once it is complete
+  bool readChar(const std::string_view theChunk, size_t &thePos) {
+    itsTokenPos = static_cast<intptr_t>(itsOffset + thePos);
+    itsToken.assign(theChunk.substr(thePos, MAX_CHAR_WIDTH));
+    thePos += itsToken.size();
+    if (itsToken.size() < MAX_CHAR_WIDTH) {
+      itsPending = Pending::CHAR;
+      return true;
+    }
+    return onChar(itsToken);
+  }
+
+  /// Reads the string or scalar starting at theChunk[thePos] and advances
+  /// thePos behind it. If the token does not end in theChunk, it is kept
+  /// in itsToken instead.
+  /// @return false on error
+  bool readToken(const std::string_view theChunk, size_t &thePos) {
+    const bool aIsString = theChunk[thePos] == '"';
+    itsTokenPos = static_cast<intptr_t>(itsOffset + thePos);
+    const size_t aEnd = aIsString ? findStringEnd(theChunk, thePos + 1)
+                                  : findScalarEnd(theChunk, thePos);
+    if (aEnd == std::string_view::npos) {
+      itsToken.assign(theChunk.substr(thePos));
+      itsPending = aIsString ? Pending::STRING : Pending::SCALAR;
+      thePos = theChunk.size();
+      return true;
+    }
+    const std::string_view aToken = theChunk.substr(thePos, aEnd - thePos);
+    thePos = aEnd;
+    return aIsString ? onString(aToken) : onScalar(aToken);
+  }
+
+  bool finishPendingToken() {
+    const Pending aPending = itsPending;
+    itsPending = Pending::NONE;
+    return aPending == Pending::STRING   ? onString(itsToken)
+           : aPending == Pending::SCALAR ? onScalar(itsToken)
+                                         : onChar(itsToken);
+  }
+
+  bool isKeyExpected() const {
+    return itsState == State::KEY || itsState == State::FIRST_KEY;
+  }
+
+  bool onString(const std::string_view theQuoted) {
+    if (isKeyExpected()) {
+      if (!itsBuilder.onKey(itsTokenPos, theQuoted))
+        return fail(ErrorCode::OBJECT_KEY_READ_FAILED, itsTokenPos);
+      itsState = State::COLON;
+      return true;
+    }
+    if (!itsBuilder.onString(itsTokenPos, theQuoted))
+      return fail(ErrorCode::STRING_READ_FAILED, itsTokenPos);
+    finishValue(itsTokenPos + static_cast<intptr_t>(theQuoted.size()));
+    return true;
+  }
+
+  bool onScalar(const std::string_view theScalar) {
+    const P p{itsBuilder.itsSrcEnc};
+    const std::optional<typename P::Type> aType =
+        p.detectElementType(theScalar);
+    if (!aType)
+      return fail(ErrorCode::TYPE_DEDUCTION_FAILED, itsTokenPos);
+    const ErrorCode aCode = *aType == P::Type::NUL
+                                ? ErrorCode::NULL_READ_FAILED
+                            : *aType == P::Type::BOOL
+                                ? ErrorCode::BOOL_READ_FAILED
+                                : ErrorCode::NUMBER_READ_FAILED;
+    // Like DocumentInfo::compute, the scalar ends where its syntax does,
+    // e.g. "1null" is the number 1 followed by "null"
+    const auto aLen = static_cast<intptr_t>(
+        *aType == P::Type::NUL    ? p.readNull(theScalar).size()
+        : *aType == P::Type::BOOL ? p.parseBool(theScalar).second
+                                  : p.readNumber(theScalar).size());
+    if (aLen <= 0)
+      return fail(aCode, itsTokenPos);
+    if (itsBuilder.addScalar(*aType, theScalar.substr(0, aLen)) != aLen &&
+        !itsDeferredError)
+      itsDeferredError = std::make_pair(aCode, itsTokenPos);
+    finishValue(itsTokenPos + aLen);
+    if (aLen == static_cast<intptr_t>(theScalar.size()))
+      return true;
+    return failBehindValue(itsTokenPos + aLen);
+  }
+
+  /// Like DocumentParser2, tells apart characters which cannot be decoded at
+  /// all from those which are just not what has been expected
+  bool onChar(const std::string_view theChar) {
+    const bool aIsObject = itsBuilder.itsStack.back().itsIsObject;
+    if (itsBuilder.itsSrcEnc.decodeFirst(theChar).second <= 0)
+      return fail(aIsObject ? ErrorCode::OBJECT_UNEXPECTED_TOKEN
+                            : ErrorCode::ARRAY_UNEXPECTED_TOKEN,
+                  itsTokenPos);
+    if (itsState == State::COMMA)
+      return failBehindValue(itsTokenPos);
+    return fail(aIsObject ? ErrorCode::OBJECT_KEY_READ_FAILED
+                          : ErrorCode::TYPE_DEDUCTION_FAILED,
+                itsTokenPos);
+  }
+
+  void closeAggregate(const bool theIsObject, const intptr_t thePos) {
+    itsBuilder.onClose(theIsObject);
+    finishValue(thePos + 1);
+  }
+
+  /// @param theEnd position behind the value
+  void finishValue(const intptr_t theEnd) {
+    itsState = itsBuilder.itsStack.empty() ? State::DONE : State::COMMA;
+    if (itsState == State::DONE)
+      itsDocSize = theEnd;
+  }
+
+  /// Reports the unexpected token at thePos behind a complete value
+  bool failBehindValue(const intptr_t thePos) {
+    if (itsState == State::DONE)
+      return fail(ErrorCode::TRAILING_CONTENT, itsDocSize);
+    return fail(itsBuilder.itsStack.back().itsIsObject
+                    ? ErrorCode::OBJECT_EXPECTED_COMMA
+                    : ErrorCode::ARRAY_EXPECTED_COMMA,
+                thePos);
+  }
+
+  bool fail(const ErrorCode theCode, const intptr_t thePos) {
+    itsError = std::make_pair(theCode, thePos);
+    return false;
+  }
+
+  Builder itsBuilder;
+  State itsState = State::VALUE;
+  /// Beginning of a token which is continued by the next chunk
+  std::string itsToken;
+  Pending itsPending = Pending::NONE;
+  /// Whether the next character of the current string is escaped
+  bool itsEscaped = false;
+  /// Position of the current token in the whole input
+  intptr_t itsTokenPos = 0;
+  /// Position of the current chunk in the whole input
+  size_t itsOffset = 0;
+  /// Position behind the root value once it is complete
+  intptr_t itsDocSize = 0;
+  std::optional<std::pair<ErrorCode, intptr_t>> itsError;
+  /// The first value that is well-formed but could not be added
+  std::optional<std::pair<ErrorCode, intptr_t>> itsDeferredError;
+};
+} // namespace cjson
+#endif // CONSTEXPR_JSON_PUSH_PARSER_H
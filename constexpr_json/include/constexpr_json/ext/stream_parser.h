@@ -3,10 +3,10 @@
 
 #include "constexpr_json/dynamic_document.h"
 #include "constexpr_json/ext/error_is_detail.h"
+#include "constexpr_json/ext/push_parser.h"
 
 #include <istream>
 #include <optional>
-#include <sstream>
 #include <string>
 
 namespace cjson {
@@ -23,28 +23,58 @@ struct StreamParser {
   /// Hold the parsing result iff there is no error reading the input stream.
   using Result = std::optional<ParserParseResult>;
 
+  /// Parses the document while it is being read from theStream (see
+  /// PushParser) if InputEncoding is ASCII-compatible. Otherwise, the whole
+  /// input is read first.
+  /// @param theJsonOut receives a copy of the input if not null
   /// @return nullopt in case there was an error reading from the stream.
   ///         Parsing result otherwise.
   static Result parse(std::istream &theStream,
                       std::string *theJsonOut = nullptr,
                       const InputEncoding theInEnc = {},
                       const OutputEncoding theOutEnc = {}) {
-    std::stringstream aSS;
-    size_t aBufSize{1024u};
-    std::string aBuf(aBufSize, '\0');
-    while (!theStream.eof()) {
-      theStream.read(aBuf.data(), aBufSize - 1);
-      if (theStream.bad())
+    if (theJsonOut)
+      theJsonOut->clear();
+    if constexpr (impl::IsAsciiCompatible<InputEncoding>::value) {
+      PushParser<ErrorHandling, InputEncoding, OutputEncoding> aParser{
+          theInEnc, theOutEnc};
+      const bool aReadOk =
+          readChunks(theStream, [&](const std::string_view theChunk) {
+            if (theJsonOut)
+              theJsonOut->append(theChunk);
+            aParser.feed(theChunk);
+          });
+      if (!aReadOk)
+        return std::nullopt;
+      return aParser.finish();
+    } else {
+      std::string aJsonStr;
+      std::string &aJson = theJsonOut ? *theJsonOut : aJsonStr;
+      if (!readChunks(theStream, [&](const std::string_view theChunk) {
+            aJson.append(theChunk);
+          }))
         return std::nullopt;
-      const auto aReadLen = static_cast<size_t>(theStream.gcount());
-      aBuf[aReadLen] = '\0';
-      aSS << std::string_view{aBuf.data(), aReadLen};
+      return cjson::DynamicDocument::parseJson<ParserTy>(aJson, theInEnc,
+                                                         theOutEnc);
     }
-    std::string aJsonStr = aSS.str();
-    if (theJsonOut)
-      *theJsonOut = std::move(aJsonStr);
-    return cjson::DynamicDocument::parseJson<ParserTy>(
-        theJsonOut ? *theJsonOut : aJsonStr, theInEnc, theOutEnc);
+  }
+
+private:
+  static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+  /// Passes the contents of theStream to theFn piece by piece
+  /// @return false if reading failed
+  template <typename FnTy>
+  static bool readChunks(std::istream &theStream, FnTy &&theFn) {
+    std::string aBuf(BUFFER_SIZE, '\0');
+    while (theStream) {
+      theStream.read(aBuf.data(), aBuf.size());
+      if (theStream.bad())
+        return false;
+      theFn(std::string_view{aBuf.data(),
+                             static_cast<size_t>(theStream.gcount())});
+    }
+    return true;
   }
 };
 } // namespace cjson
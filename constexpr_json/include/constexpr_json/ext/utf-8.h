@@ -7,6 +7,9 @@
 namespace cjson {
 struct Utf8 {
   using CodePointTy = uint64_t;
+  /// Bytes < 0x80 never occur inside multi-byte sequences, so structural
+  /// characters can be found byte by byte
+  static constexpr bool ASCII_COMPATIBLE = true;
   constexpr std::pair<CodePointTy, size_t>
   decodeFirst(std::string_view theString) const noexcept {
     const auto aError = std::make_pair(CodePointTy{0}, size_t{0});
@@ -0,0 +1,87 @@
+#ifndef CONSTEXPR_JSON_ASCII_SCANNING_H
+#define CONSTEXPR_JSON_ASCII_SCANNING_H
+
+#include "constexpr_json/impl/compiler_support.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+namespace cjson {
+namespace impl {
+/// Detects encodings which declare themselves ASCII_COMPATIBLE, i.e. which
+/// encode every ASCII character as the single byte of the same value and never
+/// use such bytes inside longer sequences. Documents in these encodings can be
+/// scanned for structural characters byte by byte.
+template <typename EncodingTy, typename = void>
+struct IsAsciiCompatible : std::false_type {};
+template <typename EncodingTy>
+struct IsAsciiCompatible<EncodingTy,
+                         std::void_t<decltype(EncodingTy::ASCII_COMPATIBLE)>>
+    : std::bool_constant<EncodingTy::ASCII_COMPATIBLE> {};
+
+/// Runtime-only scan for the end of a run of "plain" string characters
+///
+/// Plain characters are printable ASCII characters except for '"' and '\\'.
+/// Inside of json strings, they stand for themselves and can be copied to any
+/// ASCII-compatible encoding as they are.
+///
+/// @return the number of plain bytes at the front of theString
+inline size_t countPlainAscii(const std::string_view theString) noexcept {
+  const char *const aBegin = theString.data();
+  const char *const aEnd = aBegin + theString.size();
+  const char *aCurrent = aBegin;
+#if defined(CJSON_AVX2)
+  for (; aEnd - aCurrent >= 32; aCurrent += 32) {
+    const __m256i aChars =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(aCurrent));
+    // The signed comparison also catches all bytes >= 0x80
+    const __m256i aSpecial = _mm256_or_si256(
+        _mm256_cmpgt_epi8(_mm256_set1_epi8(0x20), aChars),
+        _mm256_or_si256(_mm256_cmpeq_epi8(aChars, _mm256_set1_epi8('"')),
+                        _mm256_cmpeq_epi8(aChars, _mm256_set1_epi8('\\'))));
+    const auto aMask = static_cast<uint32_t>(_mm256_movemask_epi8(aSpecial));
+    if (aMask)
+      return aCurrent - aBegin + countTrailingZeros(aMask);
+  }
+#elif defined(CJSON_SSE2)
+  for (; aEnd - aCurrent >= 16; aCurrent += 16) {
+    const __m128i aChars =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(aCurrent));
+    // The signed comparison also catches all bytes >= 0x80
+    const __m128i aSpecial = _mm_or_si128(
+        _mm_cmplt_epi8(aChars, _mm_set1_epi8(0x20)),
+        _mm_or_si128(_mm_cmpeq_epi8(aChars, _mm_set1_epi8('"')),
+                     _mm_cmpeq_epi8(aChars, _mm_set1_epi8('\\'))));
+    const auto aMask = static_cast<uint32_t>(_mm_movemask_epi8(aSpecial));
+    if (aMask)
+      return aCurrent - aBegin + countTrailingZeros(aMask);
+  }
+#endif
+  // Eight bytes at a time, see "Bit Twiddling Hacks" for the zero-byte tests.
+  // These may report bytes behind the first special one, but never miss it.
+  constexpr uint64_t ONES = 0x0101010101010101ULL;
+  constexpr uint64_t HIGH_BITS = 0x8080808080808080ULL;
+  for (; aEnd - aCurrent >= 8; aCurrent += 8) {
+    uint64_t aWord;
+    std::memcpy(&aWord, aCurrent, sizeof(aWord));
+    const auto hasZeroByte = [](const uint64_t theWord) {
+      return (theWord - ONES) & ~theWord & HIGH_BITS;
+    };
+    const uint64_t aSpecial = hasZeroByte(aWord ^ (ONES * '"')) |
+                              hasZeroByte(aWord ^ (ONES * '\\')) |
+                              (((aWord - ONES * 0x20) | aWord) & HIGH_BITS);
+    if (aSpecial)
+      break;
+  }
+  for (; aCurrent != aEnd; ++aCurrent) {
+    const auto aByte = static_cast<unsigned char>(*aCurrent);
+    if (aByte < 0x20 || aByte >= 0x80 || aByte == '"' || aByte == '\\')
+      break;
+  }
+  return aCurrent - aBegin;
+}
+} // namespace impl
+} // namespace cjson
+#endif // CONSTEXPR_JSON_ASCII_SCANNING_H
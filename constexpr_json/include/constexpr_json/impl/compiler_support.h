@@ -0,0 +1,88 @@
+#ifndef CONSTEXPR_JSON_COMPILER_SUPPORT_H
+#define CONSTEXPR_JSON_COMPILER_SUPPORT_H
+
+#include <cstdint>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+/// SIMD instruction sets enabled for the target. Runtime fast paths use the
+/// widest one available and fall back to portable code otherwise.
+#if defined(__AVX2__)
+#define CJSON_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) ||                                  \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CJSON_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(__PCLMUL__)
+#include <wmmintrin.h>
+#endif
+
+/// CJSON_IS_CONSTANT_EVALUATED() allows constexpr functions to dispatch to
+/// runtime-only fast paths (SIMD, memcpy, heap-allocated scratch buffers)
+/// while keeping the plain algorithms for constant evaluation.
+///
+/// If the compiler cannot tell, we always take the constexpr-safe path.
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define CJSON_HAS_IS_CONSTANT_EVALUATED 1
+#endif
+#endif
+#if !defined(CJSON_HAS_IS_CONSTANT_EVALUATED) &&                              \
+    ((defined(__GNUC__) && __GNUC__ >= 9) ||                                   \
+     (defined(_MSC_VER) && _MSC_VER >= 1925))
+#define CJSON_HAS_IS_CONSTANT_EVALUATED 1
+#endif
+
+#ifdef CJSON_HAS_IS_CONSTANT_EVALUATED
+#define CJSON_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#else
+#define CJSON_IS_CONSTANT_EVALUATED() true
+#endif
+
+/// Whether the target stores the least significant byte of a word first
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) ||  \
+    defined(_MSC_VER)
+#define CJSON_LITTLE_ENDIAN 1
+#endif
+
+namespace cjson {
+namespace impl {
+/// @return the index of the lowest set bit. theValue must not be 0.
+inline int countTrailingZeros(const uint64_t theValue) noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long aIdx;
+  _BitScanForward64(&aIdx, theValue);
+  return static_cast<int>(aIdx);
+#else
+  return __builtin_ctzll(theValue);
+#endif
+}
+
+/// @return the number of leading zero bits. theValue must not be 0. Unlike
+/// the other bit helpers, this one is also usable in constant expressions.
+constexpr int countLeadingZeros(const uint64_t theValue) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_clzll(theValue);
+#else
+  int aCount = 0;
+  for (uint64_t aBit = uint64_t{1} << 63; !(theValue & aBit); aBit >>= 1)
+    ++aCount;
+  return aCount;
+#endif
+}
+
+/// @return the number of set bits in theValue
+inline int popCount(const uint64_t theValue) noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+  return static_cast<int>(__popcnt64(theValue));
+#else
+  return __builtin_popcountll(theValue);
+#endif
+}
+} // namespace impl
+} // namespace cjson
+#endif // CONSTEXPR_JSON_COMPILER_SUPPORT_H
@@ -1,7 +1,11 @@
 #ifndef CONSTEXPR_JSON_DOCUMENT_ACCESS_H
 #define CONSTEXPR_JSON_DOCUMENT_ACCESS_H
+#include "constexpr_json/impl/compiler_support.h"
 #include "constexpr_json/impl/document_entities.h"
+#include "constexpr_json/impl/hashing.h"
 
+#include <algorithm>
+#include <cstring>
 #include <map>
 #include <vector>
 
@@ -9,6 +13,29 @@ namespace cjson {
 namespace impl {
 template <typename DocumentTy> struct EntityRefImpl;
 
+/// Computes the hash of theEntity of theDoc (see EntityRefImpl::hash) and
+/// calls theOnContainer with the hash of every array and object in it that
+/// theDoc has not cached
+template <typename DocumentTy, typename CallbackTy>
+uint64_t hashEntity(const DocumentTy &theDoc, const Entity &theEntity,
+                    CallbackTy &theOnContainer);
+
+/// @return the properties of theObject sorted by key, with properties of the
+/// same key in document order
+template <typename ObjectRefTy>
+std::vector<typename ObjectRefTy::iterator::value_type>
+sortProperties(const ObjectRefTy &theObject) {
+  std::vector<typename ObjectRefTy::iterator::value_type> aProps;
+  aProps.reserve(theObject.size());
+  for (const auto aProp : theObject)
+    aProps.push_back(aProp);
+  std::stable_sort(aProps.begin(), aProps.end(),
+                   [](const auto &theLhs, const auto &theRhs) {
+                     return theLhs.first < theRhs.first;
+                   });
+  return aProps;
+}
+
 template <typename DocumentTy> struct ArrayIteratorImpl {
   constexpr ArrayIteratorImpl() noexcept = default;
   constexpr ArrayIteratorImpl(const DocumentTy &theDoc,
@@ -42,7 +69,7 @@ template <typename DocumentTy> struct ArrayRefImpl {
   constexpr iterator end() const { return {*itsDoc, itsBegin + size()}; }
   constexpr EntityRefImpl<DocumentTy> operator[](size_t theIdx) const;
   template <typename OtherRefTy>
-  constexpr bool operator==(const OtherRefTy &theOther) const noexcept {
+  constexpr bool operator==(const OtherRefTy &theOther) const {
     if (size() != theOther.size())
       return false;
     auto aOtherIter = theOther.begin();
@@ -102,14 +129,26 @@ template <typename DocumentTy> struct ObjectRefImpl {
   constexpr iterator begin() const { return {*itsDoc, itsObjectIdx, 0}; }
   constexpr iterator end() const { return {*itsDoc, itsObjectIdx, size()}; }
   constexpr std::optional<EntityRef> operator[](std::string_view theKey) const;
-  template<typename OtherRefTy>
-  constexpr bool operator==(const OtherRefTy &theOther) const noexcept {
+  /// Objects are equal if they have the same keys and the same values for
+  /// each of them, regardless of the order of their properties. Properties
+  /// with the same key are compared in document order.
+  ///
+  /// Large objects whose properties are in different orders are compared by
+  /// sorting copies of their properties, so this may throw std::bad_alloc.
+  template <typename OtherRefTy>
+  constexpr bool operator==(const OtherRefTy &theOther) const {
     if (size() != theOther.size())
       return false;
+    // Objects of the same shape list their keys in the same order, which
+    // lets us compare them without any lookups
+    auto aOtherIter = theOther.begin();
     for (const auto aKVPair : *this) {
-      const auto aOtherVal = theOther[aKVPair.first];
-      if (!aOtherVal || !(aKVPair.second == *aOtherVal))
+      const auto aOtherKVPair = *aOtherIter;
+      if (aKVPair.first != aOtherKVPair.first)
+        return equalsUnordered(theOther);
+      if (!(aKVPair.second == aOtherKVPair.second))
         return false;
+      ++aOtherIter;
     }
     return true;
   }
@@ -120,6 +159,46 @@ template <typename DocumentTy> struct ObjectRefImpl {
   constexpr bool empty() const { return !size(); }
 
 private:
+  /// Minimum number of properties for which sorting the properties of both
+  /// objects is cheaper than searching for each of them
+  static constexpr size_t SORTED_COMPARISON_THRESHOLD = 8;
+
+  template <typename OtherRefTy>
+  constexpr bool equalsUnordered(const OtherRefTy &theOther) const {
+    if (!CJSON_IS_CONSTANT_EVALUATED() &&
+        size() >= SORTED_COMPARISON_THRESHOLD) {
+      const auto aProps = sortProperties(*this);
+      const auto aOtherProps = sortProperties(theOther);
+      for (size_t aIdx = 0; aIdx < aProps.size(); ++aIdx) {
+        if (aProps[aIdx].first != aOtherProps[aIdx].first ||
+            !(aProps[aIdx].second == aOtherProps[aIdx].second))
+          return false;
+      }
+      return true;
+    }
+    // Match the n-th property with a key in this object with the n-th
+    // property with that key in theOther
+    for (size_t aPropIdx = 0; aPropIdx < size(); ++aPropIdx) {
+      const auto [aKey, aValuePtr] =
+          itsDoc->getProperty(itsObjectIdx, aPropIdx);
+      size_t aRank = 0;
+      for (size_t aPrevIdx = 0; aPrevIdx < aPropIdx; ++aPrevIdx)
+        aRank += itsDoc->getProperty(itsObjectIdx, aPrevIdx).first == aKey;
+      bool aFound = false;
+      for (const auto aOtherKVPair : theOther) {
+        if (aOtherKVPair.first != aKey || aRank--)
+          continue;
+        if (!(EntityRef{*itsDoc, *aValuePtr} == aOtherKVPair.second))
+          return false;
+        aFound = true;
+        break;
+      }
+      if (!aFound)
+        return false;
+    }
+    return true;
+  }
+
   const DocumentTy *itsDoc;
   intptr_t itsObjectIdx = 0;
 };
@@ -139,9 +218,17 @@ public:
   using ObjectRef = ObjectRefImpl<DocumentTy>;
 
   template <typename OtherRefTy>
-  constexpr bool operator==(const OtherRefTy &theOther) const noexcept {
+  constexpr bool operator==(const OtherRefTy &theOther) const {
     if (theOther.getType() != getType())
       return false;
+    if (!CJSON_IS_CONSTANT_EVALUATED()) {
+      // Arrays and objects whose cached hashes differ cannot be equal
+      const uint64_t *const aHash = itsDoc->findStructuralHash(*itsEntity);
+      const uint64_t *const aOtherHash =
+          theOther.itsDoc->findStructuralHash(*theOther.itsEntity);
+      if (aHash && aOtherHash && *aHash != *aOtherHash)
+        return false;
+    }
     switch (getType()) {
     case Entity::NUL:
       return true;
@@ -153,23 +240,41 @@ public:
       return toNumber() == theOther.toNumber();
     case Entity::OBJECT:
       return toObject() == theOther.toObject();
-      break;
     case Entity::STRING:
       return toString() == theOther.toString();
     }
     return false;
   }
   template <typename OtherRefTy>
-  constexpr bool operator!=(const OtherRefTy &theOther) const noexcept {
+  constexpr bool operator!=(const OtherRefTy &theOther) const {
     return !(*this == theOther);
   }
 
-  constexpr Entity::KIND getType() const { return itsEntity->itsKind; }
+  /// @return a hash of the value, which is the same for equal values of any
+  /// document. Hashes of arrays and objects which the document has cached
+  /// are reused (see DocumentBase::buildStructuralHashes), all others are
+  /// computed on every call.
+  uint64_t hash() const {
+    const auto aIgnore = [](const Entity &, uint64_t) {};
+    return hashEntity(*itsDoc, *itsEntity, aIgnore);
+  }
+
+  /// @return the document the value is part of and its entity there
+  /// @{
+  constexpr const DocumentTy &getDocument() const noexcept { return *itsDoc; }
+  constexpr const Entity &getEntity() const noexcept { return *itsEntity; }
+  /// @}
+
+  constexpr Entity::KIND getType() const { return itsEntity->getKind(); }
   constexpr bool toBool() const { return itsEntity->itsPayload; }
   constexpr double toNumber() const {
+    if (itsEntity->itsKind == Entity::INLINE_NUMBER)
+      return itsEntity->getInlineNumber();
     return itsDoc->getNumber(itsEntity->itsPayload);
   }
   constexpr std::string_view toString() const {
+    if (itsEntity->itsKind == Entity::INLINE_STRING)
+      return itsEntity->getInlineString();
     return itsDoc->getString(itsEntity->itsPayload);
   }
   constexpr ArrayRef toArray() const { return ArrayRef{*itsDoc, *itsEntity}; }
@@ -198,6 +303,8 @@ public:
   }
 
 private:
+  template <typename> friend struct EntityRefImpl;
+
   const DocumentTy *itsDoc = {};
   const Entity *itsEntity = nullptr;
 };
@@ -230,6 +337,52 @@ ObjectRefImpl<DocumentTy>::operator[](std::string_view theKey) const {
   return EntityRef{*itsDoc, *aPropPtr};
 }
 
+template <typename DocumentTy, typename CallbackTy>
+uint64_t hashEntity(const DocumentTy &theDoc, const Entity &theEntity,
+                    CallbackTy &theOnContainer) {
+  const EntityRefImpl<DocumentTy> aRef{theDoc, theEntity};
+  switch (aRef.getType()) {
+  case Entity::NUL:
+    return combineHashes(Entity::NUL, 0);
+  case Entity::BOOL:
+    return combineHashes(Entity::BOOL, aRef.toBool());
+  case Entity::NUMBER: {
+    // -0 equals 0, so both need the same hash
+    const double aNumber = aRef.toNumber() == 0. ? 0. : aRef.toNumber();
+    uint64_t aBits;
+    std::memcpy(&aBits, &aNumber, sizeof(aBits));
+    return combineHashes(Entity::NUMBER, aBits);
+  }
+  case Entity::STRING:
+    return combineHashes(Entity::STRING, hashString(aRef.toString()));
+  case Entity::ARRAY:
+  case Entity::OBJECT:
+    break;
+  }
+  if (const uint64_t *const aCached = theDoc.findStructuralHash(theEntity))
+    return *aCached;
+  const intptr_t aIdx = theEntity.itsPayload;
+  uint64_t aHash;
+  if (theEntity.getKind() == Entity::ARRAY) {
+    aHash = combineHashes(Entity::ARRAY, theDoc.array_size(aIdx));
+    for (const Entity *aIter = theDoc.array_begin(aIdx),
+                      *aEnd = theDoc.array_end(aIdx);
+         aIter != aEnd; ++aIter)
+      aHash = combineHashes(aHash, hashEntity(theDoc, *aIter, theOnContainer));
+  } else {
+    // Adding up the hashes of the properties makes their order irrelevant
+    const size_t aNumProps = theDoc.getNumProperties(aIdx);
+    uint64_t aSum = 0;
+    for (size_t aPropIdx = 0; aPropIdx < aNumProps; ++aPropIdx) {
+      const auto [aKey, aValuePtr] = theDoc.getProperty(aIdx, aPropIdx);
+      aSum += combineHashes(hashString(aKey),
+                            hashEntity(theDoc, *aValuePtr, theOnContainer));
+    }
+    aHash = combineHashes(combineHashes(Entity::OBJECT, aNumProps), aSum);
+  }
+  theOnContainer(theEntity, aHash);
+  return aHash;
+}
 } // namespace impl
 } // namespace cjson
 #endif // CONSTEXPR_JSON_DOCUMENT_ACCESS_H
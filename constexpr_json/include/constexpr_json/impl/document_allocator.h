@@ -3,16 +3,31 @@
 
 #include "constexpr_json/document_info.h"
 #include "constexpr_json/impl/document_access.h"
+#include "constexpr_json/impl/key_interning.h"
 #include "constexpr_json/impl/parsing_utils.h"
 
+#include <cstring>
+
 namespace cjson {
 template <typename DocTy, typename ErrorHandlingTy>
-struct DocumentAllocator : private DocumentInfo {
+struct DocumentAllocator
+    : private DocumentInfo,
+      private impl::KeyInterning<DocTy::Storage::INTERNS_KEYS> {
   using EntityRef = typename DocTy::EntityRef;
   using ObjectRef = typename EntityRef::ObjectRef;
   using ArrayRef = typename EntityRef::ArrayRef;
 
+  /// Registers the JSON input that strings of borrowing documents are
+  /// referenced in
+  constexpr void borrowFrom(const std::string_view theSource) {
+    itsSource = theSource;
+  }
+
   constexpr Entity allocateNumber(DocTy &theDoc, const double theNumber) {
+    if constexpr (DocTy::Storage::INLINES_SCALARS) {
+      if (const auto aInline = Entity::makeInlineNumber(theNumber))
+        return *aInline;
+    }
     theDoc.itsNumbers[itsNumNumbers] = theNumber;
     return {Entity::NUMBER, itsNumNumbers++};
   }
@@ -25,9 +40,34 @@ struct DocumentAllocator : private DocumentInfo {
     std::string_view aStr = theString;
     using P = parsing<SourceEncodingTy>;
     const P p{theSrcEnc};
+    if constexpr (DocTy::Storage::IS_BORROWING) {
+      static_assert(std::is_same_v<SourceEncodingTy, DestEncodingTy>,
+                    "Borrowing documents cannot transcode strings");
+      if (p.isVerbatimString(aStr)) {
+        const intptr_t aOffset = aStr.data() - itsSource.data();
+        using Indices = typename DocTy::Indices;
+        theDoc.itsStrings[itsNumStrings] = typename DocTy::String{
+            static_cast<typename Indices::Position>(~aOffset),
+            static_cast<typename Indices::Size>(aStr.size())};
+        return Entity{Entity::STRING, itsNumStrings++};
+      }
+      // Unescaping never makes a string longer
+      theDoc.itsChars.resize(itsNumChars + aStr.size());
+    }
     size_t aNumBytesInStr = 0;
     theDoc.itsStrings[itsNumStrings].itsPosition = itsNumChars;
     while (aStr.size()) {
+      if constexpr (impl::IsAsciiCompatible<DestEncodingTy>::value) {
+        // Copy runs of plain ASCII chars in one go (runtime only)
+        if (const size_t aNumPlain = P::countPlainStringBytes(aStr)) {
+          std::memcpy(theDoc.itsChars.data() + itsNumChars, aStr.data(),
+                      aNumPlain);
+          itsNumChars += aNumPlain;
+          aNumBytesInStr += aNumPlain;
+          aStr.remove_prefix(aNumPlain);
+          continue;
+        }
+      }
       const auto [aChar, aCharWidth] = theSrcEnc.decodeFirst(aStr);
       if (aCharWidth <= 0)
         return makeError("Failed to decode character");
@@ -47,12 +87,80 @@ struct DocumentAllocator : private DocumentInfo {
         theDoc.itsChars[itsNumChars++] = aBytes[i];
       aNumBytesInStr += aBytesUsed;
     }
+    if constexpr (DocTy::Storage::IS_BORROWING)
+      theDoc.itsChars.resize(itsNumChars);
     theDoc.itsStrings[itsNumStrings].itsSize = aNumBytesInStr;
     return Entity{Entity::STRING, itsNumStrings++};
   }
 
+  /// Allocates an object key like allocateTranscodeString. If
+  /// DocTy::Storage::INTERNS_KEYS, a key which is equal to one allocated before
+  /// is not stored again but references the String of the first one.
+  template <typename SourceEncodingTy, typename DestEncodingTy>
+  constexpr typename ErrorHandlingTy::template ErrorOr<Entity>
+  allocateKey(DocTy &theDoc, const std::string_view &theKey,
+              const SourceEncodingTy &theSrcEnc,
+              const DestEncodingTy &theDestEnc) {
+    auto aResult = allocateTranscodeString(theDoc, theKey, theSrcEnc,
+                                           theDestEnc);
+    if constexpr (DocTy::Storage::INTERNS_KEYS) {
+      if (ErrorHandlingTy::isError(aResult))
+        return aResult;
+      const intptr_t aStrIdx = ErrorHandlingTy::unwrap(aResult).itsPayload;
+      const intptr_t aInterned =
+          this->itsKeyInterner.intern(theDoc, itsSource, aStrIdx);
+      if (aInterned != aStrIdx) {
+        releaseLastString(theDoc);
+        return Entity{Entity::STRING, aInterned};
+      }
+    }
+    return aResult;
+  }
+
+  /// Allocates a string value like allocateTranscodeString. If
+  /// DocTy::Storage::INLINES_SCALARS, short strings are stored in the
+  /// returned Entity instead.
+  template <typename SourceEncodingTy, typename DestEncodingTy>
+  constexpr typename ErrorHandlingTy::template ErrorOr<Entity>
+  allocateString(DocTy &theDoc, const std::string_view &theString,
+                 const SourceEncodingTy &theSrcEnc,
+                 const DestEncodingTy &theDestEnc) {
+    auto aResult = allocateTranscodeString(theDoc, theString, theSrcEnc,
+                                           theDestEnc);
+    if constexpr (DocTy::Storage::INLINES_SCALARS) {
+      if (ErrorHandlingTy::isError(aResult))
+        return aResult;
+      const auto aInline = Entity::makeInlineString(impl::peekString(
+          theDoc, itsSource, ErrorHandlingTy::unwrap(aResult).itsPayload));
+      if (aInline) {
+        releaseLastString(theDoc);
+        return *aInline;
+      }
+    }
+    return aResult;
+  }
+
+  /// Gives back the parts of the buffers of theDoc which were allocated for
+  /// keys and values that have been interned or inlined (see allocateKey and
+  /// allocateString)
+  void releaseUnused(DocTy &theDoc) {
+    if constexpr (DocTy::Storage::INTERNS_KEYS ||
+                  DocTy::Storage::INLINES_SCALARS) {
+      theDoc.itsNumbers.resize(itsNumNumbers);
+      theDoc.itsChars.resize(itsNumChars);
+      theDoc.itsStrings.resize(itsNumStrings);
+    }
+    // Duplicate keys are common enough to be worth the copy
+    if constexpr (DocTy::Storage::INTERNS_KEYS) {
+      theDoc.itsChars.shrink_to_fit();
+      theDoc.itsStrings.shrink_to_fit();
+    }
+  }
+
   constexpr Entity allocateRawString(DocTy &theDoc,
                                      const std::string_view theString) {
+    if constexpr (DocTy::Storage::IS_BORROWING)
+      theDoc.itsChars.resize(itsNumChars + theString.size());
     for (size_t aCharIdx = 0; aCharIdx < theString.size(); ++aCharIdx)
       theDoc.itsChars[itsNumChars + aCharIdx] = theString[aCharIdx];
     theDoc.itsStrings[itsNumStrings].itsPosition = itsNumChars;
@@ -82,24 +190,27 @@ struct DocumentAllocator : private DocumentInfo {
     case Entity::ARRAY: {
       ptrdiff_t aIdx{0};
       const Entity aEntity = allocateArray(theDoc, theJson.toArray().size());
-      const Array &aArray = theDoc.itsArrays[aEntity.itsPayload];
+      const auto &aArray = theDoc.itsArrays[aEntity.itsPayload];
       for (const auto &aElement : theJson.toArray()) {
         theDoc.itsEntities[aArray.itsPosition + aIdx] =
             allocateJson(theDoc, aElement);
+        ++aIdx;
       }
       return aEntity;
     }
     case Entity::OBJECT: {
       ptrdiff_t aIdx{0};
       const Entity aEntity = allocateObject(theDoc, theJson.toObject().size());
-      const Object &aObj = theDoc.itsObjects[aEntity.itsPayload];
+      const auto &aObj = theDoc.itsObjects[aEntity.itsPayload];
       for (const auto &aKVPair : theJson.toObject()) {
-        Property &aProp = theDoc.itsObjectProps[aObj.itsKeysPos + aIdx];
+        auto &aProp = theDoc.itsObjectProps[aObj.itsKeysPos + aIdx];
         aProp.itsKeyPos = allocateRawString(theDoc, aKVPair.first).itsPayload;
         theDoc.itsEntities[aObj.itsValuesPos + aIdx] =
             allocateJson(theDoc, aKVPair.second);
         ++aIdx;
       }
+      if constexpr (DocTy::Storage::SORTS_KEYS)
+        theDoc.sortKeys(aEntity.itsPayload);
       return aEntity;
     }
     case Entity::NUL:
@@ -122,6 +233,18 @@ struct DocumentAllocator : private DocumentInfo {
       -> typename ErrorHandlingTy::template ErrorOr<Entity> {
     return ErrorHandlingTy::template makeError<Entity>(theCode, -1);
   }
+
+private:
+  /// Takes back the most recently allocated string
+  void releaseLastString(DocTy &theDoc) {
+    const auto &aStr = theDoc.itsStrings[--itsNumStrings];
+    if (aStr.itsPosition >= 0)
+      itsNumChars = aStr.itsPosition;
+    if constexpr (DocTy::Storage::IS_BORROWING)
+      theDoc.itsChars.resize(itsNumChars);
+  }
+
+  std::string_view itsSource;
 };
 } // namespace cjson
 #endif // CONSTEXPR_JSON_DOCUMENT_ALLOCATOR_H
@@ -1,27 +1,136 @@
 #ifndef CONSTEXPR_JSON_DOCUMENT_ENTITIES_H
 #define CONSTEXPR_JSON_DOCUMENT_ENTITIES_H
+#include "constexpr_json/impl/compiler_support.h"
+
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string_view>
 
 namespace cjson {
+/// Kind and payload share a single word, so that the entities, which make up
+/// the bulk of most documents, need 8 bytes each
 struct Entity {
-  enum KIND { NUL = 0, ARRAY, BOOL, NUMBER, OBJECT, STRING } itsKind = NUL;
-  intptr_t itsPayload = 0;
+  enum KIND : uint64_t { NUL = 0, ARRAY, BOOL, NUMBER, OBJECT, STRING };
+  /// Numbers and strings which are stored in the payload itself instead of
+  /// the buffers of the document (see Storage::INLINES_SCALARS). getKind()
+  /// reports them as NUMBER and STRING.
+  /// @{
+  static constexpr KIND INLINE_NUMBER = static_cast<KIND>(6);
+  static constexpr KIND INLINE_STRING = static_cast<KIND>(7);
+  /// @}
+  static constexpr size_t MAX_INLINE_STRING_SIZE = 7;
+
+  KIND itsKind : 3;
+  int64_t itsPayload : 61;
+
+  constexpr KIND getKind() const noexcept {
+    return itsKind == INLINE_NUMBER   ? NUMBER
+           : itsKind == INLINE_STRING ? STRING
+                                      : itsKind;
+  }
+
+  /// Numbers are stored inline if the three lowest bits of their mantissa
+  /// are zero, which is the case for all integers up to 2^50 and most short
+  /// binary fractions
+  static std::optional<Entity> makeInlineNumber(const double theNumber) {
+    uint64_t aBits;
+    std::memcpy(&aBits, &theNumber, sizeof(aBits));
+    if (aBits & 7)
+      return std::nullopt;
+    return Entity{INLINE_NUMBER, static_cast<int64_t>(aBits >> 3)};
+  }
+  double getInlineNumber() const {
+    const uint64_t aBits = static_cast<uint64_t>(itsPayload) << 3;
+    double aNumber;
+    std::memcpy(&aNumber, &aBits, sizeof(aNumber));
+    return aNumber;
+  }
+
+  /// The chars of inline strings take up the upper seven bytes of the word,
+  /// the size is stored in front of them
+  static std::optional<Entity>
+  makeInlineString(const std::string_view theStr) {
+#ifdef CJSON_LITTLE_ENDIAN
+    if (theStr.size() > MAX_INLINE_STRING_SIZE)
+      return std::nullopt;
+    uint64_t aWord = 0;
+    // Empty strings may not have any data to copy from
+    if (!theStr.empty())
+      std::memcpy(reinterpret_cast<char *>(&aWord) + 1, theStr.data(),
+                  theStr.size());
+    aWord |= uint64_t{theStr.size()} << 3 | INLINE_STRING;
+    Entity aEntity;
+    std::memcpy(&aEntity, &aWord, sizeof(aEntity));
+    return aEntity;
+#else
+    return std::nullopt;
+#endif
+  }
+  std::string_view getInlineString() const {
+    return {reinterpret_cast<const char *>(this) + 1,
+            static_cast<size_t>(itsPayload & 0x1f)};
+  }
 };
-struct Array {
-  intptr_t itsPosition; // index into itsEntities
-  size_t itsNumElements;
+static_assert(sizeof(Entity) == sizeof(uint64_t), "Entity is not packed");
+
+/// Integer types which a document stores positions (which may be negative,
+/// see String) and sizes of its elements as
+template <typename PositionTy, typename SizeTy> struct IndexTypes {
+  using Position = PositionTy;
+  using Size = SizeTy;
+
+  /// @return whether positions and sizes up to theMax can be stored
+  static constexpr bool fits(const intptr_t theMax) noexcept {
+    return theMax <= static_cast<intptr_t>(
+                         std::numeric_limits<PositionTy>::max()) &&
+           static_cast<uintmax_t>(theMax) <= std::numeric_limits<SizeTy>::max();
+  }
 };
-struct Object {
-  intptr_t itsKeysPos;   // index into itsObjectProps
-  intptr_t itsValuesPos; // index into itsEntities
-  size_t itsNumProperties;
+/// Indices as wide as pointers, which fit every document
+using WideIndices = IndexTypes<intptr_t, size_t>;
+/// 32 bit indices, which halve the memory needed for the arrays, objects and
+/// strings of documents with less than 2G chars and entities
+using NarrowIndices = IndexTypes<int32_t, uint32_t>;
+
+template <typename Indices = WideIndices> struct BasicArray {
+  typename Indices::Position itsPosition; // index into itsEntities
+  typename Indices::Size itsNumElements;
 };
-struct Property {
-  intptr_t itsKeyPos; // index into itsStrings
+template <typename Indices = WideIndices> struct BasicObject {
+  typename Indices::Position itsKeysPos;   // index into itsObjectProps
+  typename Indices::Position itsValuesPos; // index into itsEntities
+  typename Indices::Size itsNumProperties;
 };
-struct String {
-  intptr_t itsPosition; // index into itsChars
-  size_t itsSize;
+template <typename Indices = WideIndices> struct BasicProperty {
+  typename Indices::Position itsKeyPos; // index into itsStrings
 };
+template <typename Indices = WideIndices> struct BasicString {
+  // index into itsChars or, if negative, the bitwise complement of the offset
+  // into the source of a borrowing document
+  typename Indices::Position itsPosition;
+  typename Indices::Size itsSize;
+};
+using Array = BasicArray<>;
+using Object = BasicObject<>;
+using Property = BasicProperty<>;
+using String = BasicString<>;
+
+namespace impl {
+/// @return the string theStrIdx of theDoc while it is being parsed from
+/// theSource, i.e. before borrowing documents know their source
+template <typename DocTy>
+std::string_view peekString(const DocTy &theDoc,
+                            const std::string_view theSource,
+                            const intptr_t theStrIdx) {
+  const auto &aStr = theDoc.itsStrings[theStrIdx];
+  if (aStr.itsPosition < 0)
+    return theSource.substr(~aStr.itsPosition, aStr.itsSize);
+  return std::string_view{theDoc.itsChars.data() + aStr.itsPosition,
+                          aStr.itsSize};
+}
+} // namespace impl
 } // namespace cjson
 #endif // CONSTEXPR_JSON_DOCUMENT_ENTITIES_H
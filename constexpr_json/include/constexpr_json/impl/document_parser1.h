@@ -120,8 +120,9 @@ struct DocumentParser1 {
                ++i, ++j)
             aStrDoc.itsChars[i] = aBytes[j];
         }
-        aStrDoc.itsStrings[0] =
-            String{0, static_cast<size_t>(theDocInfo.itsNumChars)};
+        aStrDoc.itsStrings[0] = typename DocTy::String{
+            0, static_cast<typename DocTy::Indices::Size>(
+                   theDocInfo.itsNumChars)};
         aStrDoc.itsEntities[0] = Entity{Entity::STRING, 0};
         return aStrDoc;
       }
@@ -326,6 +327,8 @@ struct DocumentParser1 {
           return aErrorResult;
         }
       }
+      if constexpr (DocTy::Storage::SORTS_KEYS)
+        aResult.sortKeys();
       return aResult;
     }
     return aErrorResult;
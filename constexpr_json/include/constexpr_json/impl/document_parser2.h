@@ -4,9 +4,12 @@
 #include "constexpr_json/document.h"
 #include "constexpr_json/document_info.h"
 #include "constexpr_json/error_codes.h"
+#include "constexpr_json/impl/compiler_support.h"
 #include "constexpr_json/impl/document_allocator.h"
 #include "constexpr_json/impl/parsing_utils.h"
-#include <cassert>
+#include "constexpr_json/impl/structural_index.h"
+
+#include <limits>
 
 namespace cjson {
 template <typename SourceEncodingTy, typename DestEncodingTy,
@@ -14,20 +17,41 @@ template <typename SourceEncodingTy, typename DestEncodingTy,
 struct DocumentParser2 {
 private:
   using P = parsing<SourceEncodingTy>;
-  using ElementId = intptr_t;
-  using ParentId = intptr_t;
-  using Location = intptr_t;
   using Type = typename P::Type;
-  struct ElementInfo {
-    ElementId itsId = 0;
-    Type itsType;
-    ParentId itsParentId = -1;
-    Location itsLocation = 0;
-    ElementId itsFirstChild = -1;
-    ElementId itsLastChild = -1;
-    ElementId itsNextSibling = -1;
-    size_t itsNumChildren = 0;
+
+  /// Intermediate representation of the document between the two parsing
+  /// phases: one word per value, object key and closing bracket, in document
+  /// order. The upper TAG_BITS of a word hold its Tag, the rest its payload:
+  /// - scalar values and keys: their location in the source
+  /// - arrays and objects: their number of children
+  /// - closing brackets: the tape index of the matching array or object
+  enum class Tag : uint64_t {
+    NUL,
+    BOOL,
+    NUMBER,
+    STRING,
+    ARRAY,
+    OBJECT,
+    KEY,
+    CLOSE
   };
+  static constexpr int TAG_BITS = 4;
+  static constexpr int PAYLOAD_BITS = 64 - TAG_BITS;
+  static constexpr uint64_t PAYLOAD_MASK = (uint64_t{1} << PAYLOAD_BITS) - 1;
+
+  static constexpr uint64_t makeWord(const Tag theTag,
+                                     const uint64_t thePayload) noexcept {
+    return static_cast<uint64_t>(theTag) << PAYLOAD_BITS | thePayload;
+  }
+  static constexpr Tag tagOf(const Type theType) noexcept {
+    return static_cast<Tag>(theType);
+  }
+  static constexpr Tag tagOf(const uint64_t theWord) noexcept {
+    return static_cast<Tag>(theWord >> PAYLOAD_BITS);
+  }
+  static constexpr uint64_t payloadOf(const uint64_t theWord) noexcept {
+    return theWord & PAYLOAD_MASK;
+  }
 
 public:
   template <typename DocTy>
@@ -66,242 +90,349 @@ public:
     if (!theDocInfo)
       return makeError<DocTy>("Using illegal DocInfo for parsing");
     const P p{theSrcEnc};
-    const auto aElementInfosOrError =
-        computeElementInfos<DocTy>(theJsonString, theDocInfo, theSrcEnc);
-    if (ErrorHandlingTy::isError(aElementInfosOrError))
-      return makeError<DocTy>("Failed to compute element infos");
-    const auto &aElementInfos = ErrorHandlingTy::unwrap(aElementInfosOrError);
-    const ElementInfo *aCurrentElm = &aElementInfos.front();
+    const auto aTapeOrError =
+        computeTape<DocTy>(theJsonString, theDocInfo, theSrcEnc);
+    if (ErrorHandlingTy::isError(aTapeOrError))
+      return makeError<DocTy>("Failed to compute tape");
+    const auto &aTape = ErrorHandlingTy::unwrap(aTapeOrError);
     DocumentAllocator<DocTy, ErrorHandlingTy> aAlloc;
-    intptr_t aNextEntityIdx = 1;
-    intptr_t aNextPropIdx = 0;
+    aAlloc.borrowFrom(theJsonString);
     DocTy aResult{theDocInfo};
-    // Invariant: if aCurrentElm is null, aEntity has been set its ElementInfo
-    // index before as its payload
-    for (Entity &aEntity : aResult.itsEntities) {
-      if (!aCurrentElm)
-        aCurrentElm = &aElementInfos[aEntity.itsPayload];
-      std::string_view aSubJson =
-          theJsonString.substr(aCurrentElm->itsLocation);
-      // if the parent is an object, consume the key first
-      if (aCurrentElm->itsParentId >= 0 &&
-          aElementInfos[aCurrentElm->itsParentId].itsType == Type::OBJECT) {
-        std::string_view aStr = p.readString(aSubJson);
-        size_t aLenRead = aStr.size();
-        aStr = p.stripQuotes(aStr);
+    /// Where to continue after an array or object has been filled in
+    struct Frame {
+      intptr_t itsSlot = 0;
+      intptr_t itsObject = -1;
+    };
+    OpenStack<DocTy, Frame> aFrames{numAggregates(theDocInfo)};
+    // The entity slot of the next value and the object it belongs to, if any
+    intptr_t aSlot = 0;
+    intptr_t aObject = -1;
+    for (const uint64_t aWord : aTape) {
+      const uint64_t aPayload = payloadOf(aWord);
+      switch (tagOf(aWord)) {
+      case Tag::KEY: {
         const auto aAllocStr =
-            aAlloc.template allocateTranscodeString<SourceEncodingTy,
-                                                    DestEncodingTy>(aResult,
-                                                                    aStr, theSrcEnc, theDestEnc);
+            aAlloc.template allocateKey<SourceEncodingTy, DestEncodingTy>(
+                aResult,
+                p.stripQuotes(p.readString(theJsonString.substr(aPayload))),
+                theSrcEnc, theDestEnc);
         if (ErrorHandlingTy::isError(aAllocStr))
           return ErrorHandlingTy::template convertError<DocTy>(aAllocStr);
-        aResult.itsObjectProps[aNextPropIdx++].itsKeyPos =
-            ErrorHandlingTy::unwrap(aAllocStr).itsPayload;
-        aSubJson.remove_prefix(aLenRead);
-        aSubJson = p.removeLeadingWhitespace(aSubJson);
-        const auto aDecoded = theSrcEnc.decodeFirst(aSubJson);
-        assert(aDecoded.second > 0 && aDecoded.first == ':' &&
-               "Expected colon");
-        aSubJson.remove_prefix(aDecoded.second);
-        aSubJson = p.removeLeadingWhitespace(aSubJson);
+        const auto &aObj = aResult.itsObjects[aObject];
+        aResult.itsObjectProps[aObj.itsKeysPos + aSlot - aObj.itsValuesPos]
+            .itsKeyPos = ErrorHandlingTy::unwrap(aAllocStr).itsPayload;
+        continue;
       }
-
-      // now get the value
-      switch (aCurrentElm->itsType) {
-      case Type::NUL:
-        aEntity = {Entity::NUL, 0};
+      case Tag::CLOSE:
+        aSlot = aFrames.top().itsSlot;
+        aObject = aFrames.top().itsObject;
+        aFrames.pop();
+        continue;
+      case Tag::NUL:
+        aResult.itsEntities[aSlot] = {Entity::NUL, 0};
         break;
-      case Type::BOOL:
-        aEntity = {Entity::BOOL, p.parseBool(aSubJson).first};
+      case Tag::BOOL:
+        aResult.itsEntities[aSlot] = {
+            Entity::BOOL, p.parseBool(theJsonString.substr(aPayload)).first};
         break;
-      case Type::NUMBER:
-        aEntity = aAlloc.allocateNumber(aResult, p.parseNumber(aSubJson).first);
+      case Tag::NUMBER:
+        aResult.itsEntities[aSlot] = aAlloc.allocateNumber(
+            aResult, p.parseNumber(theJsonString.substr(aPayload)).first);
         break;
-      case Type::STRING: {
+      case Tag::STRING: {
         const auto aAllocStr =
-            aAlloc.template allocateTranscodeString<SourceEncodingTy,
-                                                    DestEncodingTy>(
-                aResult, p.stripQuotes(p.readString(aSubJson)), theSrcEnc, theDestEnc);
+            aAlloc.template allocateString<SourceEncodingTy, DestEncodingTy>(
+                aResult,
+                p.stripQuotes(p.readString(theJsonString.substr(aPayload))),
+                theSrcEnc, theDestEnc);
         if (ErrorHandlingTy::isError(aAllocStr))
           return ErrorHandlingTy::template convertError<DocTy>(aAllocStr);
-        aEntity = ErrorHandlingTy::unwrap(aAllocStr);
+        aResult.itsEntities[aSlot] = ErrorHandlingTy::unwrap(aAllocStr);
         break;
       }
-      case Type::ARRAY:
-      case Type::OBJECT: {
-        if (aCurrentElm->itsType == Type::OBJECT) {
-          aEntity = aAlloc.allocateObject(aResult, aCurrentElm->itsNumChildren);
-        } else {
-          aEntity = aAlloc.allocateArray(aResult, aCurrentElm->itsNumChildren);
-        }
-        // maintain invariant
-        if (aCurrentElm->itsFirstChild >= 0) {
-          aResult.itsEntities[aNextEntityIdx].itsPayload =
-              aCurrentElm->itsFirstChild;
-          aNextEntityIdx += aCurrentElm->itsNumChildren;
-        }
-        break;
+      case Tag::ARRAY: {
+        const Entity aArr = aAlloc.allocateArray(aResult, aPayload);
+        aResult.itsEntities[aSlot] = aArr;
+        aFrames.push({aSlot + 1, aObject});
+        aSlot = aResult.itsArrays[aArr.itsPayload].itsPosition;
+        aObject = -1;
+        continue;
       }
+      case Tag::OBJECT: {
+        const Entity aObj = aAlloc.allocateObject(aResult, aPayload);
+        aResult.itsEntities[aSlot] = aObj;
+        aFrames.push({aSlot + 1, aObject});
+        aSlot = aResult.itsObjects[aObj.itsPayload].itsValuesPos;
+        aObject = aObj.itsPayload;
+        continue;
       }
-      if (aCurrentElm->itsNextSibling != -1) {
-        aCurrentElm = &aElementInfos[aCurrentElm->itsNextSibling];
-      } else {
-        aCurrentElm = nullptr;
       }
+      ++aSlot;
     }
-#undef PARSE_STRING
+    if constexpr (DocTy::Storage::INTERNS_KEYS ||
+                  DocTy::Storage::INLINES_SCALARS)
+      aAlloc.releaseUnused(aResult);
+    if constexpr (DocTy::Storage::SORTS_KEYS)
+      aResult.sortKeys();
     return aResult;
   }
 
 private:
+  /// Adds buffer limits, saturating at the maximum for unbounded storages
+  static constexpr intptr_t addLimits(const intptr_t theLHS,
+                                      const intptr_t theRHS) {
+    constexpr intptr_t aMax = std::numeric_limits<intptr_t>::max();
+    return theLHS > aMax - theRHS ? aMax : theLHS + theRHS;
+  }
+  template <typename DocTy>
+  static constexpr intptr_t MAX_TAPE_WORDS() {
+    using Storage = typename DocTy::Storage;
+    return addLimits(
+        addLimits(Storage::MAX_ENTITIES(), Storage::MAX_OBJECT_PROPS()),
+        addLimits(Storage::MAX_ARRAYS(), Storage::MAX_OBJECTS()));
+  }
   template <typename DocTy>
-  using ElementInfos =
-      typename DocTy::Storage::template Buffer<ElementInfo,
-                                               DocTy::Storage::MAX_ENTITIES()>;
+  using Tape =
+      typename DocTy::Storage::template Buffer<uint64_t,
+                                               MAX_TAPE_WORDS<DocTy>()>;
 
-  static constexpr std::string_view
-  consumeObjectKey(const std::string_view theString, const SourceEncodingTy &theSrcEnc) {
-    const P p{theSrcEnc};
-    std::string_view aRemaining = theString;
-    aRemaining.remove_prefix(p.readString(aRemaining).size());
-    aRemaining = p.removeLeadingWhitespace(aRemaining);
-    const auto aDecoded = theSrcEnc.decodeFirst(aRemaining);
-    assert(aDecoded.second > 0 && aDecoded.first == ':' && "Expected colon");
-    aRemaining.remove_prefix(aDecoded.second);
-    aRemaining = p.removeLeadingWhitespace(aRemaining);
-    return aRemaining;
+  static constexpr size_t numAggregates(const DocumentInfo &theDocInfo) {
+    return static_cast<size_t>(theDocInfo.itsNumArrays +
+                               theDocInfo.itsNumObjects);
+  }
+  static constexpr size_t numTapeWords(const DocumentInfo &theDocInfo) {
+    // values, keys and closing brackets
+    return static_cast<size_t>(theDocInfo.itsNumArrayEntries +
+                               2 * theDocInfo.itsNumObjectProperties + 1) +
+           numAggregates(theDocInfo);
   }
 
+  /// Stack of the arrays and objects enclosing the current position. Fixed
+  /// size storages reserve room for all aggregates of the document, growable
+  /// ones only for the actual nesting depth.
+  template <typename DocTy, typename T> class OpenStack {
+    using Storage = typename DocTy::Storage;
+    static constexpr intptr_t CAPACITY =
+        addLimits(Storage::MAX_ARRAYS(), Storage::MAX_OBJECTS());
+    using Items = typename Storage::template Buffer<T, CAPACITY>;
+
+  public:
+    constexpr explicit OpenStack(const size_t theNumAggregates)
+        : itsItems{Storage::template createBuffer<T, CAPACITY>(
+              Storage::IS_GROWABLE ? 0 : theNumAggregates)} {}
+
+    /// @return false if the stack is full
+    constexpr bool push(const T &theItem) {
+      if (itsSize == itsItems.size()) {
+        if constexpr (Storage::IS_GROWABLE)
+          itsItems.push_back(theItem);
+        else
+          return false;
+      } else {
+        itsItems[itsSize] = theItem;
+      }
+      ++itsSize;
+      return true;
+    }
+    constexpr void pop() noexcept { --itsSize; }
+    constexpr const T &top() const noexcept { return itsItems[itsSize - 1]; }
+    constexpr bool empty() const noexcept { return itsSize == 0; }
+
+  private:
+    Items itsItems;
+    size_t itsSize = 0;
+  };
+
   template <typename DocTy>
-  static constexpr auto
-  computeElementInfos(const std::string_view theJsonString,
-                      const DocumentInfo &theDocInfo, const SourceEncodingTy theSrcEnc)
-      -> ResultTy<ElementInfos<DocTy>> {
+  static constexpr auto computeTape(const std::string_view theJsonString,
+                                    const DocumentInfo &theDocInfo,
+                                    const SourceEncodingTy theSrcEnc)
+      -> ResultTy<Tape<DocTy>> {
     const P p{theSrcEnc};
-    // state variables
-    ElementInfos<DocTy> aEntities{
-        DocTy::Storage::template createBuffer<ElementInfo,
-                                              DocTy::Storage::MAX_ENTITIES()>(
-            static_cast<size_t>(theDocInfo.itsNumArrayEntries +
-                                theDocInfo.itsNumObjectProperties + 1))};
-    ParentId aCurrentParent = -1;
-    Type aCurrentParentType = Type::NUL;
-    bool aIsFirstChild = true;
+    Tape<DocTy> aTape{DocTy::Storage::template createBuffer<
+        uint64_t, MAX_TAPE_WORDS<DocTy>()>(numTapeWords(theDocInfo))};
+    if constexpr (impl::IsAsciiCompatible<SourceEncodingTy>::value) {
+      if (!CJSON_IS_CONSTANT_EVALUATED()) {
+        if (computeTapeIndexed<DocTy>(theJsonString, theDocInfo, theSrcEnc,
+                                      aTape))
+          return aTape;
+        // Let the loop below deal with malformed input
+      }
+    }
+    // Tape indices of the enclosing arrays and objects
+    OpenStack<DocTy, size_t> aOpen{numAggregates(theDocInfo)};
+    size_t aTapeSize = 0;
     std::string_view aRemaining = theJsonString;
+    const auto append = [&](const Tag theTag, const uint64_t thePayload) {
+      if (aTapeSize == aTape.size())
+        return false;
+      aTape[aTapeSize++] = makeWord(theTag, thePayload);
+      return true;
+    };
+    const auto consumeKey = [&]() {
+      aRemaining = p.removeLeadingWhitespace(aRemaining);
+      const std::string_view aKey = p.readString(aRemaining);
+      if (aKey.empty() ||
+          !append(Tag::KEY, theJsonString.size() - aRemaining.size()))
+        return false;
+      aRemaining.remove_prefix(aKey.size());
+      aRemaining = p.removeLeadingWhitespace(aRemaining);
+      const auto [aChar, aCharWidth] = theSrcEnc.decodeFirst(aRemaining);
+      if (aCharWidth <= 0 || aChar != ':')
+        return false;
+      aRemaining.remove_prefix(aCharWidth);
+      return true;
+    };
 
-    for (size_t aElmIdx = 0; aElmIdx < aEntities.size(); ++aElmIdx) {
+    for (;;) {
+      // Step 1: Read a value
       aRemaining = p.removeLeadingWhitespace(aRemaining);
-      // leave surrounding element(s)
-      for (;;) {
-        const auto [aChar, aCharWidth] =
-            theSrcEnc.decodeFirst(aRemaining);
+      const auto aTypeOpt = p.detectElementType(aRemaining);
+      if (!aTypeOpt)
+        return makeTapeError<DocTy>("Failed to detect element type");
+      if (!aOpen.empty())
+        ++aTape[aOpen.top()];
+      if (*aTypeOpt == Type::ARRAY || *aTypeOpt == Type::OBJECT) {
+        const bool aIsObject = *aTypeOpt == Type::OBJECT;
+        if (!aOpen.push(aTapeSize) || !append(tagOf(*aTypeOpt), 0))
+          return makeTapeError<DocTy>("Document does not match DocInfo");
+        aRemaining.remove_prefix(
+            theSrcEnc.encode(aIsObject ? '{' : '[').second);
+        aRemaining = p.removeLeadingWhitespace(aRemaining);
+        const auto [aChar, aCharWidth] = theSrcEnc.decodeFirst(aRemaining);
         if (aCharWidth <= 0)
-          return makeElmInfoError<DocTy>(
-              "Unexpected EOF or failed to decode character");
-        if ((aCurrentParentType == Type::OBJECT && aChar == '}') ||
-            (aCurrentParentType == Type::ARRAY && aChar == ']')) {
-          // move one level up again
-          aRemaining.remove_prefix(aCharWidth);
-          aRemaining = p.removeLeadingWhitespace(aRemaining);
-          const auto &aOldParentInfo = aEntities[aCurrentParent];
-          aCurrentParent = aOldParentInfo.itsParentId;
-          aIsFirstChild = false;
-          if (aCurrentParent >= 0) {
-            const auto &aNewParentInfo = aEntities[aCurrentParent];
-            assert((aNewParentInfo.itsType == Type::OBJECT ||
-                    aNewParentInfo.itsType == Type::ARRAY) &&
-                   "Parent element must be array or object");
-            aCurrentParentType = aNewParentInfo.itsType;
-          } else {
-            aCurrentParentType = Type::NUL;
-            break;
-          }
+          return makeTapeError<DocTy>("Unexpected EOF");
+        if (aChar != (aIsObject ? '}' : ']')) {
+          if (aIsObject && !consumeKey())
+            return makeTapeError<DocTy>("Failed to read object key");
           continue;
         }
-        break;
+      } else {
+        const uint64_t aLocation = theJsonString.size() - aRemaining.size();
+        if (!append(tagOf(*aTypeOpt), aLocation))
+          return makeTapeError<DocTy>("Document does not match DocInfo");
+        const size_t aLen = readScalar(p, *aTypeOpt, aRemaining);
+        if (aLen == 0)
+          return makeTapeError<DocTy>("Failed to read value");
+        aRemaining.remove_prefix(aLen);
       }
-      // sanity check
-      assert(
-          (aIsFirstChild || aCurrentParentType != Type::NUL) &&
-          "Second element in root scope. You may be using the wrong DocType");
-      // consume comma
-      if (!aIsFirstChild) {
-        const auto [aChar, aCharWidth] =
-            theSrcEnc.decodeFirst(aRemaining);
-        if (aChar != ',')
-          return makeElmInfoError<DocTy>("Expected comma");
-        aRemaining.remove_prefix(aCharWidth);
+
+      // Step 2: Close finished aggregates until another value follows
+      for (;;) {
+        if (aOpen.empty()) {
+          if (aTapeSize != aTape.size())
+            return makeTapeError<DocTy>("Document does not match DocInfo");
+          return aTape;
+        }
+        const bool aIsObject = tagOf(aTape[aOpen.top()]) == Tag::OBJECT;
         aRemaining = p.removeLeadingWhitespace(aRemaining);
+        const auto [aChar, aCharWidth] = theSrcEnc.decodeFirst(aRemaining);
+        if (aCharWidth <= 0)
+          return makeTapeError<DocTy>("Unexpected EOF");
+        aRemaining.remove_prefix(aCharWidth);
+        if (aChar == ',') {
+          if (aIsObject && !consumeKey())
+            return makeTapeError<DocTy>("Failed to read object key");
+          break;
+        }
+        if (aChar != (aIsObject ? '}' : ']'))
+          return makeTapeError<DocTy>("Expected comma");
+        if (!append(Tag::CLOSE, aOpen.top()))
+          return makeTapeError<DocTy>("Document does not match DocInfo");
+        aOpen.pop();
       }
+    }
+  }
 
-      // location is registered before the key is consumed
-      const Location aLocation = theJsonString.size() - aRemaining.size();
+  /// @return the length of the scalar value of type theType at the start of
+  /// theString or 0 if it is malformed
+  static constexpr size_t readScalar(const P &p, const Type theType,
+                                     const std::string_view theString) {
+    switch (theType) {
+    case Type::NUL:
+      return p.readNull(theString).size();
+    case Type::BOOL: {
+      const intptr_t aLen = p.parseBool(theString).second;
+      return aLen > 0 ? static_cast<size_t>(aLen) : 0;
+    }
+    case Type::NUMBER:
+      return p.readNumber(theString).size();
+    case Type::STRING:
+      return p.readString(theString).size();
+    default:
+      return 0;
+    }
+  }
+
+  /// Runtime implementation of computeTape based on a StructuralIndex
+  /// @return false if theJsonString is malformed or does not match
+  /// theDocInfo
+  template <typename DocTy>
+  static bool computeTapeIndexed(const std::string_view theJsonString,
+                                 const DocumentInfo &theDocInfo,
+                                 const SourceEncodingTy theSrcEnc,
+                                 Tape<DocTy> &theTape) {
+    struct Collector {
+      const P p;
+      Tape<DocTy> &itsTape;
+      OpenStack<DocTy, size_t> itsOpen;
+      size_t itsTapeSize = 0;
 
-      // consume key
-      if (aCurrentParentType == Type::OBJECT) {
-        aRemaining = consumeObjectKey(aRemaining, theSrcEnc);
+      bool append(const Tag theTag, const uint64_t thePayload) {
+        if (itsTapeSize == itsTape.size())
+          return false;
+        itsTape[itsTapeSize++] = makeWord(theTag, thePayload);
+        return true;
       }
-      // detect type
-      auto aTypeOpt = p.detectElementType(aRemaining);
-      if (!aTypeOpt) {
-        return makeElmInfoError<DocTy>("Failed to detect element type");
+      bool add(const Type theType, const intptr_t thePos) {
+        if (!itsOpen.empty())
+          ++itsTape[itsOpen.top()];
+        return append(tagOf(theType), thePos);
       }
-
-      // set element properties
-      aEntities[aElmIdx].itsId = aElmIdx;
-      aEntities[aElmIdx].itsType = *aTypeOpt;
-      aEntities[aElmIdx].itsParentId = aCurrentParent;
-      aEntities[aElmIdx].itsLocation = aLocation;
-      if (aCurrentParent >= 0) {
-        auto &aParent = aEntities[aCurrentParent];
-        ++aParent.itsNumChildren;
-        if (aIsFirstChild) {
-          aParent.itsFirstChild = aElmIdx;
-        }
-        const auto aPrevSibIdx = aParent.itsLastChild;
-        aParent.itsLastChild = aElmIdx;
-        if (aPrevSibIdx != -1) {
-          aEntities[aPrevSibIdx].itsNextSibling = aElmIdx;
+      intptr_t onScalar(const intptr_t thePos,
+                        const std::string_view theRest) {
+        switch (theRest.front()) {
+        case 'n':
+          return add(Type::NUL, thePos) ? p.readNull(theRest).size() : -1;
+        case 't':
+        case 'f':
+          return add(Type::BOOL, thePos) ? p.parseBool(theRest).second : -1;
+        default:
+          return add(Type::NUMBER, thePos) ? p.readNumber(theRest).size()
+                                           : -1;
         }
       }
-      // setup for reading next element
-      aIsFirstChild = false;
-      switch (*aTypeOpt) {
-      case Type::NUL:
-        aRemaining.remove_prefix(p.readNull(aRemaining).size());
-        break;
-      case Type::BOOL:
-        aRemaining.remove_prefix(p.parseBool(aRemaining).second);
-        break;
-      case Type::NUMBER:
-        aRemaining.remove_prefix(p.readNumber(aRemaining).size());
-        break;
-      case Type::STRING:
-        aRemaining.remove_prefix(p.readString(aRemaining).size());
-        break;
-      case Type::ARRAY:
-      case Type::OBJECT: {
-        if (*aTypeOpt == Type::ARRAY) {
-          aRemaining.remove_prefix(theSrcEnc.encode('[').second);
-          aCurrentParentType = Type::ARRAY;
-        } else {
-          aRemaining.remove_prefix(theSrcEnc.encode('{').second);
-          aCurrentParentType = Type::OBJECT;
-        }
-        aCurrentParent = aElmIdx;
-        aIsFirstChild = true;
-        break;
+      bool onString(const intptr_t thePos, std::string_view) {
+        return add(Type::STRING, thePos);
       }
+      bool onKey(const intptr_t thePos, std::string_view) {
+        return append(Tag::KEY, thePos);
       }
-    }
-    return aEntities;
+      bool onOpen(intptr_t, const bool theIsObject) {
+        return add(theIsObject ? Type::OBJECT : Type::ARRAY, 0) &&
+               itsOpen.push(itsTapeSize - 1);
+      }
+      bool onClose(bool) {
+        if (!append(Tag::CLOSE, itsOpen.top()))
+          return false;
+        itsOpen.pop();
+        return true;
+      }
+    };
+    impl::StructuralIndex aIndex;
+    if (!aIndex.build(theJsonString))
+      return false;
+    Collector aCollector{P{theSrcEnc}, theTape,
+                         OpenStack<DocTy, size_t>{numAggregates(theDocInfo)}};
+    return impl::walkStructuralIndex(theJsonString, aIndex, aCollector) >= 0 &&
+           aCollector.itsTapeSize == theTape.size();
   }
 
   template <typename DocTy>
-  static constexpr auto makeElmInfoError(const char *const theMsg) ->
-      typename ErrorHandlingTy::template ErrorOr<ElementInfos<DocTy>> {
-    return ErrorHandlingTy::template makeError<ElementInfos<DocTy>>(
-        ErrorCode::UNKNOWN, -1);
+  static constexpr auto makeTapeError(const char *const theMsg)
+      -> ResultTy<Tape<DocTy>> {
+    return ErrorHandlingTy::template makeError<Tape<DocTy>>(ErrorCode::UNKNOWN,
+                                                            -1);
   }
   template <typename DocTy>
   static constexpr auto makeError(const char *const theMsg,
@@ -0,0 +1,617 @@
+#ifndef CONSTEXPR_JSON_DOCUMENT_PARSER3_H
+#define CONSTEXPR_JSON_DOCUMENT_PARSER3_H
+
+#include "constexpr_json/document.h"
+#include "constexpr_json/document_info.h"
+#include "constexpr_json/error_codes.h"
+#include "constexpr_json/impl/document_parser2.h"
+#include "constexpr_json/impl/key_interning.h"
+#include "constexpr_json/impl/parsing_utils.h"
+#include "constexpr_json/impl/projection.h"
+#include "constexpr_json/impl/structural_index.h"
+
+#include <vector>
+
+namespace cjson {
+/// Single-pass parser for documents with growable storage
+///
+/// DocumentParser2 needs a DocumentInfo to size the document buffers up front,
+/// which means reading the input three times: DocumentInfo::compute, then
+/// computeTape, then filling in the entities. This parser instead
+/// appends to the DocumentBase buffers as it goes and reads the input exactly
+/// once. The children of every array/object are collected on a scratch stack
+/// and moved into itsEntities (resp. itsObjectProps) in one piece when the
+/// aggregate is closed, which keeps them contiguous as DocumentBase requires.
+///
+/// Documents with fixed-size storage (e.g. StaticDocument) cannot grow, so
+/// the DocumentInfo-based parseDocument overloads are inherited from
+/// DocumentParser2. This also keeps constexpr parsing working when this
+/// parser is selected as Impl of DocumentParser.
+template <typename SourceEncodingTy, typename DestEncodingTy,
+          typename ErrorHandlingTy>
+struct DocumentParser3
+    : public DocumentParser2<SourceEncodingTy, DestEncodingTy,
+                             ErrorHandlingTy> {
+private:
+  using P = parsing<SourceEncodingTy>;
+  using Type = typename P::Type;
+
+  /// An array or object that has been opened but not yet closed
+  struct Frame {
+    /// index into itsArrays or itsObjects
+    intptr_t itsIdx;
+    /// index of the first child in the scratch buffer of pending children
+    size_t itsFirstChild;
+    bool itsIsObject;
+  };
+
+public:
+  using BaseClass =
+      DocumentParser2<SourceEncodingTy, DestEncodingTy, ErrorHandlingTy>;
+  template <typename DocTy>
+  using ResultTy = typename ErrorHandlingTy::template ErrorOr<DocTy>;
+
+  /// Allows DynamicDocument::parseJson to skip DocumentInfo::compute
+  static constexpr bool IS_SINGLE_PASS = true;
+
+  using BaseClass::parseDocument;
+
+  /// Parse theJsonString without a precomputed DocumentInfo
+  ///
+  /// Unlike the DocumentInfo-based overloads, this also rejects trailing
+  /// non-whitespace content, i.e. theJsonString has to contain exactly one
+  /// JSON document.
+  ///
+  /// For ASCII-compatible source encodings, the tokens are located using a
+  /// StructuralIndex first. Should that fail, the document is parsed again
+  /// character by character to find out what exactly went wrong.
+  template <typename DocTy>
+  static ResultTy<DocTy> parseDocument(const std::string_view theJsonString,
+                                       const SourceEncodingTy theSrcEnc = {},
+                                       const DestEncodingTy theDestEnc = {}) {
+    Context<DocTy> aContext{theSrcEnc, theDestEnc};
+    const auto aResult = parseDocument(theJsonString, aContext);
+    if (ErrorHandlingTy::isError(aResult))
+      return ErrorHandlingTy::template convertError<DocTy>(aResult);
+    return std::move(aContext.itsBuilder.itsDoc);
+  }
+
+  /// Parse only the values of theJsonString which theProjection selects.
+  /// Unselected subtrees are skipped after matching their brackets in the
+  /// StructuralIndex, so nothing is allocated for them (see
+  /// impl::walkProjection for what ends up in the document).
+  ///
+  /// Values are only validated as far as they are selected. Errors in the
+  /// selected values are reported like those of the other overloads.
+  template <typename DocTy>
+  static ResultTy<DocTy> parseDocument(const std::string_view theJsonString,
+                                       const Projection &theProjection,
+                                       const SourceEncodingTy theSrcEnc = {},
+                                       const DestEncodingTy theDestEnc = {}) {
+    static_assert(DocTy::Storage::IS_GROWABLE,
+                  "Single-pass parsing requires growable document storage");
+    static_assert(impl::IsAsciiCompatible<SourceEncodingTy>::value,
+                  "Projections skip values by their structural characters");
+    Builder<DocTy> aBuilder{theSrcEnc, theDestEnc, {}};
+    aBuilder.reset(theJsonString);
+    impl::StructuralIndex aIndex;
+    if (aIndex.build(theJsonString)) {
+      const P p{theSrcEnc};
+      const uint32_t *aToken = aIndex.begin();
+      const intptr_t aEnd =
+          impl::walkProjection(theJsonString, aToken, aIndex.end(),
+                               theProjection, Projection::ROOT, aBuilder,
+                               theSrcEnc);
+      if (aEnd >= 0 &&
+          p.removeLeadingWhitespace(theJsonString.substr(aEnd)).empty())
+        return std::move(aBuilder.itsDoc);
+    }
+    // Parse everything to find out what went wrong
+    aBuilder.reset(theJsonString);
+    const auto aResult = parseDocumentScalar(aBuilder);
+    if (ErrorHandlingTy::isError(aResult))
+      return ErrorHandlingTy::template convertError<DocTy>(aResult);
+    // Only inputs which are too large to be indexed can get here
+    return makeError<DocTy>(ErrorCode::DOCUMENT_TOO_LARGE, 0);
+  }
+
+protected:
+  template <typename DocTy> struct Builder;
+
+public:
+  /// Buffers which are kept between parseDocument calls so that parsing
+  /// many documents in a row reaches a steady state without allocations
+  template <typename DocTy> class Context {
+  public:
+    Context(const SourceEncodingTy theSrcEnc = {},
+            const DestEncodingTy theDestEnc = {})
+        : itsBuilder{theSrcEnc, theDestEnc, {}} {}
+
+  private:
+    friend DocumentParser3;
+    Builder<DocTy> itsBuilder;
+    impl::StructuralIndex itsIndex;
+  };
+
+  /// Parse theJsonString into the document of theContext, reusing the memory
+  /// of the previously parsed one
+  /// @return the document, which is valid until theContext is used again
+  template <typename DocTy>
+  static ResultTy<const DocTy *>
+  parseDocument(const std::string_view theJsonString,
+                Context<DocTy> &theContext) {
+    static_assert(DocTy::Storage::IS_GROWABLE,
+                  "Single-pass parsing requires growable document storage");
+    Builder<DocTy> &aBuilder = theContext.itsBuilder;
+    if constexpr (impl::IsAsciiCompatible<SourceEncodingTy>::value) {
+      impl::StructuralIndex &aIndex = theContext.itsIndex;
+      aBuilder.reset(theJsonString);
+      if (aIndex.build(theJsonString)) {
+        const P p{aBuilder.itsSrcEnc};
+        const intptr_t aEnd =
+            impl::walkStructuralIndex(theJsonString, aIndex, aBuilder);
+        if (aEnd >= 0 &&
+            p.removeLeadingWhitespace(theJsonString.substr(aEnd)).empty())
+          return &aBuilder.itsDoc;
+      }
+    }
+    aBuilder.reset(theJsonString);
+    return parseDocumentScalar(aBuilder);
+  }
+
+  /// Parse theJsonString into theDoc, replacing its contents. Like the
+  /// buffers of theContext, those of theDoc keep their memory.
+  /// @return theDoc, whose contents are unspecified after errors
+  template <typename DocTy>
+  static ResultTy<DocTy *> parseDocument(const std::string_view theJsonString,
+                                         DocTy &theDoc,
+                                         Context<DocTy> &theContext) {
+    // Moving documents only moves the pointers to their buffers
+    using std::swap;
+    swap(theDoc, theContext.itsBuilder.itsDoc);
+    const auto aResult = parseDocument(theJsonString, theContext);
+    swap(theDoc, theContext.itsBuilder.itsDoc);
+    if (ErrorHandlingTy::isError(aResult))
+      return ErrorHandlingTy::template convertError<DocTy *>(aResult);
+    return &theDoc;
+  }
+
+protected:
+  /// Assembles a document from the elements it is fed in document order.
+  /// Doubles as visitor for impl::walkStructuralIndex.
+  template <typename DocTy> struct Builder {
+    const SourceEncodingTy itsSrcEnc;
+    const DestEncodingTy itsDestEnc;
+    /// The whole input, which borrowing documents reference strings in
+    std::string_view itsSource;
+    DocTy itsDoc{DocumentInfo{}};
+    std::vector<Frame> itsStack = {};
+    std::vector<Entity> itsChildren = {};
+    std::vector<typename DocTy::Property> itsKeys = {};
+    /// Keys seen so far if DocTy::Storage::INTERNS_KEYS
+    impl::KeyInterner itsKeyInterner = {};
+
+    /// Starts over with an empty document for theSource, keeping the
+    /// capacity of all buffers
+    void reset(const std::string_view theSource) {
+      itsSource = theSource;
+      itsDoc.itsNumbers.clear();
+      itsDoc.itsChars.clear();
+      itsDoc.itsEntities.resize(1);
+      itsDoc.itsArrays.clear();
+      itsDoc.itsObjects.clear();
+      itsDoc.itsObjectProps.clear();
+      itsDoc.itsStrings.clear();
+      if constexpr (DocTy::Storage::HAS_PROPERTY_INDEX) {
+        itsDoc.itsPropertyIndex.clear();
+        itsDoc.itsPropertyIndexPos.clear();
+      }
+      if constexpr (DocTy::Storage::CACHES_HASHES) {
+        itsDoc.itsArrayHashes.clear();
+        itsDoc.itsObjectHashes.clear();
+      }
+      if constexpr (DocTy::Storage::DECODES_LAZILY) {
+        itsDoc.itsNumberPositions.clear();
+        itsDoc.itsDecodedNumbers.clear();
+        itsDoc.itsEscapedStrings.clear();
+        itsDoc.itsDecodedChars.clear();
+      }
+      itsStack.clear();
+      itsChildren.clear();
+      itsKeys.clear();
+      itsKeyInterner.clear();
+    }
+
+    /// Adds the null/bool/number of type theType at the front of theRest
+    /// @return the number of bytes read or a value <= 0 on error
+    intptr_t addScalar(const Type theType, const std::string_view theRest) {
+      const P p{itsSrcEnc};
+      switch (theType) {
+      case Type::NUL: {
+        const auto aNullLen = static_cast<intptr_t>(p.readNull(theRest).size());
+        if (aNullLen > 0)
+          emit(Entity{Entity::NUL, 0});
+        return aNullLen;
+      }
+      case Type::BOOL: {
+        const auto [aBool, aBoolLen] = p.parseBool(theRest);
+        if (aBoolLen > 0)
+          emit(Entity{Entity::BOOL, aBool});
+        return aBoolLen;
+      }
+      case Type::NUMBER: {
+        if constexpr (DocTy::Storage::DECODES_LAZILY) {
+          // Only the syntax is checked, the value is decoded once it is read
+          const auto aNumberLen =
+              static_cast<intptr_t>(p.readNumber(theRest).size());
+          if (aNumberLen <= 0)
+            return -1;
+          itsDoc.itsNumberPositions.push_back(theRest.data() -
+                                              itsSource.data());
+          itsDoc.itsDecodedNumbers.push_back(
+              std::numeric_limits<double>::quiet_NaN());
+          emit(Entity{Entity::NUMBER, static_cast<intptr_t>(
+                                          itsDoc.itsNumberPositions.size() -
+                                          1)});
+          return aNumberLen;
+        }
+        const auto [aNumber, aNumberLen] = p.parseNumber(theRest);
+        if (aNumberLen <= 0)
+          return aNumberLen;
+        if constexpr (DocTy::Storage::INLINES_SCALARS) {
+          if (const auto aInline = Entity::makeInlineNumber(aNumber)) {
+            emit(*aInline);
+            return aNumberLen;
+          }
+        }
+        itsDoc.itsNumbers.push_back(aNumber);
+        emit(Entity{Entity::NUMBER,
+                    static_cast<intptr_t>(itsDoc.itsNumbers.size() - 1)});
+        return aNumberLen;
+      }
+      default:
+        return -1;
+      }
+    }
+    intptr_t onScalar(intptr_t, const std::string_view theRest) {
+      switch (theRest.front()) {
+      case 'n':
+        return addScalar(Type::NUL, theRest);
+      case 't':
+      case 'f':
+        return addScalar(Type::BOOL, theRest);
+      default:
+        return addScalar(Type::NUMBER, theRest);
+      }
+    }
+    bool onString(intptr_t, const std::string_view theQuoted) {
+      if constexpr (DocTy::Storage::DECODES_LAZILY) {
+        using Position = typename DocTy::Indices::Position;
+        using Size = typename DocTy::Indices::Size;
+        const P p{itsSrcEnc};
+        const std::string_view aStr = p.stripQuotes(theQuoted);
+        const intptr_t aPos = aStr.data() - itsSource.data();
+        if (p.isVerbatimString(aStr)) {
+          itsDoc.itsStrings.push_back(typename DocTy::String{
+              static_cast<Position>(~aPos), static_cast<Size>(aStr.size())});
+          emit(Entity{Entity::STRING,
+                      static_cast<intptr_t>(itsDoc.itsStrings.size() - 1)});
+          return true;
+        }
+        // Escape sequences are only validated, the string is decoded once it
+        // is read
+        if (!p.isValidString(aStr))
+          return false;
+        const intptr_t aDecodedPos = itsDoc.itsDecodedChars.size();
+        itsDoc.itsDecodedChars.resize(aDecodedPos + aStr.size());
+        itsDoc.itsEscapedStrings.push_back(
+            impl::EscapedString{aPos, aStr.size(), aDecodedPos, -1});
+        emit(Entity{Entity::STRING,
+                    ~static_cast<intptr_t>(itsDoc.itsEscapedStrings.size() -
+                                           1)});
+        return true;
+      }
+      const auto aEntity =
+          appendTranscodeString(itsDoc, P{itsSrcEnc}.stripQuotes(theQuoted),
+                                itsSource, itsSrcEnc, itsDestEnc);
+      if (!aEntity)
+        return false;
+      if constexpr (DocTy::Storage::INLINES_SCALARS) {
+        const auto aInline = Entity::makeInlineString(
+            impl::peekString(itsDoc, itsSource, aEntity->itsPayload));
+        if (aInline) {
+          releaseLastString();
+          emit(*aInline);
+          return true;
+        }
+      }
+      emit(*aEntity);
+      return true;
+    }
+    bool onKey(intptr_t, const std::string_view theQuoted) {
+      const auto aKeyEntity =
+          appendTranscodeString(itsDoc, P{itsSrcEnc}.stripQuotes(theQuoted),
+                                itsSource, itsSrcEnc, itsDestEnc);
+      if (!aKeyEntity)
+        return false;
+      intptr_t aKeyPos = aKeyEntity->itsPayload;
+      if constexpr (DocTy::Storage::INTERNS_KEYS) {
+        const intptr_t aInterned =
+            itsKeyInterner.intern(itsDoc, itsSource, aKeyPos);
+        if (aInterned != aKeyPos) {
+          releaseLastString();
+          aKeyPos = aInterned;
+        }
+      }
+      itsKeys.push_back(typename DocTy::Property{
+          static_cast<typename DocTy::Indices::Position>(aKeyPos)});
+      return true;
+    }
+    bool onOpen(intptr_t, const bool theIsObject) {
+      const auto aIdx = static_cast<intptr_t>(
+          theIsObject ? itsDoc.itsObjects.size() : itsDoc.itsArrays.size());
+      if (theIsObject)
+        itsDoc.itsObjects.push_back(typename DocTy::Object{0, 0, 0});
+      else
+        itsDoc.itsArrays.push_back(typename DocTy::Array{0, 0});
+      itsStack.push_back(Frame{aIdx, itsChildren.size(), theIsObject});
+      return true;
+    }
+    bool onClose(bool) {
+      const Frame aFrame = itsStack.back();
+      itsStack.pop_back();
+      emit(closeAggregate(itsDoc, aFrame, itsChildren, itsKeys));
+      return true;
+    }
+
+  private:
+    /// Takes back the most recently appended string
+    void releaseLastString() {
+      const auto &aStr = itsDoc.itsStrings.back();
+      if (aStr.itsPosition >= 0)
+        itsDoc.itsChars.resize(aStr.itsPosition);
+      itsDoc.itsStrings.pop_back();
+    }
+
+    /// Places a finished element either in its parent's scratch list or, if
+    /// there is no parent, as the document root
+    void emit(const Entity theEntity) {
+      if (itsStack.empty())
+        itsDoc.itsEntities[0] = theEntity;
+      else
+        itsChildren.push_back(theEntity);
+    }
+  };
+
+  /// Character-based implementation of parseDocument, which also reports the
+  /// exact reason and position of errors (the same as DocumentParser2 does).
+  /// theBuilder has to be empty.
+  template <typename DocTy>
+  static ResultTy<const DocTy *>
+  parseDocumentScalar(Builder<DocTy> &theBuilder) {
+    using DocPtr = const DocTy *;
+    const SourceEncodingTy &aSrcEnc = theBuilder.itsSrcEnc;
+    const std::string_view aJson = theBuilder.itsSource;
+    const P p{aSrcEnc};
+    std::string_view aRemaining = aJson;
+    // The first value that is well-formed but could not be added
+    std::optional<std::pair<ErrorCode, intptr_t>> aDeferredError;
+#define CJSON_CURRENT_POSITION                                                 \
+  static_cast<intptr_t>(aJson.size() - aRemaining.size())
+
+    // Reads `"key" :` and registers the key for the innermost object
+    const auto consumeKey = [&]() -> std::optional<ErrorCode> {
+      aRemaining = p.removeLeadingWhitespace(aRemaining);
+      const std::string_view aKey = p.readString(aRemaining);
+      if (aKey.empty() || !theBuilder.onKey(CJSON_CURRENT_POSITION, aKey))
+        return ErrorCode::OBJECT_KEY_READ_FAILED;
+      aRemaining.remove_prefix(aKey.size());
+      aRemaining = p.removeLeadingWhitespace(aRemaining);
+      const auto [aColon, aColonWidth] = aSrcEnc.decodeFirst(aRemaining);
+      if (aColonWidth <= 0 || aColon != ':')
+        return ErrorCode::OBJECT_EXPECTED_COLON;
+      aRemaining.remove_prefix(aColonWidth);
+      return std::nullopt;
+    };
+
+    for (;;) {
+      // Step 1: Read a value
+      aRemaining = p.removeLeadingWhitespace(aRemaining);
+      const auto aTypeOpt = p.detectElementType(aRemaining);
+      if (!aTypeOpt)
+        return makeError<DocPtr>(ErrorCode::TYPE_DEDUCTION_FAILED,
+                                 CJSON_CURRENT_POSITION);
+      bool aOpenedAggregate = false;
+      switch (*aTypeOpt) {
+      case Type::NUL:
+      case Type::BOOL:
+      case Type::NUMBER: {
+        const intptr_t aLen = theBuilder.addScalar(*aTypeOpt, aRemaining);
+        if (aLen > 0) {
+          aRemaining.remove_prefix(aLen);
+          break;
+        }
+        const ErrorCode aCode = *aTypeOpt == Type::NUL
+                                    ? ErrorCode::NULL_READ_FAILED
+                                : *aTypeOpt == Type::BOOL
+                                    ? ErrorCode::BOOL_READ_FAILED
+                                    : ErrorCode::NUMBER_READ_FAILED;
+        // Like DocumentInfo::compute, only reject numbers whose syntax is
+        // broken right away (e.g. "1.5e+" is "1.5" followed by garbage).
+        // Numbers which cannot be decoded are reported once the rest of the
+        // input turned out to be well-formed.
+        const intptr_t aSyntaxLen =
+            *aTypeOpt == Type::NUMBER
+                ? static_cast<intptr_t>(p.readNumber(aRemaining).size())
+                : 0;
+        if (aSyntaxLen <= 0)
+          return makeError<DocPtr>(aCode, CJSON_CURRENT_POSITION);
+        if (!aDeferredError)
+          aDeferredError = std::make_pair(aCode, CJSON_CURRENT_POSITION);
+        aRemaining.remove_prefix(aSyntaxLen);
+        break;
+      }
+      case Type::STRING: {
+        const std::string_view aStr = p.readString(aRemaining);
+        if (aStr.empty() || !theBuilder.onString(CJSON_CURRENT_POSITION, aStr))
+          return makeError<DocPtr>(ErrorCode::STRING_READ_FAILED,
+                                   CJSON_CURRENT_POSITION);
+        aRemaining.remove_prefix(aStr.size());
+        break;
+      }
+      case Type::ARRAY:
+      case Type::OBJECT: {
+        const bool aIsObject = *aTypeOpt == Type::OBJECT;
+        theBuilder.onOpen(CJSON_CURRENT_POSITION, aIsObject);
+        aRemaining.remove_prefix(
+            aSrcEnc.encode(aIsObject ? '{' : '[').second);
+        // Empty aggregates are closed right away by Step 2
+        aRemaining = p.removeLeadingWhitespace(aRemaining);
+        const auto [aChar, aCharWidth] = aSrcEnc.decodeFirst(aRemaining);
+        if (aCharWidth <= 0)
+          return makeError<DocPtr>(aIsObject
+                                       ? ErrorCode::OBJECT_UNEXPECTED_TOKEN
+                                       : ErrorCode::ARRAY_UNEXPECTED_TOKEN,
+                                   CJSON_CURRENT_POSITION);
+        if (aChar == (aIsObject ? '}' : ']'))
+          break;
+        aOpenedAggregate = true;
+        if (aIsObject) {
+          if (const auto aError = consumeKey())
+            return makeError<DocPtr>(*aError, CJSON_CURRENT_POSITION);
+        }
+        break;
+      }
+      }
+      if (aOpenedAggregate)
+        continue;
+
+      // Step 2: Close finished aggregates until another value is expected
+      for (;;) {
+        if (theBuilder.itsStack.empty()) {
+          // Only trailing whitespace is allowed behind the root element,
+          // which is reported at its end like DocumentParser2 does
+          const intptr_t aDocSize = CJSON_CURRENT_POSITION;
+          if (!p.removeLeadingWhitespace(aRemaining).empty())
+            return makeError<DocPtr>(ErrorCode::TRAILING_CONTENT, aDocSize);
+          if (aDeferredError)
+            return makeError<DocPtr>(aDeferredError->first,
+                                     aDeferredError->second);
+          return &theBuilder.itsDoc;
+        }
+        const bool aIsObject = theBuilder.itsStack.back().itsIsObject;
+        aRemaining = p.removeLeadingWhitespace(aRemaining);
+        const auto [aChar, aCharWidth] = aSrcEnc.decodeFirst(aRemaining);
+        if (aCharWidth <= 0)
+          return makeError<DocPtr>(aIsObject
+                                       ? ErrorCode::OBJECT_UNEXPECTED_TOKEN
+                                       : ErrorCode::ARRAY_UNEXPECTED_TOKEN,
+                                   CJSON_CURRENT_POSITION);
+        if (aChar == ',') {
+          aRemaining.remove_prefix(aCharWidth);
+          if (aIsObject) {
+            if (const auto aError = consumeKey())
+              return makeError<DocPtr>(*aError, CJSON_CURRENT_POSITION);
+          }
+          break;
+        }
+        if (aChar != (aIsObject ? '}' : ']'))
+          return makeError<DocPtr>(aIsObject ? ErrorCode::OBJECT_EXPECTED_COMMA
+                                             : ErrorCode::ARRAY_EXPECTED_COMMA,
+                                   CJSON_CURRENT_POSITION);
+        aRemaining.remove_prefix(aCharWidth);
+        theBuilder.onClose(aIsObject);
+      }
+    }
+#undef CJSON_CURRENT_POSITION
+  }
+
+  /// Moves the pending children of theFrame into the document
+  template <typename DocTy>
+  static Entity closeAggregate(DocTy &theDoc, const Frame &theFrame,
+                               std::vector<Entity> &theChildren,
+                               std::vector<typename DocTy::Property> &theKeys) {
+    const auto aChildrenBegin = theChildren.begin() + theFrame.itsFirstChild;
+    const size_t aNumChildren = theChildren.size() - theFrame.itsFirstChild;
+    const auto aPosition = static_cast<intptr_t>(theDoc.itsEntities.size());
+    theDoc.itsEntities.insert(theDoc.itsEntities.end(), aChildrenBegin,
+                              theChildren.end());
+    theChildren.erase(aChildrenBegin, theChildren.end());
+    if (theFrame.itsIsObject) {
+      auto &aObject = theDoc.itsObjects[theFrame.itsIdx];
+      aObject.itsKeysPos = static_cast<intptr_t>(theDoc.itsObjectProps.size());
+      aObject.itsValuesPos = aPosition;
+      aObject.itsNumProperties = aNumChildren;
+      // Keys of nested objects have been consumed already, so ours are the
+      // last aNumChildren ones
+      const auto aKeysBegin = theKeys.end() - aNumChildren;
+      theDoc.itsObjectProps.insert(theDoc.itsObjectProps.end(), aKeysBegin,
+                                   theKeys.end());
+      theKeys.erase(aKeysBegin, theKeys.end());
+      return Entity{Entity::OBJECT, theFrame.itsIdx};
+    }
+    auto &aArray = theDoc.itsArrays[theFrame.itsIdx];
+    aArray.itsPosition = aPosition;
+    aArray.itsNumElements = aNumChildren;
+    return Entity{Entity::ARRAY, theFrame.itsIdx};
+  }
+
+  /// Growable counterpart of DocumentAllocator::allocateTranscodeString
+  /// @param theString source-encoded json string literal (unquoted)
+  /// @param theSource the input that theString is part of
+  template <typename DocTy>
+  static std::optional<Entity>
+  appendTranscodeString(DocTy &theDoc, std::string_view theString,
+                        const std::string_view theSource,
+                        const SourceEncodingTy &theSrcEnc,
+                        const DestEncodingTy &theDestEnc) {
+    using Position = typename DocTy::Indices::Position;
+    using Size = typename DocTy::Indices::Size;
+    const P p{theSrcEnc};
+    if constexpr (DocTy::Storage::IS_BORROWING) {
+      static_assert(std::is_same_v<SourceEncodingTy, DestEncodingTy>,
+                    "Borrowing documents cannot transcode strings");
+      if (p.isVerbatimString(theString)) {
+        theDoc.itsStrings.push_back(typename DocTy::String{
+            static_cast<Position>(
+                ~static_cast<intptr_t>(theString.data() - theSource.data())),
+            static_cast<Size>(theString.size())});
+        return Entity{Entity::STRING,
+                      static_cast<intptr_t>(theDoc.itsStrings.size() - 1)};
+      }
+    }
+    typename DocTy::String aString{
+        static_cast<Position>(theDoc.itsChars.size()), 0};
+    while (!theString.empty()) {
+      if constexpr (impl::IsAsciiCompatible<DestEncodingTy>::value) {
+        if (const size_t aNumPlain = P::countPlainStringBytes(theString)) {
+          theDoc.itsChars.insert(theDoc.itsChars.end(), theString.begin(),
+                                 theString.begin() + aNumPlain);
+          theString.remove_prefix(aNumPlain);
+          continue;
+        }
+      }
+      const auto [aChar, aCharWidth] = p.parseFirstStringChar(theString);
+      if (aCharWidth <= 0)
+        return std::nullopt;
+      const auto [aBytes, aBytesUsed] = theDestEnc.encode(aChar);
+      if (aBytesUsed <= 0)
+        return std::nullopt;
+      theString.remove_prefix(aCharWidth);
+      theDoc.itsChars.insert(theDoc.itsChars.end(), aBytes.begin(),
+                             aBytes.begin() + aBytesUsed);
+    }
+    aString.itsSize = theDoc.itsChars.size() - aString.itsPosition;
+    theDoc.itsStrings.push_back(aString);
+    return Entity{Entity::STRING,
+                  static_cast<intptr_t>(theDoc.itsStrings.size() - 1)};
+  }
+
+  template <typename DocTy>
+  static ResultTy<DocTy> makeError(const ErrorCode theCode,
+                                   const intptr_t thePosition) {
+    return ErrorHandlingTy::template makeError<DocTy>(theCode, thePosition);
+  }
+};
+} // namespace cjson
+#endif // CONSTEXPR_JSON_DOCUMENT_PARSER3_H
@@ -0,0 +1,415 @@
+#ifndef CONSTEXPR_JSON_DOCUMENT_PARSER4_H
+#define CONSTEXPR_JSON_DOCUMENT_PARSER4_H
+
+#include "constexpr_json/impl/document_parser3.h"
+#include "constexpr_json/impl/structural_index.h"
+
+#include <algorithm>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace cjson {
+/// Configuration of DocumentParser4
+struct ParallelOptions {
+  /// Upper limit of threads to use, 0 means std::thread::hardware_concurrency
+  unsigned itsNumThreads = 0;
+  /// Inputs smaller than this are parsed by DocumentParser3 on the calling
+  /// thread
+  size_t itsMinParallelSize = size_t{1} << 20;
+
+  unsigned getNumThreads() const {
+    if (itsNumThreads)
+      return itsNumThreads;
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+};
+
+/// Multi-threaded variant of DocumentParser3 for large documents
+///
+/// The StructuralIndex of the input is built in chunks in parallel. If the
+/// root is an array or object, its children are then split into one group
+/// per thread at top-level commas. Every group is assembled into a separate
+/// partial document by DocumentParser3's Builder, which are finally merged
+/// into one document, fixing up all indices into the document buffers.
+/// Since every part interns its keys separately, keys of documents with
+/// Storage::INTERNS_KEYS are interned once more after merging.
+///
+/// Should anything go wrong, the input is parsed again by DocumentParser3 to
+/// report the exact error.
+template <typename SourceEncodingTy, typename DestEncodingTy,
+          typename ErrorHandlingTy>
+struct DocumentParser4
+    : public DocumentParser3<SourceEncodingTy, DestEncodingTy,
+                             ErrorHandlingTy> {
+  using BaseClass =
+      DocumentParser3<SourceEncodingTy, DestEncodingTy, ErrorHandlingTy>;
+  template <typename DocTy>
+  using ResultTy = typename ErrorHandlingTy::template ErrorOr<DocTy>;
+
+  using BaseClass::parseDocument;
+
+  /// Parse theJsonString without a precomputed DocumentInfo using the
+  /// default ParallelOptions
+  template <typename DocTy>
+  static ResultTy<DocTy> parseDocument(const std::string_view theJsonString,
+                                       const SourceEncodingTy theSrcEnc = {},
+                                       const DestEncodingTy theDestEnc = {}) {
+    return parseDocument<DocTy>(theJsonString, ParallelOptions{}, theSrcEnc,
+                                theDestEnc);
+  }
+
+  template <typename DocTy>
+  static ResultTy<DocTy> parseDocument(const std::string_view theJsonString,
+                                       const ParallelOptions &theOptions,
+                                       const SourceEncodingTy theSrcEnc = {},
+                                       const DestEncodingTy theDestEnc = {}) {
+    static_assert(DocTy::Storage::IS_GROWABLE,
+                  "Parallel parsing requires growable document storage");
+    static_assert(!DocTy::Storage::DECODES_LAZILY,
+                  "Partial documents of lazy storage cannot be merged");
+    const unsigned aNumThreads = theOptions.getNumThreads();
+    if constexpr (impl::IsAsciiCompatible<SourceEncodingTy>::value) {
+      if (aNumThreads > 1 &&
+          theJsonString.size() >= theOptions.itsMinParallelSize) {
+        impl::StructuralIndex aIndex;
+        if (aIndex.buildParallel(theJsonString, aNumThreads)) {
+          if (auto aDoc = parseIndexed<DocTy>(theJsonString, aIndex,
+                                              aNumThreads, theSrcEnc,
+                                              theDestEnc))
+            return std::move(*aDoc);
+        }
+      }
+    }
+    return BaseClass::template parseDocument<DocTy>(theJsonString, theSrcEnc,
+                                                    theDestEnc);
+  }
+
+private:
+  template <typename DocTy>
+  using Builder = typename BaseClass::template Builder<DocTy>;
+
+  /// Assembles the children of the root in parallel
+  /// @return nullopt if theJson is malformed or the root is neither an
+  /// array nor an object with at least one child
+  template <typename DocTy>
+  static std::optional<DocTy>
+  parseIndexed(const std::string_view theJson,
+               const impl::StructuralIndex &theIndex,
+               const unsigned theNumThreads, const SourceEncodingTy theSrcEnc,
+               const DestEncodingTy theDestEnc) {
+    if (theIndex.size() < 3)
+      return std::nullopt;
+    const uint32_t *const aFirst = theIndex.begin();
+    const uint32_t *const aLast = theIndex.end() - 1;
+    const char aOpen = theJson[*aFirst];
+    const bool aIsObject = aOpen == '{';
+    // The closing bracket of the root has to be the last token, otherwise
+    // there is trailing content
+    if ((aOpen != '[' && !aIsObject) ||
+        theJson[*aLast] != (aIsObject ? '}' : ']'))
+      return std::nullopt;
+    const std::vector<const uint32_t *> aBounds =
+        splitChildren(theJson, aFirst + 1, aLast, theNumThreads);
+
+    const size_t aNumGroups = aBounds.size() - 1;
+    std::vector<std::optional<DocTy>> aParts(aNumGroups);
+    impl::parallelFor(aNumGroups, theNumThreads, [&](const size_t theGroup) {
+      // All but the first group start behind a comma
+      const uint32_t *const aBegin = aBounds[theGroup] + (theGroup > 0);
+      aParts[theGroup] =
+          buildGroup<DocTy>(theJson, aBegin, aBounds[theGroup + 1],
+                            theIndex.end(), aIsObject, theSrcEnc, theDestEnc);
+    });
+    for (const std::optional<DocTy> &aPart : aParts)
+      if (!aPart)
+        return std::nullopt;
+    DocTy aResult = merge<DocTy>(aParts, aIsObject, theNumThreads);
+    if constexpr (DocTy::Storage::INTERNS_KEYS)
+      internKeys(aResult, theJson);
+    return aResult;
+  }
+
+  /// Splits the tokens [theBegin, theEnd) of the root's children into up to
+  /// theNumGroups ranges of roughly the same size at top-level commas
+  /// @return theBegin, the commas separating the ranges and theEnd
+  static std::vector<const uint32_t *>
+  splitChildren(const std::string_view theJson, const uint32_t *const theBegin,
+                const uint32_t *const theEnd, const unsigned theNumGroups) {
+    const auto depthChange = [&](const uint32_t thePos) {
+      switch (theJson[thePos]) {
+      case '[':
+      case '{':
+        return 1;
+      case ']':
+      case '}':
+        return -1;
+      default:
+        return 0;
+      }
+    };
+    const size_t aNumTokens = theEnd - theBegin;
+    const auto chunkBegin = [&](const size_t theChunk) {
+      return theBegin + aNumTokens * theChunk / theNumGroups;
+    };
+    // The nesting depth below the root at the start of each chunk
+    std::vector<intptr_t> aDepths(theNumGroups + 1, 0);
+    impl::parallelFor(theNumGroups, theNumGroups, [&](const size_t theChunk) {
+      for (const uint32_t *aToken = chunkBegin(theChunk);
+           aToken != chunkBegin(theChunk + 1); ++aToken)
+        aDepths[theChunk + 1] += depthChange(*aToken);
+    });
+    for (size_t aChunk = 1; aChunk < aDepths.size(); ++aChunk)
+      aDepths[aChunk] += aDepths[aChunk - 1];
+    // Every chunk looks for the first top-level comma from its start on
+    std::vector<const uint32_t *> aCommas(theNumGroups, theEnd);
+    impl::parallelFor(theNumGroups - 1, theNumGroups, [&](const size_t theIdx) {
+      const size_t aChunk = theIdx + 1;
+      intptr_t aDepth = aDepths[aChunk];
+      for (const uint32_t *aToken = chunkBegin(aChunk); aToken != theEnd;
+           ++aToken) {
+        if (aDepth == 0 && theJson[*aToken] == ',') {
+          aCommas[aChunk] = aToken;
+          break;
+        }
+        aDepth += depthChange(*aToken);
+      }
+    });
+    std::vector<const uint32_t *> aBounds{theBegin};
+    for (size_t aChunk = 1; aChunk < theNumGroups; ++aChunk) {
+      // Chunks within the same child find the same comma
+      if (aCommas[aChunk] != theEnd && aCommas[aChunk] > aBounds.back())
+        aBounds.push_back(aCommas[aChunk]);
+    }
+    aBounds.push_back(theEnd);
+    return aBounds;
+  }
+
+  /// Assembles the children of the root located in the tokens [theBegin,
+  /// theEnd) into a document whose root has only those children
+  template <typename DocTy>
+  static std::optional<DocTy>
+  buildGroup(const std::string_view theJson, const uint32_t *const theBegin,
+             const uint32_t *const theEnd, const uint32_t *const theIndexEnd,
+             const bool theIsObject, const SourceEncodingTy theSrcEnc,
+             const DestEncodingTy theDestEnc) {
+    Builder<DocTy> aBuilder{theSrcEnc, theDestEnc, theJson};
+    aBuilder.onOpen(0, theIsObject);
+    const uint32_t *aToken = theBegin;
+    for (;;) {
+      if (theIsObject) {
+        if (theEnd - aToken < 3 || theJson[aToken[0]] != '"' ||
+            theJson[aToken[2]] != ':')
+          return std::nullopt;
+        const std::string_view aKey{theJson.data() + aToken[0],
+                                    aToken[1] - aToken[0] + 1};
+        if (!aBuilder.onKey(aToken[0], aKey))
+          return std::nullopt;
+        aToken += 3;
+      }
+      if (impl::walkStructuralIndex(theJson, aToken, theIndexEnd, aBuilder) <
+          0)
+        return std::nullopt;
+      if (aToken == theEnd)
+        break;
+      if (aToken > theEnd || theJson[*aToken] != ',')
+        return std::nullopt;
+      ++aToken;
+    }
+    aBuilder.onClose(theIsObject);
+    return std::move(aBuilder.itsDoc);
+  }
+
+  /// Concatenates the buffers of theParts into one document
+  ///
+  /// The root of every part is at index 0 of its kind and its children are
+  /// the last ones in itsEntities (resp. itsObjectProps), since the root is
+  /// closed last. In the result, the children of all roots come first, then
+  /// the remaining entities and properties of the parts in order.
+  template <typename DocTy>
+  static DocTy merge(std::vector<std::optional<DocTy>> &theParts,
+                     const bool theIsObject, const unsigned theNumThreads) {
+    struct Offsets {
+      intptr_t itsNumbers = 0;
+      intptr_t itsChars = 0;
+      intptr_t itsStrings = 0;
+      intptr_t itsArrays = 0;
+      intptr_t itsObjects = 0;
+      /// where the root's children go
+      intptr_t itsChildren = 1;
+      intptr_t itsEntities = 0;
+      intptr_t itsKeys = 0;
+      intptr_t itsProps = 0;
+    };
+    const auto numChildren = [&](const DocTy &thePart) -> intptr_t {
+      return theIsObject ? thePart.itsObjects[0].itsNumProperties
+                         : thePart.itsArrays[0].itsNumElements;
+    };
+    const intptr_t aIsArray = !theIsObject;
+    const intptr_t aIsObject = theIsObject;
+    std::vector<Offsets> aOffsets(theParts.size() + 1);
+    for (size_t aIdx = 0; aIdx < theParts.size(); ++aIdx) {
+      const DocTy &aPart = *theParts[aIdx];
+      const intptr_t aNumChildren = numChildren(aPart);
+      const intptr_t aNumKeys = theIsObject ? aNumChildren : 0;
+      Offsets aNext = aOffsets[aIdx];
+      aNext.itsNumbers += aPart.itsNumbers.size();
+      aNext.itsChars += aPart.itsChars.size();
+      aNext.itsStrings += aPart.itsStrings.size();
+      aNext.itsArrays += aPart.itsArrays.size() - aIsArray;
+      aNext.itsObjects += aPart.itsObjects.size() - aIsObject;
+      aNext.itsChildren += aNumChildren;
+      aNext.itsEntities += aPart.itsEntities.size() - 1 - aNumChildren;
+      aNext.itsKeys += aNumKeys;
+      aNext.itsProps += aPart.itsObjectProps.size() - aNumKeys;
+      aOffsets[aIdx + 1] = aNext;
+    }
+    const Offsets &aTotal = aOffsets.back();
+    DocTy aResult{DocumentInfo{}};
+    aResult.itsNumbers.resize(aTotal.itsNumbers);
+    aResult.itsChars.resize(aTotal.itsChars);
+    aResult.itsStrings.resize(aTotal.itsStrings);
+    aResult.itsArrays.resize(aTotal.itsArrays + aIsArray);
+    aResult.itsObjects.resize(aTotal.itsObjects + aIsObject);
+    aResult.itsEntities.resize(aTotal.itsChildren + aTotal.itsEntities);
+    aResult.itsObjectProps.resize(aTotal.itsKeys + aTotal.itsProps);
+    const intptr_t aNumChildren = aTotal.itsChildren - 1;
+    if (theIsObject) {
+      aResult.itsEntities[0] = Entity{Entity::OBJECT, 0};
+      aResult.itsObjects[0] = typename DocTy::Object{
+          0, 1, static_cast<typename DocTy::Indices::Size>(aNumChildren)};
+    } else {
+      aResult.itsEntities[0] = Entity{Entity::ARRAY, 0};
+      aResult.itsArrays[0] = typename DocTy::Array{
+          1, static_cast<typename DocTy::Indices::Size>(aNumChildren)};
+    }
+
+    impl::parallelFor(theParts.size(), theNumThreads, [&](const size_t theIdx) {
+      const DocTy &aPart = *theParts[theIdx];
+      const Offsets &aOff = aOffsets[theIdx];
+      const intptr_t aPartChildren = numChildren(aPart);
+      const intptr_t aFirstChild = aPart.itsEntities.size() - aPartChildren;
+      const intptr_t aFirstKey = aPart.itsObjectProps.size() -
+                                 (theIsObject ? aPartChildren : 0);
+      // Entities behind the root and in front of its children move to
+      // aTotal.itsChildren + aOff.itsEntities
+      const intptr_t aEntityShift =
+          aTotal.itsChildren + aOff.itsEntities - 1;
+      const intptr_t aPropShift = aTotal.itsKeys + aOff.itsProps;
+      const auto fixEntity = [&](Entity theEntity) {
+        switch (theEntity.itsKind) {
+        case Entity::NUMBER:
+          theEntity.itsPayload += aOff.itsNumbers;
+          break;
+        case Entity::STRING:
+          theEntity.itsPayload += aOff.itsStrings;
+          break;
+        case Entity::ARRAY:
+          theEntity.itsPayload += aOff.itsArrays;
+          break;
+        case Entity::OBJECT:
+          theEntity.itsPayload += aOff.itsObjects;
+          break;
+        default:
+          break;
+        }
+        return theEntity;
+      };
+
+      std::copy(aPart.itsNumbers.begin(), aPart.itsNumbers.end(),
+                aResult.itsNumbers.begin() + aOff.itsNumbers);
+      std::copy(aPart.itsChars.begin(), aPart.itsChars.end(),
+                aResult.itsChars.begin() + aOff.itsChars);
+      for (size_t aIdx = 0; aIdx < aPart.itsStrings.size(); ++aIdx) {
+        auto aString = aPart.itsStrings[aIdx];
+        // Borrowed strings are located relative to the whole input already
+        if (aString.itsPosition >= 0)
+          aString.itsPosition += aOff.itsChars;
+        aResult.itsStrings[aOff.itsStrings + aIdx] = aString;
+      }
+      for (size_t aIdx = aIsArray; aIdx < aPart.itsArrays.size(); ++aIdx) {
+        auto aArray = aPart.itsArrays[aIdx];
+        aArray.itsPosition += aEntityShift;
+        aResult.itsArrays[aOff.itsArrays + aIdx] = aArray;
+      }
+      for (size_t aIdx = aIsObject; aIdx < aPart.itsObjects.size(); ++aIdx) {
+        auto aObject = aPart.itsObjects[aIdx];
+        aObject.itsKeysPos += aPropShift;
+        aObject.itsValuesPos += aEntityShift;
+        aResult.itsObjects[aOff.itsObjects + aIdx] = aObject;
+      }
+      for (intptr_t aIdx = 1; aIdx < aFirstChild; ++aIdx)
+        aResult.itsEntities[aIdx + aEntityShift] =
+            fixEntity(aPart.itsEntities[aIdx]);
+      for (intptr_t aIdx = aFirstChild;
+           static_cast<size_t>(aIdx) < aPart.itsEntities.size(); ++aIdx)
+        aResult.itsEntities[aOff.itsChildren + aIdx - aFirstChild] =
+            fixEntity(aPart.itsEntities[aIdx]);
+      for (size_t aIdx = 0; aIdx < aPart.itsObjectProps.size(); ++aIdx) {
+        auto aProp = aPart.itsObjectProps[aIdx];
+        aProp.itsKeyPos += aOff.itsStrings;
+        const intptr_t aDest =
+            static_cast<intptr_t>(aIdx) < aFirstKey
+                ? aPropShift + aIdx
+                : aOff.itsKeys + aIdx - aFirstKey;
+        aResult.itsObjectProps[aDest] = aProp;
+      }
+    });
+    return aResult;
+  }
+
+  /// Lets all properties of theDoc with equal keys reference the same
+  /// String, like DocumentParser3 does while parsing, and drops the strings
+  /// of the keys which become unused, along with their chars
+  /// @param theJson the input which borrowing documents reference strings in
+  template <typename DocTy>
+  static void internKeys(DocTy &theDoc, const std::string_view theJson) {
+    using Indices = typename DocTy::Indices;
+    impl::KeyInterner aInterner;
+    // Every key string of a part is referenced by properties only, so it is
+    // unused once its properties have been redirected to an equal key
+    std::vector<intptr_t> aInterned(theDoc.itsStrings.size(), -1);
+    bool aHasUnused = false;
+    for (auto &aProp : theDoc.itsObjectProps) {
+      intptr_t &aKeyPos = aInterned[aProp.itsKeyPos];
+      if (aKeyPos < 0) {
+        aKeyPos = aInterner.intern(theDoc, theJson, aProp.itsKeyPos);
+        aHasUnused |= aKeyPos != aProp.itsKeyPos;
+      }
+      aProp.itsKeyPos = static_cast<typename Indices::Position>(aKeyPos);
+    }
+    if (!aHasUnused)
+      return;
+    // Compact itsStrings and itsChars, keeping the order of the strings
+    std::vector<intptr_t> aNewIdx(theDoc.itsStrings.size(), -1);
+    std::vector<char> aChars;
+    aChars.reserve(theDoc.itsChars.size());
+    size_t aNumStrings = 0;
+    for (size_t aIdx = 0; aIdx < theDoc.itsStrings.size(); ++aIdx) {
+      const bool aIsUnused = aInterned[aIdx] >= 0 &&
+                             aInterned[aIdx] != static_cast<intptr_t>(aIdx);
+      if (aIsUnused)
+        continue;
+      auto aString = theDoc.itsStrings[aIdx];
+      if (aString.itsPosition >= 0) {
+        const auto aBegin = theDoc.itsChars.begin() + aString.itsPosition;
+        aString.itsPosition =
+            static_cast<typename Indices::Position>(aChars.size());
+        aChars.insert(aChars.end(), aBegin, aBegin + aString.itsSize);
+      }
+      aNewIdx[aIdx] = static_cast<intptr_t>(aNumStrings);
+      theDoc.itsStrings[aNumStrings++] = aString;
+    }
+    theDoc.itsStrings.resize(aNumStrings);
+    theDoc.itsChars.resize(aChars.size());
+    std::copy(aChars.begin(), aChars.end(), theDoc.itsChars.begin());
+    for (auto &aProp : theDoc.itsObjectProps)
+      aProp.itsKeyPos =
+          static_cast<typename Indices::Position>(aNewIdx[aProp.itsKeyPos]);
+    for (Entity &aEntity : theDoc.itsEntities)
+      if (aEntity.itsKind == Entity::STRING)
+        aEntity.itsPayload = aNewIdx[aEntity.itsPayload];
+  }
+};
+} // namespace cjson
+#endif // CONSTEXPR_JSON_DOCUMENT_PARSER4_H
@@ -0,0 +1,39 @@
+#ifndef CONSTEXPR_JSON_HASHING_H
+#define CONSTEXPR_JSON_HASHING_H
+
+#include <cstdint>
+#include <string_view>
+
+namespace cjson {
+namespace impl {
+/// 64 bit FNV-1a hash of theStr. Object keys are short, so a simple
+/// bytewise hash beats the setup cost of anything faster on long inputs.
+constexpr uint64_t hashString(const std::string_view theStr) noexcept {
+  uint64_t aHash = 0xcbf29ce484222325ull;
+  for (const char aChar : theStr) {
+    aHash ^= static_cast<unsigned char>(aChar);
+    aHash *= 0x100000001b3ull;
+  }
+  return aHash;
+}
+
+/// Scrambles the bits of theHash so that each of them affects all others
+/// (the finalizer of MurmurHash3)
+constexpr uint64_t mixHash(uint64_t theHash) noexcept {
+  theHash ^= theHash >> 33;
+  theHash *= 0xff51afd7ed558ccdull;
+  theHash ^= theHash >> 33;
+  theHash *= 0xc4ceb9fe1a85ec53ull;
+  theHash ^= theHash >> 33;
+  return theHash;
+}
+
+/// @return the hash of the sequence theSeed was computed for, followed by
+/// theHash. Unlike adding up hashes, this depends on their order.
+constexpr uint64_t combineHashes(const uint64_t theSeed,
+                                 const uint64_t theHash) noexcept {
+  return mixHash(theSeed * 0x9e3779b97f4a7c15ull + theHash);
+}
+} // namespace impl
+} // namespace cjson
+#endif // CONSTEXPR_JSON_HASHING_H
@@ -0,0 +1,83 @@
+#ifndef CONSTEXPR_JSON_KEY_INTERNING_H
+#define CONSTEXPR_JSON_KEY_INTERNING_H
+
+#include "constexpr_json/impl/document_entities.h"
+#include "constexpr_json/impl/hashing.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace cjson {
+namespace impl {
+/// Hash set over the object keys of a document under construction. Parsers
+/// of documents with Storage::INTERNS_KEYS use it to let all properties with
+/// equal keys reference the same String. It is discarded after parsing.
+class KeyInterner {
+public:
+  /// Looks for a key which is equal to the string theStrIdx of theDoc
+  /// among all keys seen before. If there is none, theStrIdx is added.
+  /// @param theSource the input which borrowing documents reference strings in
+  /// @return the index of the string of the equal key or theStrIdx
+  template <typename DocTy>
+  intptr_t intern(const DocTy &theDoc, const std::string_view theSource,
+                  const intptr_t theStrIdx) {
+    if (2 * (itsNumKeys + 1) > itsSlots.size())
+      grow();
+    const std::string_view aKey = peekString(theDoc, theSource, theStrIdx);
+    const uint64_t aHash = hashString(aKey);
+    const size_t aMask = itsSlots.size() - 1;
+    for (size_t aSlot = aHash & aMask;; aSlot = (aSlot + 1) & aMask) {
+      Slot &aEntry = itsSlots[aSlot];
+      if (aEntry.itsStrIdx < 0) {
+        aEntry = Slot{aHash, theStrIdx};
+        ++itsNumKeys;
+        return theStrIdx;
+      }
+      if (aEntry.itsHash == aHash &&
+          peekString(theDoc, theSource, aEntry.itsStrIdx) == aKey)
+        return aEntry.itsStrIdx;
+    }
+  }
+
+  /// Forgets all keys, keeping the memory of the table
+  void clear() {
+    std::fill(itsSlots.begin(), itsSlots.end(), Slot{});
+    itsNumKeys = 0;
+  }
+
+private:
+  struct Slot {
+    uint64_t itsHash = 0;
+    /// -1 if the slot is empty
+    intptr_t itsStrIdx = -1;
+  };
+
+  /// Doubles the number of slots, keeping the load factor at or below 1/2
+  void grow() {
+    std::vector<Slot> aOld(std::max<size_t>(32, 2 * itsSlots.size()));
+    aOld.swap(itsSlots);
+    const size_t aMask = itsSlots.size() - 1;
+    for (const Slot &aEntry : aOld) {
+      if (aEntry.itsStrIdx < 0)
+        continue;
+      size_t aSlot = aEntry.itsHash & aMask;
+      while (itsSlots[aSlot].itsStrIdx >= 0)
+        aSlot = (aSlot + 1) & aMask;
+      itsSlots[aSlot] = aEntry;
+    }
+  }
+
+  std::vector<Slot> itsSlots;
+  size_t itsNumKeys = 0;
+};
+
+/// Base of parser state which only holds a KeyInterner if theInternsKeys
+template <bool theInternsKeys> struct KeyInterning {};
+template <> struct KeyInterning<true> {
+  KeyInterner itsKeyInterner;
+};
+} // namespace impl
+} // namespace cjson
+#endif // CONSTEXPR_JSON_KEY_INTERNING_H
@@ -0,0 +1,77 @@
+#ifndef CONSTEXPR_JSON_NESTING_STACK_H
+#define CONSTEXPR_JSON_NESTING_STACK_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace cjson {
+namespace impl {
+/// Records whether the enclosing aggregates of the current value are arrays or
+/// objects, using a single bit per nesting level.
+///
+/// This variant has a fixed capacity so that it can be used during constant
+/// evaluation.
+template <size_t CapacityWords> class FixedNestingStack {
+public:
+  /// @return false if the stack is full
+  constexpr bool push(const bool theIsObject) noexcept {
+    if (itsSize == CapacityWords * 64)
+      return false;
+    uint64_t &aWord = itsBits[itsSize / 64];
+    const uint64_t aBit = uint64_t{1} << (itsSize % 64);
+    aWord = theIsObject ? (aWord | aBit) : (aWord & ~aBit);
+    ++itsSize;
+    return true;
+  }
+  constexpr void pop() noexcept { --itsSize; }
+  /// @return whether the innermost aggregate is an object
+  constexpr bool top() const noexcept {
+    return (itsBits[(itsSize - 1) / 64] >> ((itsSize - 1) % 64)) & 1;
+  }
+  constexpr bool empty() const noexcept { return itsSize == 0; }
+  constexpr size_t size() const noexcept { return itsSize; }
+
+private:
+  std::array<uint64_t, CapacityWords> itsBits{};
+  size_t itsSize = 0;
+};
+
+/// Runtime variant of FixedNestingStack, which is only limited by memory
+///
+/// The first 64 levels are stored inline, so that the stack only allocates
+/// for deeply nested documents.
+class DynamicNestingStack {
+public:
+  bool push(const bool theIsObject) {
+    if (itsSize >= 64 && itsSize % 64 == 0)
+      itsMoreBits.push_back(0);
+    uint64_t &aWord = word(itsSize);
+    const uint64_t aBit = uint64_t{1} << (itsSize % 64);
+    aWord = theIsObject ? (aWord | aBit) : (aWord & ~aBit);
+    ++itsSize;
+    return true;
+  }
+  void pop() noexcept {
+    if (--itsSize >= 64 && itsSize % 64 == 0)
+      itsMoreBits.pop_back();
+  }
+  bool top() const noexcept {
+    const uint64_t aWord = itsSize > 64 ? itsMoreBits.back() : itsFirstBits;
+    return (aWord >> ((itsSize - 1) % 64)) & 1;
+  }
+  bool empty() const noexcept { return itsSize == 0; }
+  size_t size() const noexcept { return itsSize; }
+
+private:
+  uint64_t &word(const size_t theLevel) {
+    return theLevel < 64 ? itsFirstBits : itsMoreBits[theLevel / 64 - 1];
+  }
+
+  uint64_t itsFirstBits = 0;
+  std::vector<uint64_t> itsMoreBits;
+  size_t itsSize = 0;
+};
+} // namespace impl
+} // namespace cjson
+#endif // CONSTEXPR_JSON_NESTING_STACK_H
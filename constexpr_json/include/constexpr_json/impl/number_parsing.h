@@ -0,0 +1,430 @@
+#ifndef CONSTEXPR_JSON_NUMBER_PARSING_H
+#define CONSTEXPR_JSON_NUMBER_PARSING_H
+
+#include "constexpr_json/impl/compiler_support.h"
+#include "constexpr_json/impl/powers_of_five.h"
+
+#include <array>
+#include <cfloat>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace cjson {
+namespace impl {
+/// The binary significand (without the implicit bit) and the biased binary
+/// exponent of a double. A biased exponent of 0 denotes subnormals, 0x7ff
+/// infinity.
+struct AdjustedMantissa {
+  uint64_t itsMantissa = 0;
+  int32_t itsPower2 = 0;
+
+  constexpr bool operator==(const AdjustedMantissa &theOther) const noexcept {
+    return itsMantissa == theOther.itsMantissa &&
+           itsPower2 == theOther.itsPower2;
+  }
+  constexpr bool operator!=(const AdjustedMantissa &theOther) const noexcept {
+    return !(*this == theOther);
+  }
+};
+
+static constexpr int MANTISSA_EXPLICIT_BITS = 52;
+static constexpr int32_t INFINITE_POWER = 0x7ff;
+static constexpr AdjustedMantissa INFINITE_MANTISSA{0, INFINITE_POWER};
+/// Decimal significands with up to this many digits fit into a uint64_t
+static constexpr int MAX_MANTISSA_DIGITS = 19;
+
+/// The two halves of a 128 bit integer
+struct Product128 {
+  uint64_t itsLow = 0;
+  uint64_t itsHigh = 0;
+};
+
+constexpr Product128 multiplyFull(const uint64_t theA, const uint64_t theB) {
+#if defined(__SIZEOF_INT128__)
+  __extension__ using UInt128 = unsigned __int128;
+  const UInt128 aProduct = static_cast<UInt128>(theA) * theB;
+  return {static_cast<uint64_t>(aProduct),
+          static_cast<uint64_t>(aProduct >> 64)};
+#else
+  constexpr uint64_t LOW_HALF = 0xffffffffULL;
+  const uint64_t aLowLow = (theA & LOW_HALF) * (theB & LOW_HALF);
+  const uint64_t aHighLow = (theA >> 32) * (theB & LOW_HALF);
+  const uint64_t aLowHigh = (theA & LOW_HALF) * (theB >> 32);
+  const uint64_t aHighHigh = (theA >> 32) * (theB >> 32);
+  const uint64_t aCross = (aLowLow >> 32) + (aHighLow & LOW_HALF) + aLowHigh;
+  return {(aCross << 32) | (aLowLow & LOW_HALF),
+          (aHighLow >> 32) + (aCross >> 32) + aHighHigh};
+#endif
+}
+
+/// Converts theMantissa * 10^thePower10 to the nearest double using the
+/// algorithm by Daniel Lemire and Michael Eisel ("Number Parsing at a
+/// Gigabyte per Second"), as implemented by the fast_float library.
+///
+/// The result is exact as long as theMantissa holds all digits of the
+/// number. For truncated significands, callers compare the results for
+/// theMantissa and theMantissa + 1.
+constexpr AdjustedMantissa computeFloat(const int64_t thePower10,
+                                        uint64_t theMantissa) {
+  if (theMantissa == 0 || thePower10 < SMALLEST_POWER_OF_TEN)
+    return {};
+  if (thePower10 > LARGEST_POWER_OF_TEN)
+    return INFINITE_MANTISSA;
+  const int aLeadingZeros = countLeadingZeros(theMantissa);
+  theMantissa <<= aLeadingZeros;
+
+  // We need 55 significant bits of the product. Only if the low bits of the
+  // truncated product are all ones does the second half of the power matter.
+  const auto aIdx = 2 * static_cast<size_t>(thePower10 - SMALLEST_POWER_OF_TEN);
+  Product128 aProduct = multiplyFull(theMantissa, POWERS_OF_FIVE_128[aIdx]);
+  constexpr uint64_t PRECISION_MASK = 0xffffffffffffffffULL >> 55;
+  if ((aProduct.itsHigh & PRECISION_MASK) == PRECISION_MASK) {
+    const Product128 aSecond =
+        multiplyFull(theMantissa, POWERS_OF_FIVE_128[aIdx + 1]);
+    aProduct.itsLow += aSecond.itsHigh;
+    if (aSecond.itsHigh > aProduct.itsLow)
+      ++aProduct.itsHigh;
+  }
+
+  const int aUpperBit = static_cast<int>(aProduct.itsHigh >> 63);
+  const int aShift = aUpperBit + 64 - MANTISSA_EXPLICIT_BITS - 3;
+  AdjustedMantissa aResult;
+  aResult.itsMantissa = aProduct.itsHigh >> aShift;
+  // floor(log2(10^q)) == floor(q * log2(10)) for the supported range of q
+  const auto aPower10 = static_cast<int32_t>(thePower10);
+  const int32_t aPower2 = (((152170 + 65536) * aPower10) >> 16) + 63;
+  aResult.itsPower2 = aPower2 + aUpperBit - aLeadingZeros + 1023;
+
+  if (aResult.itsPower2 <= 0) {
+    // Subnormal or zero
+    if (-aResult.itsPower2 + 1 >= 64)
+      return {};
+    aResult.itsMantissa >>= -aResult.itsPower2 + 1;
+    aResult.itsMantissa += aResult.itsMantissa & 1;
+    aResult.itsMantissa >>= 1;
+    // Rounding up may have produced the smallest normal number
+    aResult.itsPower2 =
+        aResult.itsMantissa < (uint64_t{1} << MANTISSA_EXPLICIT_BITS) ? 0 : 1;
+    return aResult;
+  }
+
+  // Exactly halfway between two doubles: round to even. This can only happen
+  // for small powers of ten, where the product is exact.
+  if (aProduct.itsLow <= 1 && thePower10 >= -4 && thePower10 <= 23 &&
+      (aResult.itsMantissa & 3) == 1 &&
+      (aResult.itsMantissa << aShift) == aProduct.itsHigh)
+    aResult.itsMantissa &= ~uint64_t{1};
+
+  aResult.itsMantissa += aResult.itsMantissa & 1;
+  aResult.itsMantissa >>= 1;
+  if (aResult.itsMantissa >= (uint64_t{2} << MANTISSA_EXPLICIT_BITS)) {
+    aResult.itsMantissa = uint64_t{1} << MANTISSA_EXPLICIT_BITS;
+    ++aResult.itsPower2;
+  }
+  aResult.itsMantissa &= ~(uint64_t{1} << MANTISSA_EXPLICIT_BITS);
+  if (aResult.itsPower2 >= INFINITE_POWER)
+    return INFINITE_MANTISSA;
+  return aResult;
+}
+
+/// Arbitrary precision decimal number for the rare inputs which the fast
+/// algorithms cannot round correctly, i.e. those with more than 19
+/// significant digits very close to the midpoint between two doubles.
+///
+/// This is the "simple decimal conversion" known from Go's strconv package:
+/// the number is scaled into [1, 2) by repeated binary shifts of its
+/// decimal digits and the significand is read off at the end.
+class DecimalNumber {
+public:
+  /// Feed digits in the order in which they appear in the json number
+  constexpr void pushDigit(const uint8_t theDigit) noexcept {
+    if (theDigit == 0 && itsNumDigits == 0) {
+      // Leading zeros only move the decimal point
+      --itsDecimalPoint;
+      return;
+    }
+    if (itsNumDigits < MAX_DIGITS)
+      itsDigits[itsNumDigits++] = theDigit;
+    else if (theDigit != 0)
+      itsTruncated = true;
+  }
+  /// Call after the last digit of the integer part
+  constexpr void markDecimalPoint() noexcept { itsDecimalPoint = itsNumDigits; }
+  constexpr void addExponent(const int64_t theExponent) noexcept {
+    itsDecimalPoint += theExponent;
+  }
+
+  /// @return the correctly rounded double. Destroys the digits.
+  constexpr AdjustedMantissa toBinary() noexcept {
+    if (itsNumDigits == 0 || itsDecimalPoint < -330)
+      return {};
+    if (itsDecimalPoint > 310)
+      return INFINITE_MANTISSA;
+    // Scale into [0.5, 1)
+    int32_t aPower2 = 0;
+    while (itsDecimalPoint > 0) {
+      const int aShift = shiftForDecimalPoint(itsDecimalPoint);
+      shift(-aShift);
+      aPower2 += aShift;
+    }
+    while (itsDecimalPoint < 0 ||
+           (itsDecimalPoint == 0 && itsDigits[0] < 5)) {
+      const int aShift = shiftForDecimalPoint(-itsDecimalPoint);
+      shift(aShift);
+      aPower2 -= aShift;
+    }
+    // Doubles are normalized to [1, 2)
+    --aPower2;
+    if (aPower2 < -1022) {
+      shift(aPower2 + 1022);
+      aPower2 = -1022;
+    }
+    if (aPower2 + 1023 >= INFINITE_POWER)
+      return INFINITE_MANTISSA;
+    shift(MANTISSA_EXPLICIT_BITS + 1);
+    uint64_t aMantissa = roundedInteger();
+    if (aMantissa == (uint64_t{2} << MANTISSA_EXPLICIT_BITS)) {
+      // Rounding up overflowed into the next power of two
+      aMantissa >>= 1;
+      if (++aPower2 + 1023 >= INFINITE_POWER)
+        return INFINITE_MANTISSA;
+    }
+    if (!(aMantissa & (uint64_t{1} << MANTISSA_EXPLICIT_BITS)))
+      aPower2 = -1023;
+    return {aMantissa & ((uint64_t{1} << MANTISSA_EXPLICIT_BITS) - 1),
+            aPower2 + 1023};
+  }
+
+private:
+  /// Enough to round any double correctly: the exact decimal representation
+  /// of a double has at most 767 significant digits
+  static constexpr int MAX_DIGITS = 800;
+  /// The largest shift whose carries still fit into a uint64_t
+  static constexpr int MAX_SHIFT = 60;
+
+  std::array<uint8_t, MAX_DIGITS> itsDigits{};
+  int itsNumDigits = 0;
+  int64_t itsDecimalPoint = 0;
+  /// Whether non-zero digits were discarded behind itsDigits
+  bool itsTruncated = false;
+
+  /// @return a binary shift which moves the decimal point by about theDigits
+  static constexpr int shiftForDecimalPoint(const int64_t theDigits) noexcept {
+    constexpr int POWERS[] = {1, 3, 6, 9, 13, 16, 19, 23, 26};
+    return theDigits < 9 ? POWERS[theDigits] : 27;
+  }
+
+  constexpr void shift(int theShift) noexcept {
+    if (itsNumDigits == 0)
+      return;
+    for (; theShift > MAX_SHIFT; theShift -= MAX_SHIFT)
+      leftShift(MAX_SHIFT);
+    for (; theShift < -MAX_SHIFT; theShift += MAX_SHIFT)
+      rightShift(MAX_SHIFT);
+    if (theShift > 0)
+      leftShift(theShift);
+    else if (theShift < 0)
+      rightShift(-theShift);
+  }
+
+  constexpr void leftShift(const int theShift) noexcept {
+    // A shift by at most MAX_SHIFT bits adds at most 19 digits in front
+    constexpr int MAX_NEW_DIGITS = 19;
+    std::array<uint8_t, MAX_DIGITS + MAX_NEW_DIGITS> aShifted{};
+    int aWrite = itsNumDigits + MAX_NEW_DIGITS;
+    uint64_t aCarry = 0;
+    for (int aRead = itsNumDigits - 1; aRead >= 0; --aRead) {
+      aCarry += uint64_t{itsDigits[aRead]} << theShift;
+      aShifted[--aWrite] = static_cast<uint8_t>(aCarry % 10);
+      aCarry /= 10;
+    }
+    for (; aCarry > 0; aCarry /= 10)
+      aShifted[--aWrite] = static_cast<uint8_t>(aCarry % 10);
+    const int aNumShifted = itsNumDigits + MAX_NEW_DIGITS - aWrite;
+    itsDecimalPoint += aNumShifted - itsNumDigits;
+    itsNumDigits = aNumShifted < MAX_DIGITS ? aNumShifted : MAX_DIGITS;
+    for (int i = 0; i < aNumShifted; ++i) {
+      if (i < itsNumDigits)
+        itsDigits[i] = aShifted[aWrite + i];
+      else if (aShifted[aWrite + i] != 0)
+        itsTruncated = true;
+    }
+    trim();
+  }
+
+  constexpr void rightShift(const int theShift) noexcept {
+    int aRead = 0;
+    int aWrite = 0;
+    uint64_t aAcc = 0;
+    // Pick up enough leading digits to produce the first output digit
+    for (; (aAcc >> theShift) == 0; ++aRead) {
+      if (aRead >= itsNumDigits) {
+        if (aAcc == 0) {
+          itsNumDigits = 0;
+          return;
+        }
+        for (; (aAcc >> theShift) == 0; ++aRead)
+          aAcc *= 10;
+        break;
+      }
+      aAcc = aAcc * 10 + itsDigits[aRead];
+    }
+    itsDecimalPoint -= aRead - 1;
+    const uint64_t aMask = (uint64_t{1} << theShift) - 1;
+    for (; aRead < itsNumDigits; ++aRead) {
+      itsDigits[aWrite++] = static_cast<uint8_t>(aAcc >> theShift);
+      aAcc = (aAcc & aMask) * 10 + itsDigits[aRead];
+    }
+    for (; aAcc > 0; aAcc = (aAcc & aMask) * 10) {
+      const auto aDigit = static_cast<uint8_t>(aAcc >> theShift);
+      if (aWrite < MAX_DIGITS)
+        itsDigits[aWrite++] = aDigit;
+      else if (aDigit > 0)
+        itsTruncated = true;
+    }
+    itsNumDigits = aWrite;
+    trim();
+  }
+
+  constexpr void trim() noexcept {
+    while (itsNumDigits > 0 && itsDigits[itsNumDigits - 1] == 0)
+      --itsNumDigits;
+    if (itsNumDigits == 0)
+      itsDecimalPoint = 0;
+  }
+
+  /// @return the integer part, rounded half to even
+  constexpr uint64_t roundedInteger() const noexcept {
+    if (itsDecimalPoint > 20)
+      return 0xffffffffffffffffULL;
+    const int aEnd = static_cast<int>(itsDecimalPoint);
+    uint64_t aResult = 0;
+    for (int i = 0; i < aEnd; ++i)
+      aResult = aResult * 10 + (i < itsNumDigits ? itsDigits[i] : 0);
+    if (aEnd < 0 || aEnd >= itsNumDigits)
+      return aResult;
+    bool aRoundUp = itsDigits[aEnd] >= 5;
+    if (itsDigits[aEnd] == 5 && aEnd + 1 == itsNumDigits && !itsTruncated)
+      // Exactly halfway
+      aRoundUp = aEnd > 0 && itsDigits[aEnd - 1] % 2 == 1;
+    return aResult + aRoundUp;
+  }
+};
+
+/// Powers of ten which are exactly representable as doubles
+static constexpr double EXACT_POWERS_OF_TEN[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/// @return 2^theExponent for theExponent in [-1022, 1023]
+constexpr double powerOfTwo(const int theExponent) noexcept {
+  double aBase = theExponent < 0 ? .5 : 2.;
+  unsigned aRemaining = theExponent < 0 ? -theExponent : theExponent;
+  double aResult = 1.;
+  for (;;) {
+    if (aRemaining & 1)
+      aResult *= aBase;
+    aRemaining >>= 1;
+    if (!aRemaining)
+      return aResult;
+    aBase *= aBase;
+  }
+}
+
+constexpr double toDouble(const bool theNegative,
+                          const AdjustedMantissa &theValue) noexcept {
+  if (!CJSON_IS_CONSTANT_EVALUATED()) {
+    uint64_t aBits = theValue.itsMantissa |
+                     uint64_t(theValue.itsPower2) << MANTISSA_EXPLICIT_BITS;
+    aBits |= uint64_t(theNegative) << 63;
+    double aResult = 0.;
+    std::memcpy(&aResult, &aBits, sizeof(aResult));
+    return aResult;
+  }
+  // Without bit casts, build the double from products with powers of two.
+  // Each of them is exact, so no rounding takes place.
+  double aResult = std::numeric_limits<double>::infinity();
+  if (theValue.itsPower2 != INFINITE_POWER) {
+    const int aExponent =
+        theValue.itsPower2 == 0 ? -1022 : theValue.itsPower2 - 1023;
+    uint64_t aMantissa = theValue.itsMantissa;
+    if (theValue.itsPower2 != 0)
+      aMantissa |= uint64_t{1} << MANTISSA_EXPLICIT_BITS;
+    aResult = static_cast<double>(aMantissa) *
+              powerOfTwo(-MANTISSA_EXPLICIT_BITS) * powerOfTwo(aExponent);
+  }
+  return theNegative ? -aResult : aResult;
+}
+
+/// Converts a decimal number to the nearest double.
+///
+/// @param theMantissa the first (up to) 19 significant digits
+/// @param thePower10 the decimal exponent of theMantissa's last digit
+/// @param theTruncated whether non-zero digits did not fit into theMantissa
+/// @param theReadDigits fills a DecimalNumber with all digits of the number
+///        in case the fast algorithms cannot round correctly
+template <typename ReadDigitsTy>
+constexpr double computeDouble(const bool theNegative,
+                               const uint64_t theMantissa,
+                               const int64_t thePower10,
+                               const bool theTruncated,
+                               ReadDigitsTy &&theReadDigits) {
+  if (!theTruncated) {
+    // Integers (int64 and beyond): a single, correctly rounded conversion
+    if (thePower10 == 0) {
+      const auto aResult = static_cast<double>(theMantissa);
+      return theNegative ? -aResult : aResult;
+    }
+    // Clinger's fast path: both operands are exact, so is the quotient or
+    // product after rounding. Requires the FPU to round to double precision.
+    if (FLT_EVAL_METHOD == 0 && theMantissa <= (uint64_t{1} << 53) &&
+        thePower10 >= -22 && thePower10 <= 22) {
+      auto aResult = static_cast<double>(theMantissa);
+      if (thePower10 < 0)
+        aResult /= EXACT_POWERS_OF_TEN[-thePower10];
+      else
+        aResult *= EXACT_POWERS_OF_TEN[thePower10];
+      return theNegative ? -aResult : aResult;
+    }
+  }
+  AdjustedMantissa aResult = computeFloat(thePower10, theMantissa);
+  if (theTruncated && aResult != computeFloat(thePower10, theMantissa + 1)) {
+    DecimalNumber aDecimal;
+    theReadDigits(aDecimal);
+    aResult = aDecimal.toBinary();
+  }
+  return toDouble(theNegative, aResult);
+}
+
+/// Runtime-only helpers to parse eight ASCII digits at once, see
+/// "Faster Integer Parsing" by Kholdstare and the fast_float library.
+///
+/// @return theChars in little endian byte order
+inline uint64_t loadEightBytes(const char *const theChars) noexcept {
+  uint64_t aWord;
+  std::memcpy(&aWord, theChars, sizeof(aWord));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  aWord = __builtin_bswap64(aWord);
+#endif
+  return aWord;
+}
+constexpr bool isEightDigits(const uint64_t theWord) noexcept {
+  return ((theWord & 0xf0f0f0f0f0f0f0f0ULL) |
+          (((theWord + 0x0606060606060606ULL) & 0xf0f0f0f0f0f0f0f0ULL) >> 4)) ==
+         0x3333333333333333ULL;
+}
+constexpr uint32_t parseEightDigits(uint64_t theWord) noexcept {
+  constexpr uint64_t MASK = 0x000000ff000000ffULL;
+  constexpr uint64_t MUL1 = 100 + (1000000ULL << 32);
+  constexpr uint64_t MUL2 = 1 + (10000ULL << 32);
+  theWord -= 0x3030303030303030ULL;
+  // Combine adjacent digits to two-digit numbers, then those to eight digits
+  theWord = (theWord * 10) + (theWord >> 8);
+  theWord = (((theWord & MASK) * MUL1) + (((theWord >> 16) & MASK) * MUL2)) >>
+            32;
+  return static_cast<uint32_t>(theWord);
+}
+} // namespace impl
+} // namespace cjson
+#endif // CONSTEXPR_JSON_NUMBER_PARSING_H
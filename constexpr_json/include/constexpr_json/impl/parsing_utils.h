@@ -1,6 +1,10 @@
 #ifndef CONSTEXPR_JSON_UTILS_PARSING_H
 #define CONSTEXPR_JSON_UTILS_PARSING_H
 
+#include "constexpr_json/impl/ascii_scanning.h"
+#include "constexpr_json/impl/compiler_support.h"
+#include "constexpr_json/impl/number_parsing.h"
+
 #include <cassert>
 #include <optional>
 #include <string_view>
@@ -23,6 +27,63 @@ private:
            ('a' <= theChar && theChar <= 'f');
   }
 
+  /// Like decodeFirst, but only for ASCII characters, which is all that
+  /// numbers consist of. Avoids the full decoder for ASCII-compatible
+  /// encodings.
+  /// @return the character and its width, or (0, 0) for non-ASCII input
+  constexpr std::pair<CharT, size_t>
+  decodeFirstAscii(const std::string_view theString) const {
+    if constexpr (impl::IsAsciiCompatible<EncodingTy>::value) {
+      if (theString.empty() || static_cast<unsigned char>(theString[0]) >= 0x80)
+        return {0, 0};
+      return {static_cast<CharT>(theString[0]), 1};
+    } else {
+      const auto [aChar, aCharWidth] = decodeFirst(theString);
+      if (aCharWidth <= 0 || aChar >= 0x80)
+        return {0, 0};
+      return {aChar, aCharWidth};
+    }
+  }
+
+  /// Consumes the leading digits of theString and appends them to theValue,
+  /// which silently wraps around after 19 digits.
+  /// @return the number of digits consumed
+  constexpr intptr_t accumulateDigits(std::string_view &theString,
+                                      uint64_t &theValue) const {
+    intptr_t aNumDigits = 0;
+    if constexpr (impl::IsAsciiCompatible<EncodingTy>::value) {
+      if (!CJSON_IS_CONSTANT_EVALUATED()) {
+        while (theString.size() >= 8) {
+          const uint64_t aWord = impl::loadEightBytes(theString.data());
+          if (!impl::isEightDigits(aWord))
+            break;
+          theValue = theValue * 100000000 + impl::parseEightDigits(aWord);
+          theString.remove_prefix(8);
+          aNumDigits += 8;
+        }
+      }
+    }
+    for (;;) {
+      const auto [aChar, aCharWidth] = decodeFirstAscii(theString);
+      if (!isdigit(aChar))
+        return aNumDigits;
+      theValue = theValue * 10 + static_cast<uint64_t>(aChar - '0');
+      theString.remove_prefix(aCharWidth);
+      ++aNumDigits;
+    }
+  }
+
+  /// Calls theCallback with the value of each digit in theDigits
+  template <typename CallbackTy>
+  constexpr void forEachDigit(std::string_view theDigits,
+                              CallbackTy &&theCallback) const {
+    while (!theDigits.empty()) {
+      const auto [aChar, aCharWidth] = decodeFirstAscii(theDigits);
+      theCallback(static_cast<uint8_t>(aChar - '0'));
+      theDigits.remove_prefix(aCharWidth);
+    }
+  }
+
 public:
   constexpr parsing(const EncodingTy theEncoding = EncodingTy{})
       : itsEncoding{theEncoding} {}
@@ -33,6 +94,50 @@ public:
 
   enum class Type { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT };
 
+  /// @return the number of leading bytes of theString which are printable
+  /// ASCII characters other than '"' and '\\'. These need neither decoding
+  /// nor validation inside of strings. Always 0 in constant evaluation.
+  constexpr static size_t countPlainStringBytes(std::string_view theString) {
+    if constexpr (impl::IsAsciiCompatible<EncodingTy>::value) {
+      if (!CJSON_IS_CONSTANT_EVALUATED())
+        return impl::countPlainAscii(theString);
+    }
+    return 0;
+  }
+
+  /// @return true if the unquoted string literal theString is valid and
+  /// contains no escape sequences, i.e. it reads the same after transcoding
+  /// it into EncodingTy
+  constexpr bool isVerbatimString(std::string_view theString) const {
+    while (!theString.empty()) {
+      theString.remove_prefix(countPlainStringBytes(theString));
+      if (theString.empty())
+        break;
+      if (decodeFirst(theString).first == '\\')
+        return false;
+      const intptr_t aCharWidth = parseFirstStringChar(theString).second;
+      if (aCharWidth <= 0)
+        return false;
+      theString.remove_prefix(aCharWidth);
+    }
+    return true;
+  }
+
+  /// @return true if the unquoted string literal theString is valid, i.e.
+  /// contains only valid characters and escape sequences
+  constexpr bool isValidString(std::string_view theString) const {
+    while (!theString.empty()) {
+      theString.remove_prefix(countPlainStringBytes(theString));
+      if (theString.empty())
+        break;
+      const intptr_t aCharWidth = parseFirstStringChar(theString).second;
+      if (aCharWidth <= 0)
+        return false;
+      theString.remove_prefix(aCharWidth);
+    }
+    return true;
+  }
+
   static constexpr bool isWhiteSpace(const CharT theChar) noexcept {
     return theChar == 0x20 || theChar == 0xd || theChar == 0xa ||
            theChar == 0x9;
@@ -228,6 +333,13 @@ public:
     std::string_view aRemaining = theString;
     size_t aNumChars = 0;
     while (!aRemaining.empty()) {
+      if constexpr (impl::IsAsciiCompatible<DestEncodingTy>::value) {
+        const size_t aNumPlain = countPlainStringBytes(aRemaining);
+        aNumChars += aNumPlain;
+        aRemaining.remove_prefix(aNumPlain);
+        if (aRemaining.empty())
+          break;
+      }
       const auto [aChar, aCharWidth] = decodeFirst(aRemaining);
       if (aChar == '\\') {
         const auto [aCodepoint, aWidth] = parseEscape(aRemaining);
@@ -396,58 +508,93 @@ public:
     return std::make_pair(aExpectedVal, theString.size() - aRemaining.size());
   }
 
+  /// Parses a json number to the nearest double, like strtod does.
+  /// Multiple leading '0' are not allowed, so "0123" parses as 0.
+  /// @return the parsed number and the number of bytes consumed while parsing
   constexpr std::pair<double, intptr_t>
   parseNumber(const std::string_view theString) const {
     constexpr const std::pair<double, intptr_t> aErrorResult =
         std::make_pair(0., -1);
-    // Step 1: Read int
-    const auto [aInt, aIntLength] = parseInteger(theString);
-    if (aIntLength <= 0)
+    std::string_view aRemaining = theString;
+    // Step 1: Read sign
+    const bool aNegative = decodeFirstAscii(aRemaining).first == '-';
+    if (aNegative)
+      aRemaining.remove_prefix(decodeFirstAscii(aRemaining).second);
+    // Step 2: Read int
+    const auto [aFirstDigit, aFirstDigitWidth] = decodeFirstAscii(aRemaining);
+    if (!isdigit(aFirstDigit))
       // the integer part is at least one character wide
       return aErrorResult;
-    std::string_view aRemaining = theString.substr(aIntLength);
-    // Step 2: Read fraction
-    std::string_view aFractionStr = readFraction(aRemaining);
-    double aFrac = 0.;
-    if (!aFractionStr.empty()) {
-      aRemaining.remove_prefix(aFractionStr.size());
-      // Drop leading '.'
-      aFractionStr.remove_prefix(decodeFirst(aFractionStr).second);
-      // FIXME not a precise way to parse digits
-      double aDenom = 10.;
-      for (;;) {
-        const auto [aChar, aCharWidth] = decodeFirst(aFractionStr);
-        // Unneeded safety check
-        if (aCharWidth <= 0)
-          // Failed to decode a digit
-          return aErrorResult;
-        aFrac += (aChar - '0') / aDenom;
-        aDenom *= 10.;
-        if (aCharWidth > aFractionStr.size())
-          // how did we run out of characters?
-          return aErrorResult;
-        aFractionStr.remove_prefix(aCharWidth);
-        if (aFractionStr.empty())
-          break;
-      }
+    uint64_t aMantissa = 0;
+    std::string_view aIntDigits = aRemaining.substr(0, aFirstDigitWidth);
+    intptr_t aNumDigits = 1;
+    if (aFirstDigit == '0') {
+      aRemaining.remove_prefix(aFirstDigitWidth);
+    } else {
+      const std::string_view aDigits = aRemaining;
+      aNumDigits = accumulateDigits(aRemaining, aMantissa);
+      aIntDigits = aDigits.substr(0, aDigits.size() - aRemaining.size());
+    }
+    // Step 3: Read fraction
+    std::string_view aFracDigits;
+    int64_t aPower10 = 0;
+    if (const auto [aDot, aDotWidth] = decodeFirstAscii(aRemaining);
+        aDot == '.' &&
+        isdigit(decodeFirstAscii(aRemaining.substr(aDotWidth)).first)) {
+      aRemaining.remove_prefix(aDotWidth);
+      aFracDigits = aRemaining;
+      const intptr_t aNumFracDigits = accumulateDigits(aRemaining, aMantissa);
+      aFracDigits = aFracDigits.substr(0, aFracDigits.size() -
+                                              aRemaining.size());
+      aNumDigits += aNumFracDigits;
+      aPower10 = -aNumFracDigits;
     }
-    // Step 3: Read exponent
+    // Step 4: Read exponent
     const auto [aExp, aExpLength] = parseExponent(aRemaining);
     if (aExpLength < 0)
       return aErrorResult;
     aRemaining.remove_prefix(aExpLength);
-    // Step 4: Combine int, frac and exp
-    double aResult = aInt + (aInt >= 0 ? aFrac : -aFrac);
-    if (aExp == 0) {
-      aResult = 1.;
-    } else if (aExp > 0) {
-      for (int i = 1; i < aExp; ++i)
-        aResult *= 10.;
-    } else {
-      aResult = 1. / aResult;
-      for (int i = 0; i < -aExp; ++i)
-        aResult /= 10.;
+    const int64_t aExplicitPower10 = aExpLength > 0 ? aExp : 0;
+    aPower10 += aExplicitPower10;
+    // Step 5: Re-read long significands, this time only keeping the first
+    // significant digits
+    bool aTruncated = false;
+    if (aNumDigits > impl::MAX_MANTISSA_DIGITS) {
+      aMantissa = 0;
+      aPower10 = aExplicitPower10;
+      int aNumSignificant = 0;
+      forEachDigit(aIntDigits, [&](const uint8_t theDigit) {
+        if (aNumSignificant < impl::MAX_MANTISSA_DIGITS) {
+          aMantissa = aMantissa * 10 + theDigit;
+          aNumSignificant += aMantissa != 0;
+        } else {
+          aTruncated |= theDigit != 0;
+          ++aPower10;
+        }
+      });
+      forEachDigit(aFracDigits, [&](const uint8_t theDigit) {
+        if (aNumSignificant < impl::MAX_MANTISSA_DIGITS) {
+          aMantissa = aMantissa * 10 + theDigit;
+          aNumSignificant += aMantissa != 0;
+          --aPower10;
+        } else {
+          aTruncated |= theDigit != 0;
+        }
+      });
     }
+    // Step 6: Combine significand and exponent
+    const double aResult = impl::computeDouble(
+        aNegative, aMantissa, aPower10, aTruncated,
+        [&](impl::DecimalNumber &theDecimal) {
+          forEachDigit(aIntDigits, [&](const uint8_t theDigit) {
+            theDecimal.pushDigit(theDigit);
+          });
+          theDecimal.markDecimalPoint();
+          forEachDigit(aFracDigits, [&](const uint8_t theDigit) {
+            theDecimal.pushDigit(theDigit);
+          });
+          theDecimal.addExponent(aExplicitPower10);
+        });
     return std::make_pair(aResult, theString.size() - aRemaining.size());
   }
 
@@ -458,6 +605,7 @@ public:
     if (theString.empty())
       return std::make_pair(1, 0);
     constexpr const auto aErrorResult = std::make_pair(0, -1);
+    constexpr int MAX_EXPONENT = 100000000;
 
     // Step 1: Check for expected 'e'/'E'
     const auto [aChar, aCharWidth] = decodeFirst(theString);
@@ -491,8 +639,9 @@ public:
       if (aCharWidth <= 0)
         // Failed to decode a digit
         return aErrorResult;
-      aExp *= 10;
-      aExp += (aChar - '0');
+      // Saturate: anything this large is zero or infinity anyway
+      if (aExp < MAX_EXPONENT)
+        aExp = aExp * 10 + static_cast<int>(aChar - '0');
       if (aCharWidth > aExponentStr.size())
         // how did we run out of characters?
         return aErrorResult;
@@ -541,7 +690,7 @@ public:
     std::string_view aDigits = readDigits(aRemaining);
     if (aDigits.empty())
       return aErrorResult;
-    int aParsedInt = 0;
+    double aParsedInt = 0;
     size_t aParsedChars = theString.size() - aRemaining.size();
     for (;;) {
       const auto [aChar, aCharWidth] = decodeFirst(aDigits);
@@ -552,7 +701,7 @@ public:
         // We ran out of remaining characters(?!)
         return aErrorResult;
       aDigits.remove_prefix(aCharWidth);
-      int aDigit = aChar - '0';
+      const auto aDigit = static_cast<int>(aChar - '0');
       aParsedInt *= 10;
       aParsedInt += aDigit;
       aParsedChars += aCharWidth;
@@ -583,15 +732,9 @@ public:
     std::string_view aDigits(theString.data(), 0);
     std::string_view aRemaining = theString;
     for (;;) {
-      const auto [aChar, aCharWidth] = decodeFirst(aRemaining);
-      if (aCharWidth <= 0)
-        // Failed to decode a character. But we don't do error handling here
-        return aDigits;
+      const auto [aChar, aCharWidth] = decodeFirstAscii(aRemaining);
       if (!isdigit(aChar))
-        // Found a non-digit character
-        return aDigits;
-      if (aCharWidth > aRemaining.size())
-        // We ran out of remaining characters(?!)
+        // Found a non-digit character (or failed to decode one)
         return aDigits;
       aRemaining.remove_prefix(aCharWidth);
       aDigits = {theString.data(), aDigits.size() + aCharWidth};
@@ -668,7 +811,8 @@ public:
       // it is illegal to have multiple digitis starting with '0'
       const auto [aFirstChar, aFirstLen] = decodeFirst(aDigits);
       if (aDigits.size() != 1 && aFirstChar == '0')
-        return aDigits.substr(0, aFirstLen);
+        return theString.substr(0, theString.size() - aRemaining.size() +
+                                       aFirstLen);
       aRemaining.remove_prefix(aDigits.size());
     }
     // read fraction
@@ -690,6 +834,7 @@ public:
       return aErrorResult;
     std::string_view aRemaining = theString.substr(aFirstCharWidth);
     for (;;) {
+      aRemaining.remove_prefix(countPlainStringBytes(aRemaining));
       const auto [aChar, aCharWidth] = decodeFirst(aRemaining);
       if (aCharWidth <= 0)
         // Failed to decode first char
@@ -0,0 +1,341 @@
+#ifndef CONSTEXPR_JSON_PROJECTION_H
+#define CONSTEXPR_JSON_PROJECTION_H
+
+#include "constexpr_json/impl/nesting_stack.h"
+#include "constexpr_json/impl/parsing_utils.h"
+#include "constexpr_json/impl/structural_index.h"
+
+#include <charconv>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace cjson {
+/// Set of values of a document, which DocumentParser3 can restrict parsing
+/// to (see DynamicDocument::parseJsonProjection)
+///
+/// Values are selected by JSON Pointers (RFC 6901) and include everything
+/// nested in them. As an extension, the reference token "*" matches every
+/// property and array element, e.g. "/items/*/id" selects the id of every
+/// item. The pointers are kept in a trie with one node per reference token,
+/// so that looking up the children of a value only depends on the number of
+/// pointers which go through it.
+class Projection {
+public:
+  /// Node index which stands for "not selected"
+  static constexpr size_t NONE = static_cast<size_t>(-1);
+  /// Node of the root value
+  static constexpr size_t ROOT = 0;
+
+  /// Selects nothing except for a scalar root
+  Projection() = default;
+  /// Selects the values at all of thePointers. Invalid pointers are ignored,
+  /// use add() to detect them.
+  Projection(const std::initializer_list<std::string_view> thePointers) {
+    for (const std::string_view aPointer : thePointers)
+      add(aPointer);
+  }
+
+  /// Selects the value at thePointer, which has to be in the encoding of the
+  /// parsed documents
+  /// @return false if thePointer is not a valid JSON Pointer
+  bool add(const std::string_view thePointer) {
+    std::vector<std::string> aTokens;
+    if (!splitPointer(thePointer, aTokens))
+      return false;
+    addTokens(ROOT, aTokens, 0);
+    return true;
+  }
+
+  /// @return whether theNode selects its whole value
+  bool selectsAll(const size_t theNode) const noexcept {
+    return itsNodes[theNode].itsIsSelected;
+  }
+  /// @return the node of the property or array element of theNode's value
+  /// which theToken names, or NONE if it is not selected
+  size_t findChild(const size_t theNode,
+                   const std::string_view theToken) const noexcept {
+    const Node &aNode = itsNodes[theNode];
+    for (const auto &[aToken, aChild] : aNode.itsChildren)
+      if (aToken == theToken)
+        return aChild;
+    return aNode.itsWildcard;
+  }
+  /// @return whether findChild only ever returns the "*" child of theNode
+  bool hasOnlyWildcard(const size_t theNode) const noexcept {
+    return itsNodes[theNode].itsChildren.empty();
+  }
+
+private:
+  struct Node {
+    /// Whether the whole value is selected
+    bool itsIsSelected = false;
+    /// Children for specific property names and array indices. Each of them
+    /// also selects everything that itsWildcard does.
+    std::vector<std::pair<std::string, size_t>> itsChildren;
+    /// Child for "*" or NONE
+    size_t itsWildcard = NONE;
+  };
+
+  /// Splits thePointer into its unescaped reference tokens
+  static bool splitPointer(std::string_view thePointer,
+                           std::vector<std::string> &theTokens) {
+    if (thePointer.empty())
+      return true;
+    if (thePointer.front() != '/')
+      return false;
+    while (!thePointer.empty()) {
+      thePointer.remove_prefix(1);
+      const std::string_view aEscaped =
+          thePointer.substr(0, thePointer.find('/'));
+      thePointer.remove_prefix(aEscaped.size());
+      std::string &aToken = theTokens.emplace_back();
+      for (size_t aIdx = 0; aIdx < aEscaped.size(); ++aIdx) {
+        if (aEscaped[aIdx] != '~') {
+          aToken += aEscaped[aIdx];
+          continue;
+        }
+        if (++aIdx == aEscaped.size() ||
+            (aEscaped[aIdx] != '0' && aEscaped[aIdx] != '1'))
+          return false;
+        aToken += aEscaped[aIdx] == '0' ? '~' : '/';
+      }
+    }
+    return true;
+  }
+
+  size_t addNode() {
+    itsNodes.emplace_back();
+    return itsNodes.size() - 1;
+  }
+
+  /// Selects the value at theTokens[theFirst..] below theNode. Nodes are
+  /// referenced by index since adding nodes moves all of them.
+  void addTokens(const size_t theNode,
+                 const std::vector<std::string> &theTokens,
+                 const size_t theFirst) {
+    if (itsNodes[theNode].itsIsSelected)
+      return;
+    if (theFirst == theTokens.size()) {
+      // Everything below is selected anyway
+      itsNodes[theNode] = Node{true, {}, NONE};
+      return;
+    }
+    const std::string &aToken = theTokens[theFirst];
+    if (aToken == "*") {
+      if (itsNodes[theNode].itsWildcard == NONE) {
+        const size_t aWildcard = addNode();
+        itsNodes[theNode].itsWildcard = aWildcard;
+      }
+      addTokens(itsNodes[theNode].itsWildcard, theTokens, theFirst + 1);
+      const size_t aNumChildren = itsNodes[theNode].itsChildren.size();
+      for (size_t aIdx = 0; aIdx < aNumChildren; ++aIdx)
+        addTokens(itsNodes[theNode].itsChildren[aIdx].second, theTokens,
+                  theFirst + 1);
+      return;
+    }
+    size_t aChild = NONE;
+    for (const auto &[aChildToken, aChildNode] :
+         itsNodes[theNode].itsChildren)
+      if (aChildToken == aToken)
+        aChild = aChildNode;
+    if (aChild == NONE) {
+      aChild = addNode();
+      itsNodes[theNode].itsChildren.emplace_back(aToken, aChild);
+      // The new child has to select what "*" already does
+      if (itsNodes[theNode].itsWildcard != NONE) {
+        std::vector<std::vector<std::string>> aPaths;
+        std::vector<std::string> aPrefix;
+        collectPaths(itsNodes[theNode].itsWildcard, aPrefix, aPaths);
+        for (const auto &aPath : aPaths)
+          addTokens(aChild, aPath, 0);
+      }
+    }
+    addTokens(aChild, theTokens, theFirst + 1);
+  }
+
+  /// Appends the tokens of all selected values below theNode to thePaths
+  void collectPaths(const size_t theNode, std::vector<std::string> &thePrefix,
+                    std::vector<std::vector<std::string>> &thePaths) const {
+    const Node &aNode = itsNodes[theNode];
+    if (aNode.itsIsSelected) {
+      thePaths.push_back(thePrefix);
+      return;
+    }
+    if (aNode.itsWildcard != NONE) {
+      thePrefix.emplace_back("*");
+      collectPaths(aNode.itsWildcard, thePrefix, thePaths);
+      thePrefix.pop_back();
+    }
+    for (const auto &[aToken, aChild] : aNode.itsChildren) {
+      thePrefix.push_back(aToken);
+      collectPaths(aChild, thePrefix, thePaths);
+      thePrefix.pop_back();
+    }
+  }
+
+  std::vector<Node> itsNodes = std::vector<Node>(1);
+};
+
+namespace impl {
+/// Skips the value at theToken in the StructuralIndex of theJson. Only the
+/// nesting of brackets is checked, scalars and strings are not looked at.
+/// @return the offset behind the value or -1 if it is malformed
+inline intptr_t skipStructuralValue(const std::string_view theJson,
+                                    const uint32_t *&theToken,
+                                    const uint32_t *const theEnd) {
+  DynamicNestingStack aStack;
+  do {
+    if (theToken == theEnd)
+      return -1;
+    const uint32_t aPos = *theToken++;
+    switch (theJson[aPos]) {
+    case '[':
+    case '{':
+      aStack.push(theJson[aPos] == '{');
+      break;
+    case ']':
+    case '}':
+      if (aStack.empty() || aStack.top() != (theJson[aPos] == '}'))
+        return -1;
+      aStack.pop();
+      if (aStack.empty())
+        return aPos + 1;
+      break;
+    case '"':
+      // The index always contains the closing quote as well
+      if (aStack.empty())
+        return *theToken++ + 1;
+      ++theToken;
+      break;
+    case ',':
+    case ':':
+      if (aStack.empty())
+        return -1;
+      break;
+    default:
+      if (aStack.empty()) {
+        // Scalars end at the next whitespace or token
+        size_t aEnd = aPos + 1;
+        while (aEnd < theJson.size() &&
+               (theToken == theEnd || aEnd < *theToken) &&
+               theJson[aEnd] != ' ' && theJson[aEnd] != '\n' &&
+               theJson[aEnd] != '\r' && theJson[aEnd] != '\t')
+          ++aEnd;
+        return aEnd;
+      }
+      break;
+    }
+  } while (!aStack.empty());
+  return -1;
+}
+
+/// Variant of walkStructuralIndex which only calls back into theVisitor for
+/// the values that theProjection selects below theNode. Unselected object
+/// properties are left out, while unselected array elements are reported as
+/// null so that the indices of the others stay the same. Unselected values
+/// are skipped by bracket matching only, so they are not validated.
+///
+/// Reference tokens are compared against decoded keys, which are decoded with
+/// theSrcEnc.
+/// @return the offset behind the value or -1 if it is malformed.
+template <typename SourceEncodingTy, typename VisitorTy>
+intptr_t walkProjection(const std::string_view theJson,
+                        const uint32_t *&theToken, const uint32_t *const theEnd,
+                        const Projection &theProjection, const size_t theNode,
+                        VisitorTy &theVisitor,
+                        const SourceEncodingTy &theSrcEnc) {
+  const uint32_t *&aToken = theToken;
+  const uint32_t *const aEnd = theEnd;
+  if (aToken == aEnd)
+    return -1;
+  const char aOpen = theJson[*aToken];
+  if (theProjection.selectsAll(theNode) || (aOpen != '[' && aOpen != '{'))
+    return walkStructuralIndex(theJson, aToken, aEnd, theVisitor);
+  const bool aIsObject = aOpen == '{';
+  if (!theVisitor.onOpen(*aToken, aIsObject))
+    return -1;
+  ++aToken;
+  if (aToken != aEnd && theJson[*aToken] == (aIsObject ? '}' : ']')) {
+    if (!theVisitor.onClose(aIsObject))
+      return -1;
+    return *aToken++ + 1;
+  }
+  const parsing<SourceEncodingTy> p{theSrcEnc};
+  std::string aDecodedKey;
+  for (size_t aIdx = 0;; ++aIdx) {
+    // Look up which node the next value belongs to
+    size_t aChild = Projection::NONE;
+    std::string_view aQuotedKey;
+    intptr_t aKeyPos = 0;
+    if (aIsObject) {
+      if (aEnd - aToken < 3 || theJson[aToken[0]] != '"' ||
+          theJson[aToken[2]] != ':')
+        return -1;
+      aKeyPos = aToken[0];
+      aQuotedKey = theJson.substr(aKeyPos, aToken[1] - aKeyPos + 1);
+      aToken += 3;
+      std::string_view aKey = p.stripQuotes(aQuotedKey);
+      if (!theProjection.hasOnlyWildcard(theNode) &&
+          aKey.find('\\') != std::string_view::npos) {
+        aDecodedKey.clear();
+        while (!aKey.empty()) {
+          const auto [aChar, aCharWidth] = p.parseFirstStringChar(aKey);
+          if (aCharWidth <= 0)
+            return -1;
+          const auto [aBytes, aBytesUsed] = theSrcEnc.encode(aChar);
+          if (aBytesUsed <= 0)
+            return -1;
+          aDecodedKey.append(aBytes.begin(), aBytes.begin() + aBytesUsed);
+          aKey.remove_prefix(aCharWidth);
+        }
+        aKey = aDecodedKey;
+      }
+      aChild = theProjection.findChild(theNode, aKey);
+    } else if (theProjection.hasOnlyWildcard(theNode)) {
+      aChild = theProjection.findChild(theNode, {});
+    } else {
+      char aDigits[24];
+      const auto aDigitsEnd =
+          std::to_chars(aDigits, aDigits + sizeof(aDigits), aIdx).ptr;
+      aChild = theProjection.findChild(
+          theNode, std::string_view{aDigits, static_cast<size_t>(
+                                                 aDigitsEnd - aDigits)});
+    }
+
+    if (aToken == aEnd)
+      return -1;
+    const char aFirst = theJson[*aToken];
+    if (aChild != Projection::NONE &&
+        (theProjection.selectsAll(aChild) || aFirst == '[' || aFirst == '{')) {
+      if (aIsObject && !theVisitor.onKey(aKeyPos, aQuotedKey))
+        return -1;
+      if (walkProjection(theJson, aToken, aEnd, theProjection, aChild,
+                         theVisitor, theSrcEnc) < 0)
+        return -1;
+    } else {
+      const uint32_t aPos = *aToken;
+      if (skipStructuralValue(theJson, aToken, aEnd) < 0)
+        return -1;
+      if (!aIsObject && theVisitor.onScalar(aPos, "null") <= 0)
+        return -1;
+    }
+
+    if (aToken == aEnd)
+      return -1;
+    const char aNext = theJson[*aToken];
+    if (aNext == ',') {
+      ++aToken;
+      continue;
+    }
+    if (aNext != (aIsObject ? '}' : ']') || !theVisitor.onClose(aIsObject))
+      return -1;
+    return *aToken++ + 1;
+  }
+}
+} // namespace impl
+} // namespace cjson
+#endif // CONSTEXPR_JSON_PROJECTION_H
@@ -0,0 +1,515 @@
+#ifndef CONSTEXPR_JSON_STRUCTURAL_INDEX_H
+#define CONSTEXPR_JSON_STRUCTURAL_INDEX_H
+
+#include "constexpr_json/impl/ascii_scanning.h"
+#include "constexpr_json/impl/compiler_support.h"
+#include "constexpr_json/impl/nesting_stack.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace cjson {
+namespace impl {
+/// Runs theFn(0) ... theFn(theNumTasks - 1) on up to theNumThreads threads,
+/// including the calling one
+template <typename FnTy>
+void parallelFor(const size_t theNumTasks, const unsigned theNumThreads,
+                 FnTy &&theFn) {
+  const size_t aNumThreads =
+      std::max<size_t>(1, std::min<size_t>(theNumTasks, theNumThreads));
+  const auto runTasks = [&](const size_t theThread) {
+    for (size_t aTask = theThread; aTask < theNumTasks; aTask += aNumThreads)
+      theFn(aTask);
+  };
+  std::vector<std::thread> aThreads;
+  aThreads.reserve(aNumThreads - 1);
+  for (size_t aThread = 1; aThread < aNumThreads; ++aThread)
+    aThreads.emplace_back(runTasks, aThread);
+  runTasks(0);
+  for (std::thread &aThread : aThreads)
+    aThread.join();
+}
+
+/// Runtime-only first stage of parsing: Finds the positions of all tokens of a
+/// JSON document without decoding it character by character.
+///
+/// The input is processed in blocks of 64 bytes. For every block we compute
+/// bitmasks of quotes, backslashes, operators ({}[]:,) and whitespace (using
+/// SSE2/AVX2 where available), derive which characters are escaped and which
+/// are inside of strings and finally extract the positions of
+///  * operators outside of strings,
+///  * the opening and closing quote of every string and
+///  * the first byte of every other run of non-whitespace characters outside
+///    of strings (i.e. the start of null/true/false/numbers - or garbage).
+///
+/// This is the same approach as stage 1 of simdjson.
+struct StructuralIndex {
+  /// @return false if theJson ends inside of a string or is too large to be
+  /// indexed with 32 bit positions.
+  bool build(const std::string_view theJson) {
+    itsSize = 0;
+    if (theJson.size() >= std::numeric_limits<uint32_t>::max())
+      return false;
+    BlockState aState;
+    indexRange(theJson, 0, theJson.size(), aState);
+    return !aState.itsPrevInString;
+  }
+
+  /// Same as build, but splits theJson into chunks which are indexed by up
+  /// to theNumThreads threads. The state at the start of each chunk (escaped
+  /// character, inside of a string, continued scalar) is resolved up front:
+  /// Escapes only depend on the backslashes in front of the chunk and
+  /// whether a chunk starts inside of a string follows from the number of
+  /// unescaped quotes in all chunks before it.
+  bool buildParallel(const std::string_view theJson,
+                     const unsigned theNumThreads) {
+    constexpr size_t MIN_CHUNK_SIZE = 1 << 16;
+    const size_t aNumChunks = std::min<size_t>(
+        theNumThreads, (theJson.size() + MIN_CHUNK_SIZE - 1) / MIN_CHUNK_SIZE);
+    if (aNumChunks <= 1)
+      return build(theJson);
+    itsSize = 0;
+    if (theJson.size() >= std::numeric_limits<uint32_t>::max())
+      return false;
+    const size_t aChunkSize =
+        ((theJson.size() + aNumChunks - 1) / aNumChunks + BLOCK_SIZE - 1) /
+        BLOCK_SIZE * BLOCK_SIZE;
+    const auto chunkBegin = [&](const size_t theChunk) {
+      return std::min(theChunk * aChunkSize, theJson.size());
+    };
+    std::vector<BlockState> aStates(aNumChunks);
+    std::vector<uint8_t> aQuoteParities(aNumChunks);
+    parallelFor(aNumChunks, theNumThreads, [&](const size_t theChunk) {
+      const size_t aBegin = chunkBegin(theChunk);
+      size_t aNumBackslashes = 0;
+      while (aNumBackslashes < aBegin &&
+             theJson[aBegin - aNumBackslashes - 1] == '\\')
+        ++aNumBackslashes;
+      aStates[theChunk].itsPrevEscaped = aNumBackslashes % 2;
+      aQuoteParities[theChunk] = countQuoteParity(
+          theJson, aBegin, chunkBegin(theChunk + 1),
+          aStates[theChunk].itsPrevEscaped);
+    });
+    for (size_t aChunk = 1; aChunk < aNumChunks; ++aChunk) {
+      const bool aInString = (aStates[aChunk - 1].itsPrevInString != 0) !=
+                             (aQuoteParities[aChunk - 1] != 0);
+      aStates[aChunk].itsPrevInString = aInString ? ~uint64_t{0} : 0;
+      const BlockMasks aPrev = classifyBlock(
+          paddedBlock(theJson, chunkBegin(aChunk) - BLOCK_SIZE).data());
+      aStates[aChunk].itsPrevScalar =
+          !aInString &&
+          !((aPrev.itsOperators | aPrev.itsWhitespace | aPrev.itsQuotes) >>
+            63);
+    }
+    std::vector<StructuralIndex> aIndices(aNumChunks);
+    parallelFor(aNumChunks, theNumThreads, [&](const size_t theChunk) {
+      aIndices[theChunk].indexRange(theJson, chunkBegin(theChunk),
+                                    chunkBegin(theChunk + 1),
+                                    aStates[theChunk]);
+    });
+    if (aStates.back().itsPrevInString)
+      return false;
+    size_t aTotalSize = 0;
+    for (const StructuralIndex &aIndex : aIndices)
+      aTotalSize += aIndex.size();
+    // Keep the slack required by appendPositions
+    itsCapacity = aTotalSize + 64;
+    itsPositions.reset(new uint32_t[itsCapacity]);
+    for (const StructuralIndex &aIndex : aIndices) {
+      std::copy(aIndex.begin(), aIndex.end(), itsPositions.get() + itsSize);
+      itsSize += aIndex.size();
+    }
+    return true;
+  }
+
+  const uint32_t *begin() const { return itsPositions.get(); }
+  const uint32_t *end() const { return itsPositions.get() + itsSize; }
+  size_t size() const { return itsSize; }
+  uint32_t operator[](const size_t theIdx) const {
+    return itsPositions[theIdx];
+  }
+
+private:
+  static constexpr size_t BLOCK_SIZE = 64;
+
+  /// Not a std::vector because we do not want to zero-initialize the buffer
+  /// on every resize and need some slack for appendPositions
+  std::unique_ptr<uint32_t[]> itsPositions;
+  size_t itsSize = 0;
+  size_t itsCapacity = 0;
+
+  /// What a block needs to know about the blocks before it
+  struct BlockState {
+    /// whether the first character is escaped
+    uint64_t itsPrevEscaped = 0;
+    /// all bits set if the block starts inside of a string
+    uint64_t itsPrevInString = 0;
+    /// whether the block starts in the middle of a scalar
+    uint64_t itsPrevScalar = 0;
+  };
+
+  /// @return theJson[theOffset, theOffset + BLOCK_SIZE), padded with
+  /// whitespace, which never produces tokens
+  static std::array<char, BLOCK_SIZE>
+  paddedBlock(const std::string_view theJson, const size_t theOffset) {
+    std::array<char, BLOCK_SIZE> aBlock;
+    aBlock.fill(' ');
+    std::memcpy(aBlock.data(), theJson.data() + theOffset,
+                std::min(BLOCK_SIZE, theJson.size() - theOffset));
+    return aBlock;
+  }
+
+  /// Calls theFn for every block of theJson[theBegin, theEnd). theBegin must
+  /// be a multiple of BLOCK_SIZE.
+  template <typename FnTy>
+  static void forEachBlock(const std::string_view theJson, size_t theBegin,
+                           const size_t theEnd, FnTy &&theFn) {
+    for (; theBegin + BLOCK_SIZE <= theEnd; theBegin += BLOCK_SIZE)
+      theFn(theJson.data() + theBegin, theBegin);
+    if (theBegin < theEnd)
+      theFn(paddedBlock(theJson.substr(0, theEnd), theBegin).data(), theBegin);
+  }
+
+  /// Appends the positions of the tokens in theJson[theBegin, theEnd)
+  void indexRange(const std::string_view theJson, const size_t theBegin,
+                  const size_t theEnd, BlockState &theState) {
+    forEachBlock(theJson, theBegin, theEnd,
+                 [&](const char *theBlock, const size_t theOffset) {
+                   const BlockMasks aMasks = classifyBlock(theBlock);
+                   const uint64_t aEscaped = findEscaped(
+                       aMasks.itsBackslashes, theState.itsPrevEscaped);
+                   const uint64_t aQuotes = aMasks.itsQuotes & ~aEscaped;
+                   // Bits are set from an opening quote up to (excluding) the
+                   // closing one
+                   const uint64_t aInString =
+                       prefixXor(aQuotes) ^ theState.itsPrevInString;
+                   theState.itsPrevInString = static_cast<uint64_t>(
+                       static_cast<int64_t>(aInString) >> 63);
+                   const uint64_t aOperators =
+                       aMasks.itsOperators & ~aInString;
+                   const uint64_t aScalars =
+                       ~(aMasks.itsOperators | aMasks.itsWhitespace |
+                         aMasks.itsQuotes) &
+                       ~aInString;
+                   const uint64_t aScalarStarts =
+                       aScalars & ~((aScalars << 1) | theState.itsPrevScalar);
+                   theState.itsPrevScalar = aScalars >> 63;
+                   appendPositions(aOperators | aQuotes | aScalarStarts,
+                                   static_cast<uint32_t>(theOffset));
+                 });
+  }
+
+  /// @return whether theJson[theBegin, theEnd) contains an odd number of
+  /// unescaped quotes
+  static bool countQuoteParity(const std::string_view theJson,
+                               const size_t theBegin, const size_t theEnd,
+                               uint64_t theEscapeCarry) {
+    uint64_t aParity = 0;
+    forEachBlock(theJson, theBegin, theEnd,
+                 [&](const char *theBlock, size_t) {
+                   const BlockMasks aMasks = classifyBlock(theBlock);
+                   aParity ^= popCount(aMasks.itsQuotes &
+                                       ~findEscaped(aMasks.itsBackslashes,
+                                                    theEscapeCarry));
+                 });
+    return aParity & 1;
+  }
+
+  /// Appends the positions of all bits set in theTokens
+  void appendPositions(uint64_t theTokens, const uint32_t theOffset) {
+    // Each block may add up to 64 positions
+    if (itsCapacity - itsSize < 64) {
+      const size_t aNewCapacity = std::max<size_t>(2 * itsCapacity, 1024);
+      std::unique_ptr<uint32_t[]> aNewPositions{new uint32_t[aNewCapacity]};
+      std::copy(begin(), end(), aNewPositions.get());
+      itsPositions = std::move(aNewPositions);
+      itsCapacity = aNewCapacity;
+    }
+    // Writing the first eight positions unconditionally avoids mispredicted
+    // branches for the typical block. Superfluous positions are overwritten
+    // later on. Setting the highest bit keeps countTrailingZeros defined.
+    constexpr uint64_t HIGHEST_BIT = uint64_t{1} << 63;
+    const int aCount = popCount(theTokens);
+    uint32_t *const aOut = itsPositions.get() + itsSize;
+    for (int aIdx = 0; aIdx < 8; ++aIdx) {
+      aOut[aIdx] = theOffset + countTrailingZeros(theTokens | HIGHEST_BIT);
+      theTokens &= theTokens - 1;
+    }
+    for (int aIdx = 8; aIdx < aCount; ++aIdx) {
+      aOut[aIdx] = theOffset + countTrailingZeros(theTokens);
+      theTokens &= theTokens - 1;
+    }
+    itsSize += aCount;
+  }
+
+  /// Character classes of a block of 64 bytes, one bit per byte
+  struct BlockMasks {
+    uint64_t itsQuotes;
+    uint64_t itsBackslashes;
+    uint64_t itsOperators;
+    uint64_t itsWhitespace;
+  };
+
+#if defined(CJSON_AVX2)
+  static BlockMasks classifyBlock(const char *theBlock) {
+    BlockMasks aMasks{0, 0, 0, 0};
+    const auto eq = [](__m256i theChars, char theChar) {
+      return _mm256_cmpeq_epi8(theChars, _mm256_set1_epi8(theChar));
+    };
+    const auto toBits = [](__m256i theMask) {
+      return static_cast<uint64_t>(
+          static_cast<uint32_t>(_mm256_movemask_epi8(theMask)));
+    };
+    for (int aHalf = 0; aHalf < 2; ++aHalf) {
+      const __m256i aChars = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(theBlock + 32 * aHalf));
+      // '[' and ']' only differ from '{' and '}' in bit 0x20
+      const __m256i aLowered = _mm256_or_si256(aChars, _mm256_set1_epi8(0x20));
+      const __m256i aOps = _mm256_or_si256(
+          _mm256_or_si256(eq(aLowered, '{'), eq(aLowered, '}')),
+          _mm256_or_si256(eq(aChars, ':'), eq(aChars, ',')));
+      const __m256i aWS = _mm256_or_si256(
+          _mm256_or_si256(eq(aChars, ' '), eq(aChars, '\t')),
+          _mm256_or_si256(eq(aChars, '\n'), eq(aChars, '\r')));
+      const int aShift = 32 * aHalf;
+      aMasks.itsQuotes |= toBits(eq(aChars, '"')) << aShift;
+      aMasks.itsBackslashes |= toBits(eq(aChars, '\\')) << aShift;
+      aMasks.itsOperators |= toBits(aOps) << aShift;
+      aMasks.itsWhitespace |= toBits(aWS) << aShift;
+    }
+    return aMasks;
+  }
+#elif defined(CJSON_SSE2)
+  static BlockMasks classifyBlock(const char *theBlock) {
+    BlockMasks aMasks{0, 0, 0, 0};
+    const auto eq = [](__m128i theChars, char theChar) {
+      return _mm_cmpeq_epi8(theChars, _mm_set1_epi8(theChar));
+    };
+    const auto toBits = [](__m128i theMask) {
+      return static_cast<uint64_t>(
+          static_cast<uint16_t>(_mm_movemask_epi8(theMask)));
+    };
+    for (int aQuarter = 0; aQuarter < 4; ++aQuarter) {
+      const __m128i aChars = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(theBlock + 16 * aQuarter));
+      // '[' and ']' only differ from '{' and '}' in bit 0x20
+      const __m128i aLowered = _mm_or_si128(aChars, _mm_set1_epi8(0x20));
+      const __m128i aOps =
+          _mm_or_si128(_mm_or_si128(eq(aLowered, '{'), eq(aLowered, '}')),
+                       _mm_or_si128(eq(aChars, ':'), eq(aChars, ',')));
+      const __m128i aWS =
+          _mm_or_si128(_mm_or_si128(eq(aChars, ' '), eq(aChars, '\t')),
+                       _mm_or_si128(eq(aChars, '\n'), eq(aChars, '\r')));
+      const int aShift = 16 * aQuarter;
+      aMasks.itsQuotes |= toBits(eq(aChars, '"')) << aShift;
+      aMasks.itsBackslashes |= toBits(eq(aChars, '\\')) << aShift;
+      aMasks.itsOperators |= toBits(aOps) << aShift;
+      aMasks.itsWhitespace |= toBits(aWS) << aShift;
+    }
+    return aMasks;
+  }
+#else
+  enum CharClass : uint8_t {
+    OTHER = 0,
+    QUOTE = 1,
+    BACKSLASH = 2,
+    OPERATOR = 4,
+    WHITESPACE = 8
+  };
+  static constexpr std::array<uint8_t, 256> makeCharClassTable() {
+    std::array<uint8_t, 256> aTable{};
+    aTable['"'] = QUOTE;
+    aTable['\\'] = BACKSLASH;
+    for (const unsigned char aOp : {'{', '}', '[', ']', ':', ','})
+      aTable[aOp] = OPERATOR;
+    for (const unsigned char aWS : {' ', '\t', '\n', '\r'})
+      aTable[aWS] = WHITESPACE;
+    return aTable;
+  }
+  static BlockMasks classifyBlock(const char *theBlock) {
+    static constexpr std::array<uint8_t, 256> CHAR_CLASSES =
+        makeCharClassTable();
+    BlockMasks aMasks{0, 0, 0, 0};
+    for (unsigned aIdx = 0; aIdx < 64; ++aIdx) {
+      const uint64_t aClass =
+          CHAR_CLASSES[static_cast<unsigned char>(theBlock[aIdx])];
+      aMasks.itsQuotes |= (aClass & 1) << aIdx;
+      aMasks.itsBackslashes |= ((aClass >> 1) & 1) << aIdx;
+      aMasks.itsOperators |= ((aClass >> 2) & 1) << aIdx;
+      aMasks.itsWhitespace |= ((aClass >> 3) & 1) << aIdx;
+    }
+    return aMasks;
+  }
+#endif
+
+  /// @return a mask of all characters preceded by an odd number of
+  /// backslashes, taking into account a run of backslashes reaching into this
+  /// block from the previous one (theCarry).
+  static uint64_t findEscaped(uint64_t theBackslashes, uint64_t &theCarry) {
+    constexpr uint64_t EVEN_BITS = 0x5555555555555555ULL;
+    // An escaped first character cannot start a new escape sequence
+    theBackslashes &= ~theCarry;
+    const uint64_t aFollowsEscape = (theBackslashes << 1) | theCarry;
+    // Adding the starts of sequences on odd bits flips the parity of the bits
+    // in those sequences, which leaves the sequences starting on even bits
+    const uint64_t aOddStarts = theBackslashes & ~EVEN_BITS & ~aFollowsEscape;
+    const uint64_t aSum = aOddStarts + theBackslashes;
+    theCarry = aSum < aOddStarts;
+    const uint64_t aInvertMask = aSum << 1;
+    return (EVEN_BITS ^ aInvertMask) & aFollowsEscape;
+  }
+
+  /// Bit i of the result is the XOR of the bits 0..i of theBits
+  static uint64_t prefixXor(uint64_t theBits) {
+#if defined(__PCLMUL__)
+    return static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_clmulepi64_si128(
+        _mm_set_epi64x(0, static_cast<int64_t>(theBits)),
+        _mm_set1_epi8(static_cast<char>(0xff)), 0)));
+#else
+    theBits ^= theBits << 1;
+    theBits ^= theBits << 2;
+    theBits ^= theBits << 4;
+    theBits ^= theBits << 8;
+    theBits ^= theBits << 16;
+    theBits ^= theBits << 32;
+    return theBits;
+#endif
+  }
+};
+
+/// Walks the first JSON value in theJson along the positions [theToken,
+/// theEnd) of its StructuralIndex and calls back into theVisitor for each
+/// element. theToken is advanced behind the value. A visitor has to provide
+///  * `intptr_t onScalar(intptr_t thePos, std::string_view theRest)`:
+///    Read the null, bool or number at the front of theRest and return its
+///    length in bytes, or a value <= 0 if it is invalid. The first byte of
+///    theRest is neither whitespace, a quote nor an operator.
+///  * `bool onString(intptr_t thePos, std::string_view theQuoted)`
+///  * `bool onKey(intptr_t thePos, std::string_view theQuoted)`
+///  * `bool onOpen(intptr_t thePos, bool theIsObject)`
+///  * `bool onClose(bool theIsObject)`
+/// where returning false aborts the walk. Strings are passed including their
+/// quotes but have not been validated otherwise.
+///
+/// Errors are not diagnosed any further - callers are expected to re-run
+/// their character-based implementation on failure if they need to report the
+/// exact reason.
+///
+/// @param theMaxDepth Maximum nesting level of values or negative for no limit
+/// @return the offset behind the value or -1 if it is malformed.
+template <typename VisitorTy>
+intptr_t walkStructuralIndex(const std::string_view theJson,
+                             const uint32_t *&theToken,
+                             const uint32_t *const theEnd,
+                             VisitorTy &theVisitor,
+                             const intptr_t theMaxDepth = -1) {
+  const uint32_t *&aToken = theToken;
+  const uint32_t *const aEnd = theEnd;
+  // theIndex guarantees that the positions are within bounds
+  const auto view = [&](const size_t thePos, const size_t theLen) {
+    return std::string_view{theJson.data() + thePos, theLen};
+  };
+  const auto isWhiteSpace = [](const char theChar) {
+    return theChar == ' ' || theChar == '\n' || theChar == '\r' ||
+           theChar == '\t';
+  };
+  // Consumes `"key" :`
+  const auto walkKey = [&]() {
+    if (aEnd - aToken < 3 || theJson[aToken[0]] != '"' ||
+        theJson[aToken[2]] != ':')
+      return false;
+    const uint32_t aPos = aToken[0];
+    if (!theVisitor.onKey(aPos, view(aPos, aToken[1] - aPos + 1)))
+      return false;
+    aToken += 3;
+    return true;
+  };
+  DynamicNestingStack aStack;
+  intptr_t aValueEnd = 0;
+  for (;;) {
+    // Step 1: Read a value
+    if (aToken == aEnd)
+      return -1;
+    if (theMaxDepth >= 0 && static_cast<intptr_t>(aStack.size()) > theMaxDepth)
+      return -1;
+    const uint32_t aPos = *aToken;
+    const char aChar = theJson[aPos];
+    if (aChar == '[' || aChar == '{') {
+      const bool aIsObject = aChar == '{';
+      if (!theVisitor.onOpen(aPos, aIsObject))
+        return -1;
+      ++aToken;
+      if (aToken == aEnd || theJson[*aToken] != (aIsObject ? '}' : ']')) {
+        aStack.push(aIsObject);
+        if (aIsObject && !walkKey())
+          return -1;
+        continue;
+      }
+      if (!theVisitor.onClose(aIsObject))
+        return -1;
+      aValueEnd = *aToken + 1;
+      ++aToken;
+    } else if (aChar == '"') {
+      // The index always contains the closing quote as well
+      const uint32_t aClose = aToken[1];
+      if (!theVisitor.onString(aPos, view(aPos, aClose - aPos + 1)))
+        return -1;
+      aValueEnd = aClose + 1;
+      aToken += 2;
+    } else {
+      const intptr_t aLen =
+          theVisitor.onScalar(aPos, view(aPos, theJson.size() - aPos));
+      if (aLen <= 0)
+        return -1;
+      aValueEnd = aPos + aLen;
+      ++aToken;
+      // Scalars must be followed by whitespace or the next token
+      if (static_cast<size_t>(aValueEnd) < theJson.size() &&
+          !isWhiteSpace(theJson[aValueEnd]) &&
+          (aToken == aEnd || *aToken != static_cast<uint32_t>(aValueEnd)))
+        return -1;
+    }
+
+    // Step 2: Close finished aggregates until another value is expected
+    for (;;) {
+      if (aStack.empty())
+        return aValueEnd;
+      if (aToken == aEnd)
+        return -1;
+      const bool aIsObject = aStack.top();
+      const char aNext = theJson[*aToken];
+      if (aNext == ',') {
+        ++aToken;
+        if (aIsObject && !walkKey())
+          return -1;
+        break;
+      }
+      if (aNext != (aIsObject ? '}' : ']') || !theVisitor.onClose(aIsObject))
+        return -1;
+      aValueEnd = *aToken + 1;
+      ++aToken;
+      aStack.pop();
+    }
+  }
+}
+
+/// Walks the first JSON value in theJson along all positions of theIndex
+template <typename VisitorTy>
+intptr_t walkStructuralIndex(const std::string_view theJson,
+                             const StructuralIndex &theIndex,
+                             VisitorTy &theVisitor,
+                             const intptr_t theMaxDepth = -1) {
+  const uint32_t *aToken = theIndex.begin();
+  return walkStructuralIndex(theJson, aToken, theIndex.end(), theVisitor,
+                             theMaxDepth);
+}
+} // namespace impl
+} // namespace cjson
+#endif // CONSTEXPR_JSON_STRUCTURAL_INDEX_H
@@ -0,0 +1,179 @@
+#ifndef CONSTEXPR_JSON_SUBTREE_COPY_H
+#define CONSTEXPR_JSON_SUBTREE_COPY_H
+
+#include "constexpr_json/impl/document_entities.h"
+#include "constexpr_json/impl/key_interning.h"
+
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace cjson {
+namespace impl {
+/// Copies values of any document into the buffers of a document with
+/// growable storage, without recursion (see BasicDynamicDocument::extract)
+///
+/// Every array and object gets the block of entities for its children as a
+/// whole when it is taken off a work list. If both documents have the same
+/// storage, the block is copied from the source in one piece and only the
+/// entities which refer to other buffers are rebased afterwards.
+template <typename DestDocTy> class SubtreeCopier {
+  static_assert(DestDocTy::Storage::IS_GROWABLE &&
+                    !DestDocTy::Storage::DECODES_LAZILY,
+                "Values can only be copied into growable documents which "
+                "decode their values up front");
+
+public:
+  explicit SubtreeCopier(DestDocTy &theDest) : itsDest{theDest} {}
+
+  /// Appends theEntity of theSrc and everything in it to the destination
+  /// @return the entity of the copy, which the caller has to place in the
+  /// destination, e.g. as its root
+  template <typename SrcDocTy>
+  Entity append(const SrcDocTy &theSrc, const Entity &theEntity) {
+    const Entity aCopy = copyShallow(theSrc, theEntity);
+    while (!itsPending.empty()) {
+      const Pending aNext = itsPending.back();
+      itsPending.pop_back();
+      const intptr_t aSrcIdx = aNext.itsSource.itsPayload;
+      const auto aPos = static_cast<intptr_t>(itsDest.itsEntities.size());
+      if (aNext.itsSource.itsKind == Entity::ARRAY) {
+        const size_t aSize = theSrc.array_size(aSrcIdx);
+        auto &aArray = itsDest.itsArrays[aNext.itsIdx];
+        aArray.itsPosition = aPos;
+        aArray.itsNumElements = aSize;
+        appendChildren(theSrc, theSrc.array_begin(aSrcIdx), aSize);
+        continue;
+      }
+      const size_t aSize = theSrc.getNumProperties(aSrcIdx);
+      auto &aObject = itsDest.itsObjects[aNext.itsIdx];
+      aObject.itsKeysPos = static_cast<intptr_t>(itsDest.itsObjectProps.size());
+      aObject.itsValuesPos = aPos;
+      aObject.itsNumProperties = aSize;
+      if (!aSize)
+        continue;
+      for (size_t aPropIdx = 0; aPropIdx < aSize; ++aPropIdx)
+        appendKey(theSrc.getProperty(aSrcIdx, aPropIdx).first);
+      appendChildren(theSrc, theSrc.getProperty(aSrcIdx, 0).second, aSize);
+    }
+    return aCopy;
+  }
+
+private:
+  /// An array or object whose children still have to be copied
+  struct Pending {
+    Entity itsSource;
+    /// index into itsArrays or itsObjects of the destination
+    intptr_t itsIdx;
+  };
+
+  /// Whether entities of SrcDocTy mean the same in the destination once the
+  /// buffers they refer to have been copied
+  template <typename SrcDocTy>
+  static constexpr bool HAS_SAME_STORAGE =
+      std::is_base_of_v<SrcDocTy, DestDocTy>;
+
+  /// Copies the theSize contiguous entities at theChildren to the end of
+  /// itsEntities
+  template <typename SrcDocTy>
+  void appendChildren(const SrcDocTy &theSrc, const Entity *const theChildren,
+                      const size_t theSize) {
+    auto &aEntities = itsDest.itsEntities;
+    const size_t aPos = aEntities.size();
+    if constexpr (HAS_SAME_STORAGE<SrcDocTy>) {
+      aEntities.insert(aEntities.end(), theChildren, theChildren + theSize);
+      for (size_t aIdx = aPos; aIdx < aPos + theSize; ++aIdx) {
+        const Entity aChild = aEntities[aIdx];
+        if (aChild.itsKind != Entity::NUL && aChild.itsKind != Entity::BOOL &&
+            aChild.itsKind != Entity::INLINE_NUMBER &&
+            aChild.itsKind != Entity::INLINE_STRING)
+          aEntities[aIdx] = copyShallow(theSrc, aChild);
+      }
+    } else {
+      aEntities.resize(aPos + theSize);
+      for (size_t aIdx = 0; aIdx < theSize; ++aIdx)
+        aEntities[aPos + aIdx] = copyShallow(theSrc, theChildren[aIdx]);
+    }
+  }
+
+  /// Copies scalars completely, while arrays and objects are only allocated
+  /// and their children put on the work list
+  template <typename SrcDocTy>
+  Entity copyShallow(const SrcDocTy &theSrc, const Entity theEntity) {
+    switch (theEntity.getKind()) {
+    case Entity::NUL:
+    case Entity::BOOL:
+      return theEntity;
+    case Entity::ARRAY: {
+      const auto aIdx = static_cast<intptr_t>(itsDest.itsArrays.size());
+      itsDest.itsArrays.push_back(typename DestDocTy::Array{0, 0});
+      itsPending.push_back(Pending{theEntity, aIdx});
+      return Entity{Entity::ARRAY, aIdx};
+    }
+    case Entity::OBJECT: {
+      const auto aIdx = static_cast<intptr_t>(itsDest.itsObjects.size());
+      itsDest.itsObjects.push_back(typename DestDocTy::Object{0, 0, 0});
+      itsPending.push_back(Pending{theEntity, aIdx});
+      return Entity{Entity::OBJECT, aIdx};
+    }
+    case Entity::NUMBER: {
+      const double aNumber = theEntity.itsKind == Entity::INLINE_NUMBER
+                                 ? theEntity.getInlineNumber()
+                                 : theSrc.getNumber(theEntity.itsPayload);
+      if constexpr (DestDocTy::Storage::INLINES_SCALARS) {
+        if (const auto aInline = Entity::makeInlineNumber(aNumber))
+          return *aInline;
+      }
+      itsDest.itsNumbers.push_back(aNumber);
+      return Entity{Entity::NUMBER,
+                    static_cast<intptr_t>(itsDest.itsNumbers.size() - 1)};
+    }
+    case Entity::STRING: {
+      const std::string_view aStr =
+          theEntity.itsKind == Entity::INLINE_STRING
+              ? theEntity.getInlineString()
+              : theSrc.getString(theEntity.itsPayload);
+      if constexpr (DestDocTy::Storage::INLINES_SCALARS) {
+        if (const auto aInline = Entity::makeInlineString(aStr))
+          return *aInline;
+      }
+      return Entity{Entity::STRING, appendString(aStr)};
+    }
+    }
+    return theEntity;
+  }
+
+  /// @return the index of the copy of theStr in itsStrings
+  intptr_t appendString(const std::string_view theStr) {
+    using Indices = typename DestDocTy::Indices;
+    const size_t aPos = itsDest.itsChars.size();
+    itsDest.itsChars.insert(itsDest.itsChars.end(), theStr.begin(),
+                            theStr.end());
+    itsDest.itsStrings.push_back(typename DestDocTy::String{
+        static_cast<typename Indices::Position>(aPos),
+        static_cast<typename Indices::Size>(theStr.size())});
+    return static_cast<intptr_t>(itsDest.itsStrings.size() - 1);
+  }
+
+  void appendKey(const std::string_view theKey) {
+    intptr_t aKeyPos = appendString(theKey);
+    if constexpr (DestDocTy::Storage::INTERNS_KEYS) {
+      const intptr_t aInterned = itsKeyInterner.intern(itsDest, {}, aKeyPos);
+      if (aInterned != aKeyPos) {
+        itsDest.itsChars.resize(itsDest.itsChars.size() - theKey.size());
+        itsDest.itsStrings.pop_back();
+        aKeyPos = aInterned;
+      }
+    }
+    itsDest.itsObjectProps.push_back(typename DestDocTy::Property{
+        static_cast<typename DestDocTy::Indices::Position>(aKeyPos)});
+  }
+
+  DestDocTy &itsDest;
+  std::vector<Pending> itsPending;
+  /// Keys copied so far if DestDocTy::Storage::INTERNS_KEYS
+  KeyInterner itsKeyInterner;
+};
+} // namespace impl
+} // namespace cjson
+#endif // CONSTEXPR_JSON_SUBTREE_COPY_H
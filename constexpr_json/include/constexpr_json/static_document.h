@@ -3,6 +3,9 @@
 
 #include "constexpr_json/document.h"
 
+#include <algorithm>
+#include <type_traits>
+
 namespace cjson {
 namespace impl {
 template <intptr_t theNumNumbers, intptr_t theNumChars, intptr_t theNumStrings,
@@ -11,6 +14,18 @@ template <intptr_t theNumNumbers, intptr_t theNumChars, intptr_t theNumStrings,
 struct StaticDocumentStorage {
   template <typename T, size_t N> using Buffer = std::array<T, N>;
 
+  static constexpr bool IS_GROWABLE = false;
+  static constexpr bool IS_BORROWING = false;
+  static constexpr bool INTERNS_KEYS = false;
+  /// Inline scalars cannot be read in constant expressions
+  static constexpr bool INLINES_SCALARS = false;
+  static constexpr bool HAS_PROPERTY_INDEX = false;
+  static constexpr bool CACHES_HASHES = false;
+  /// Parsing sorts the keys of every object, so that they can be looked up
+  /// with a binary search (see DocumentBase::sortKeys)
+  static constexpr bool SORTS_KEYS = true;
+  static constexpr bool DECODES_LAZILY = false;
+
   static constexpr intptr_t MAX_NUMBERS() { return theNumNumbers; }
   static constexpr intptr_t MAX_CHARS() { return theNumChars; }
   static constexpr intptr_t MAX_ENTITIES() {
@@ -23,6 +38,13 @@ struct StaticDocumentStorage {
   }
   static constexpr intptr_t MAX_STRINGS() { return theNumStrings; }
 
+  /// The document size is known at compile time, so we can choose the
+  /// narrowest indices that fit
+  using Indices = std::conditional_t<
+      NarrowIndices::fits(std::max({MAX_CHARS(), MAX_ENTITIES(), MAX_STRINGS(),
+                                    MAX_OBJECT_PROPS()})),
+      NarrowIndices, WideIndices>;
+
   template <typename T, size_t N>
   static constexpr Buffer<T, N> createBuffer(size_t theSize) {
     return Buffer<T, N>{};
@@ -72,6 +94,34 @@ struct StaticDocument
   }
 };
 
+/// Creates a StaticDocument of type DocTy from the contents of its buffers,
+/// as written by the json_to_header tool at build time (see
+/// generate_json_image_header in cmake/GenerateJsonHeader.cmake). This only
+/// copies the buffers and sorts the keys, so unlike parsing, the compiler
+/// does not spend any steps per character of JSON in constant evaluation.
+/// @param theChars string literal of the contents of itsChars
+template <typename DocTy>
+constexpr DocTy makeStaticDocument(
+    const decltype(DocTy::itsNumbers) &theNumbers,
+    const char (&theChars)[DocTy::Storage::MAX_CHARS() + 1],
+    const decltype(DocTy::itsEntities) &theEntities,
+    const decltype(DocTy::itsArrays) &theArrays,
+    const decltype(DocTy::itsObjects) &theObjects,
+    const decltype(DocTy::itsObjectProps) &theObjectProps,
+    const decltype(DocTy::itsStrings) &theStrings) {
+  DocTy aDoc{DocumentInfo{}};
+  aDoc.itsNumbers = theNumbers;
+  for (size_t aIdx = 0; aIdx < aDoc.itsChars.size(); ++aIdx)
+    aDoc.itsChars[aIdx] = theChars[aIdx];
+  aDoc.itsEntities = theEntities;
+  aDoc.itsArrays = theArrays;
+  aDoc.itsObjects = theObjects;
+  aDoc.itsObjectProps = theObjectProps;
+  aDoc.itsStrings = theStrings;
+  aDoc.sortKeys();
+  return aDoc;
+}
+
 #define CJSON_STATIC_DOCTY(theDocumentInfo)                                    \
   cjson::StaticDocument<                                                       \
       (theDocumentInfo).itsNumNumbers, (theDocumentInfo).itsNumChars,          \
@@ -1,12 +1,47 @@
 #include "constexpr_json/document_parser.h"
 #include "constexpr_json/dynamic_document.h"
+#include "constexpr_json/ext/arena_document.h"
+#include "constexpr_json/ext/binary_image.h"
+#include "constexpr_json/ext/error_is_detail.h"
 #include "constexpr_json/ext/error_is_except.h"
+#include "constexpr_json/ext/ndjson_reader.h"
+#include "constexpr_json/ext/on_demand_document.h"
+#include "constexpr_json/ext/push_parser.h"
+#include "constexpr_json/ext/stream_parser.h"
+#include "constexpr_json/impl/document_allocator.h"
+#include "constexpr_json/impl/document_parser3.h"
+#include "constexpr_json/impl/document_parser4.h"
+#include "constexpr_json/impl/structural_index.h"
 #include "constexpr_json/static_document.h"
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory_resource>
+#include <new>
+#include <random>
+#include <sstream>
+
 using namespace cjson;
 
+/// Counts the allocations made by the tests, including those of the worker
+/// threads of DocumentParser4
+static std::atomic<size_t> gNumAllocations = 0;
+void *operator new(const size_t theSize) {
+  gNumAllocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *aPtr = std::malloc(theSize ? theSize : 1))
+    return aPtr;
+  throw std::bad_alloc{};
+}
+void operator delete(void *thePtr) noexcept { std::free(thePtr); }
+void operator delete(void *thePtr, size_t) noexcept { std::free(thePtr); }
+
 static std::unique_ptr<DynamicDocument>
 parseJson(const std::string_view theJsonStr) {
   using Parser = DocumentParser<Utf8, Utf8, ErrorWillThrow<>>;
@@ -66,3 +101,1113 @@ TEST(cjson_basic, access_inequal) {
     EXPECT_NE(aDoc2->getRoot(), aDoc1->getRoot());
   }
 }
+
+TEST(cjson_basic, single_pass) {
+  using Parser = DocumentParser<Utf8, Utf8, ErrorWillThrow<>, DocumentParser3>;
+  const std::string_view aJson(R"({
+    "a": [1, -2.5, "x\n\u00e9", [], {}],
+    "b": {"c": [null, true, false], "d": {"e": "f"}},
+    "g": ""
+  })");
+  const auto aDoc = DynamicDocument::parseJson<Parser>(aJson);
+  EXPECT_EQ(aDoc->getRoot(), parseJson(aJson)->getRoot());
+  const auto aRoot = aDoc->getRoot().toObject();
+  EXPECT_EQ((*aRoot["a"]).toArray()[2].toString(), "x\n\u00e9");
+  EXPECT_EQ((*(*(*aRoot["b"]).toObject()["d"]).toObject()["e"]).toString(),
+            "f");
+  for (const std::string_view aScalar : {"null", "true", "0", "\"\""})
+    EXPECT_EQ(DynamicDocument::parseJson<Parser>(aScalar)->getRoot(),
+              parseJson(aScalar)->getRoot());
+}
+
+TEST(cjson_basic, single_pass_errors) {
+  using ErrorHandling = ErrorWillReturnDetail<>;
+  using Parser2 = DocumentParser<Utf8, Utf8, ErrorHandling>;
+  using Parser3 = DocumentParser<Utf8, Utf8, ErrorHandling, DocumentParser3>;
+  // Both parsers have to agree on the reason and position of errors
+  const auto expectError = [](const std::string_view theJson,
+                              const ErrorCode theCode,
+                              const intptr_t thePosition) {
+    const auto checkResult = [&](const auto &theResult) {
+      ASSERT_TRUE(ErrorHandling::isError(theResult)) << theJson;
+      EXPECT_EQ(ErrorHandling::getError(theResult).itsCode, theCode)
+          << theJson;
+      EXPECT_EQ(ErrorHandling::getError(theResult).itsPosition, thePosition)
+          << theJson;
+    };
+    checkResult(DynamicDocument::parseJson<Parser2>(theJson));
+    checkResult(DynamicDocument::parseJson<Parser3>(theJson));
+    Projection aWhole;
+    aWhole.add("");
+    checkResult(
+        DynamicDocument::parseJsonProjection<Parser3>(theJson, aWhole));
+  };
+  expectError("", ErrorCode::TYPE_DEDUCTION_FAILED, 0);
+  expectError("[1 2]", ErrorCode::ARRAY_EXPECTED_COMMA, 3);
+  expectError("[1,]", ErrorCode::TYPE_DEDUCTION_FAILED, 3);
+  expectError("[,1]", ErrorCode::TYPE_DEDUCTION_FAILED, 1);
+  expectError("{,}", ErrorCode::OBJECT_KEY_READ_FAILED, 1);
+  expectError("{\"a\" 1}", ErrorCode::OBJECT_EXPECTED_COLON, 5);
+  expectError("{\"a\": 1", ErrorCode::OBJECT_UNEXPECTED_TOKEN, 7);
+  expectError("[\"\\x\"]", ErrorCode::STRING_READ_FAILED, 1);
+  expectError("[nul]", ErrorCode::NULL_READ_FAILED, 1);
+  expectError("{} {}", ErrorCode::TRAILING_CONTENT, 2);
+  expectError("\"\\n \"  1", ErrorCode::TRAILING_CONTENT, 5);
+  expectError("1.5e+", ErrorCode::TRAILING_CONTENT, 3);
+  expectError("1null", ErrorCode::TRAILING_CONTENT, 1);
+  expectError("[1, 2] ]", ErrorCode::TRAILING_CONTENT, 6);
+  expectError("-00", ErrorCode::TRAILING_CONTENT, 2);
+}
+
+TEST(cjson_basic, structural_index) {
+  // Backslash runs and strings crossing the 64 byte block boundaries
+  static constexpr std::string_view aJson(
+      R"({"key with \\\" quote": ["\\", "\"", "\\\\\"\\"],)"
+      R"( "a":   [    1, 2.5    , true,  null, "\\\\\\\\\\\\\\\\\\\\",)"
+      R"(  "more than sixty-four characters in one string, \"escaped\"..."],)"
+      R"( "}": {"]": "[{:,"}, "": [[[]], {}]})");
+  impl::StructuralIndex aIndex;
+  ASSERT_TRUE(aIndex.build(aJson));
+  for (const uint32_t aPos : aIndex)
+    EXPECT_NE(aJson[aPos], ' ') << aPos;
+  EXPECT_EQ(aJson[aIndex[1]], '"');
+  EXPECT_EQ(aIndex[2], aJson.find("\": ["));
+  EXPECT_EQ(aIndex[aIndex.size() - 1], aJson.size() - 1);
+
+  // At compile time, DocumentInfo is computed character by character
+  static constexpr auto aScalarInfo =
+      DocumentInfo::compute<Utf8, Utf8, ErrorWillReturnNone>(aJson);
+  static_assert(aScalarInfo);
+  const auto aIndexedInfo =
+      DocumentInfo::compute<Utf8, Utf8, ErrorWillReturnNone>(aJson);
+  ASSERT_TRUE(aIndexedInfo);
+  EXPECT_EQ(aIndexedInfo->first, aScalarInfo->first);
+  EXPECT_EQ(aIndexedInfo->second, aScalarInfo->second);
+
+  using Parser = DocumentParser<Utf8, Utf8, ErrorWillThrow<>, DocumentParser3>;
+  const auto aDoc = parseJson(aJson);
+  EXPECT_EQ(aDoc->getRoot(),
+            DynamicDocument::parseJson<Parser>(aJson)->getRoot());
+  const auto aRoot = aDoc->getRoot().toObject();
+  EXPECT_EQ((*aRoot["key with \\\" quote"]).toArray()[2].toString(),
+            "\\\\\"\\");
+  EXPECT_EQ((*aRoot["a"]).toArray()[1].toNumber(), 2.5);
+  EXPECT_EQ((*(*aRoot["}"]).toObject()["]"]).toString(), "[{:,");
+
+  // Malformed documents fail the same way as without the index
+  EXPECT_FALSE(aIndex.build(R"(["\"])"));
+  const auto computeInfo = [](const std::string_view theJson) {
+    return DocumentInfo::compute<Utf8, Utf8, ErrorWillReturnNone>(theJson);
+  };
+  for (const std::string_view aBroken :
+       {"[1 2]", "[true\"\"]", "[truex]", "{\"a\":1,}", "[\"\\\"]"})
+    EXPECT_FALSE(computeInfo(aBroken)) << aBroken;
+}
+
+TEST(cjson_basic, plain_string_runs) {
+  // Place every kind of special char at every offset of the SIMD/SWAR blocks
+  for (const char aSpecial : {'"', '\\', '\x1f', '\x7f', '\x80', '\xff'}) {
+    for (size_t aPos = 0; aPos < 70; ++aPos) {
+      std::string aStr(80, 'a');
+      aStr[aPos] = aSpecial;
+      const size_t aExpected = aSpecial == '\x7f' ? 80 : aPos;
+      EXPECT_EQ(impl::countPlainAscii(aStr), aExpected) << aPos;
+      EXPECT_EQ(impl::countPlainAscii(std::string_view(aStr).substr(0, aPos)),
+                aPos);
+    }
+  }
+
+  const std::string aPlain(100, 'x');
+  const std::string aJson = "[\"" + aPlain + "\\n" + aPlain + "\\u00e9\", \"" +
+                            aPlain + "\u00e9" + aPlain + "\"]";
+  const auto aDoc = parseJson(aJson);
+  const auto aArr = aDoc->getRoot().toArray();
+  EXPECT_EQ(aArr[0].toString(), aPlain + "\n" + aPlain + "\u00e9");
+  EXPECT_EQ(aArr[1].toString(), aPlain + "\u00e9" + aPlain);
+  using Parser = DocumentParser<Utf8, Utf8, ErrorWillThrow<>, DocumentParser3>;
+  EXPECT_EQ(DynamicDocument::parseJson<Parser>(aJson)->getRoot(),
+            aDoc->getRoot());
+  const auto computeInfo = [](const std::string_view theJson) {
+    return DocumentInfo::compute<Utf8, Utf8, ErrorWillReturnNone>(theJson);
+  };
+  const auto aInfo = computeInfo(aJson);
+  ASSERT_TRUE(aInfo);
+  EXPECT_EQ(aInfo->first.itsNumChars, 4 * 100 + 1 + 2 + 2);
+  EXPECT_FALSE(computeInfo("[\"" + aPlain + "\x01" + aPlain + "\"]"));
+}
+
+TEST(cjson_basic, number_round_trip) {
+  const parsing<Utf8> p;
+  const auto expectLikeStrtod = [&p](const std::string &theNumber) {
+    const auto [aParsed, aParsedLen] = p.parseNumber(theNumber);
+    EXPECT_EQ(aParsedLen, theNumber.size()) << theNumber;
+    EXPECT_EQ(aParsed, std::strtod(theNumber.c_str(), nullptr)) << theNumber;
+  };
+  std::mt19937_64 aRng(1234);
+  std::uniform_real_distribution<double> aCoordinate(-180., 180.);
+  char aBuffer[64];
+  for (int i = 0; i < 10000; ++i) {
+    // Shortest round-trip representation of arbitrary bit patterns
+    uint64_t aBits = aRng();
+    double aDouble;
+    std::memcpy(&aDouble, &aBits, sizeof(aDouble));
+    if (aDouble - aDouble == 0.) {
+      std::snprintf(aBuffer, sizeof(aBuffer), "%.17g", aDouble);
+      EXPECT_EQ(p.parseNumber(aBuffer).first, aDouble) << aBuffer;
+      // More digits than fit into 64 bits
+      std::snprintf(aBuffer, sizeof(aBuffer), "%.30e", aDouble);
+      expectLikeStrtod(aBuffer);
+    }
+    // Geo coordinates and integers beyond 2^53
+    std::snprintf(aBuffer, sizeof(aBuffer), "%.7f", aCoordinate(aRng));
+    expectLikeStrtod(aBuffer);
+    std::snprintf(aBuffer, sizeof(aBuffer), "%llu",
+                  static_cast<unsigned long long>(aRng()));
+    expectLikeStrtod(aBuffer);
+  }
+  // Exactly halfway between 1 and the next double: round to even
+  expectLikeStrtod("1.00000000000000011102230246251565404236316680908203125");
+  expectLikeStrtod("1.00000000000000011102230246251565404236316680908203126");
+}
+
+/// "[[...]]" with Depth levels, usable in constant expressions
+template <size_t Depth> struct NestedArrays {
+  std::array<char, 2 * Depth> itsChars{};
+  constexpr NestedArrays() {
+    for (size_t i = 0; i < Depth; ++i) {
+      itsChars[i] = '[';
+      itsChars[2 * Depth - 1 - i] = ']';
+    }
+  }
+  constexpr std::string_view view() const {
+    return {itsChars.data(), itsChars.size()};
+  }
+};
+
+/// Utf8 without the ASCII_COMPATIBLE flag is scanned character by character
+struct ScalarUtf8 : Utf8 {
+  static constexpr bool ASCII_COMPATIBLE = false;
+};
+
+TEST(cjson_basic, deep_nesting) {
+  // Documents are not scanned recursively, so depth is unlimited by default
+  static constexpr NestedArrays<500> aNested;
+  static_assert(
+      DocumentInfo::compute<Utf8, Utf8, ErrorWillReturnNone>(aNested.view()));
+  static_assert(!DocumentInfo::compute<Utf8, Utf8, ErrorWillReturnNone, 100>(
+      aNested.view()));
+
+  using ErrorHandling = ErrorWillReturnDetail<>;
+  const auto expectError = [](const auto &theResult, const ErrorCode theCode,
+                              const intptr_t thePosition) {
+    ASSERT_TRUE(ErrorHandling::isError(theResult));
+    EXPECT_EQ(ErrorHandling::getError(theResult).itsCode, theCode);
+    EXPECT_EQ(ErrorHandling::getError(theResult).itsPosition, thePosition);
+  };
+  const std::string aDeep =
+      std::string(100000, '[') + "{}" + std::string(100000, ']');
+  const auto aInfo = DocumentInfo::compute<Utf8, Utf8, ErrorHandling>(aDeep);
+  ASSERT_FALSE(ErrorHandling::isError(aInfo));
+  EXPECT_EQ(ErrorHandling::unwrap(aInfo).first.itsNumArrays, 100000);
+  EXPECT_EQ(ErrorHandling::unwrap(aInfo).first.itsNumArrayEntries, 100000);
+  EXPECT_EQ(ErrorHandling::unwrap(aInfo).first.itsNumObjects, 1);
+  const auto aScalarInfo =
+      DocumentInfo::compute<ScalarUtf8, Utf8, ErrorHandling>(aDeep);
+  ASSERT_FALSE(ErrorHandling::isError(aScalarInfo));
+  EXPECT_EQ(ErrorHandling::unwrap(aScalarInfo), ErrorHandling::unwrap(aInfo));
+  expectError(DocumentInfo::compute<Utf8, Utf8, ErrorHandling, 10>(aDeep),
+              ErrorCode::MAX_DEPTH_EXCEEDED, 11);
+  expectError(DocumentInfo::compute<ScalarUtf8, Utf8, ErrorHandling, 10>(aDeep),
+              ErrorCode::MAX_DEPTH_EXCEEDED, 11);
+  EXPECT_EQ(parseJson(aDeep)->getRoot().toArray().size(), 1);
+
+  // Leading commas used to be skipped
+  expectError(DocumentInfo::compute<ScalarUtf8, Utf8, ErrorHandling>("[,1]"),
+              ErrorCode::TYPE_DEDUCTION_FAILED, 1);
+  expectError(
+      DocumentInfo::compute<ScalarUtf8, Utf8, ErrorHandling>("{ ,\"a\": 1}"),
+      ErrorCode::OBJECT_KEY_READ_FAILED, 2);
+}
+
+TEST(cjson_basic, borrowed_strings) {
+  std::string aJson =
+      R"({"plain": "plain value", )"
+      R"("esc\u00e9": ["x\ny z", "\u00e9 abcdef", ""]})";
+  const auto aExpected = parseJson(aJson);
+  const auto isBorrowed = [](const auto &theDoc,
+                             const std::string_view theStr) {
+    const std::string_view aSource = theDoc.getSource();
+    return theStr.data() >= aSource.data() &&
+           theStr.data() < aSource.data() + aSource.size();
+  };
+  const auto checkDoc = [&](const auto &theDoc) {
+    EXPECT_EQ(theDoc.getRoot(), aExpected->getRoot());
+    const auto aRoot = theDoc.getRoot().toObject();
+    const auto [aKey, aValue] = *aRoot.begin();
+    EXPECT_TRUE(isBorrowed(theDoc, aKey));
+    EXPECT_TRUE(isBorrowed(theDoc, aValue.toString()));
+    const auto aArr = (*aRoot["esc\u00e9"]).toArray();
+    EXPECT_FALSE(isBorrowed(theDoc, aArr[0].toString()));
+    EXPECT_FALSE(isBorrowed(theDoc, aArr[1].toString()));
+    // Only the escaped strings are copied, short ones are inlined
+    EXPECT_EQ(theDoc.itsChars.size(),
+              std::string_view("esc\u00e9\u00e9 abcdef").size());
+  };
+
+  using Parser = DocumentParser<Utf8, Utf8, ErrorWillThrow<>>;
+  using Parser3 = DocumentParser<Utf8, Utf8, ErrorWillThrow<>, DocumentParser3>;
+  const auto aView = DynamicDocumentView::parseJson<Parser>(aJson);
+  checkDoc(*aView);
+  checkDoc(*DynamicDocumentView::parseJson<Parser3>(aJson));
+  EXPECT_EQ(aView->getSource().data(), aJson.data());
+
+  // Owning documents do not depend on the lifetime of the input
+  auto aOwning = BorrowingDynamicDocument::parseJson<Parser>(aJson);
+  auto aOwning3 = BorrowingDynamicDocument::parseJson<Parser3>(aJson);
+  aJson.assign(aJson.size(), ' ');
+  checkDoc(*aOwning);
+  checkDoc(*aOwning3);
+  // Short inputs are moved without keeping their address
+  EXPECT_EQ(BorrowingDynamicDocument::parseJson<Parser>("\"short\"")->getRoot(),
+            parseJson("\"short\"")->getRoot());
+  EXPECT_FALSE(BorrowingDynamicDocument::parseJson("[\"\\x\"]"));
+}
+
+TEST(cjson_basic, parallel_parsing) {
+  // Large enough to be split into several chunks. Backslash runs and strings
+  // end up at all kinds of offsets relative to the chunk boundaries.
+  std::mt19937_64 aRng(42);
+  const auto makeElement = [&aRng](const size_t theIdx) {
+    const std::string aBackslashes(aRng() % 9, '\\');
+    switch (aRng() % 5) {
+    case 0:
+      return std::to_string(aRng() % 100000) + ".25";
+    case 1:
+      return "\"" + std::string(aRng() % 90, 'x') + "\\\"" + aBackslashes +
+             aBackslashes + "\"";
+    case 2:
+      return "{\"k" + std::to_string(theIdx) + "\": [true, null, {}], \"v\": " +
+             "\"[{,:\\u00e9\"}";
+    case 3:
+      return std::string("[[], [[false]], \"\\\\\"]");
+    default:
+      return std::string("  \n\t -17e-2 ");
+    }
+  };
+  std::string aArrayJson = "[";
+  std::string aObjectJson = "{";
+  std::vector<size_t> aCommas;
+  for (size_t aIdx = 0; aArrayJson.size() < 200000; ++aIdx) {
+    const std::string aElement = makeElement(aIdx);
+    const char *const aSep = aIdx ? "," : "";
+    if (aIdx)
+      aCommas.push_back(aArrayJson.size());
+    aArrayJson += aSep + aElement;
+    aObjectJson += aSep + ("\"" + std::to_string(aIdx) + "\": ") + aElement;
+  }
+  aArrayJson += "]";
+  aObjectJson += "}";
+
+  using Parser =
+      DocumentParser<Utf8, Utf8, ErrorWillReturnNone, DocumentParser4>;
+  for (const std::string &aJson : {aArrayJson, aObjectJson}) {
+    impl::StructuralIndex aIndex;
+    ASSERT_TRUE(aIndex.build(aJson));
+    const auto aExpected = parseJson(aJson);
+    for (const unsigned aNumThreads : {1u, 3u, 8u}) {
+      impl::StructuralIndex aParallelIndex;
+      ASSERT_TRUE(aParallelIndex.buildParallel(aJson, aNumThreads));
+      EXPECT_TRUE(std::equal(aIndex.begin(), aIndex.end(),
+                             aParallelIndex.begin(), aParallelIndex.end()));
+      const auto aDoc = Parser::parseDocument<DynamicDocument>(
+          aJson, ParallelOptions{aNumThreads, 0});
+      ASSERT_TRUE(aDoc) << aNumThreads;
+      EXPECT_EQ(aDoc->getRoot(), aExpected->getRoot()) << aNumThreads;
+    }
+  }
+
+  // Errors inside of any of the groups or between them are detected
+  const ParallelOptions aOptions{4, 0};
+  for (const size_t aPart : {10, 2}) {
+    const size_t aComma = aCommas[aCommas.size() / aPart];
+    std::string aBroken = aArrayJson;
+    aBroken.insert(aComma, "x");
+    EXPECT_FALSE(Parser::parseDocument<DynamicDocument>(aBroken, aOptions));
+    aBroken = aArrayJson;
+    aBroken[aComma] = ' ';
+    EXPECT_FALSE(Parser::parseDocument<DynamicDocument>(aBroken, aOptions));
+  }
+  EXPECT_FALSE(
+      Parser::parseDocument<DynamicDocument>(aArrayJson + "]", aOptions));
+  EXPECT_FALSE(Parser::parseDocument<DynamicDocument>(
+      aArrayJson.substr(0, aArrayJson.size() - 1), aOptions));
+  EXPECT_FALSE(Parser::parseDocument<DynamicDocument>(
+      aObjectJson.substr(0, aObjectJson.size() - 1) + ",}", aOptions));
+}
+
+TEST(cjson_basic, ndjson_reader) {
+  // Longer than the initial read buffer
+  const std::string aLongString(100000, 'x');
+  const std::string aInput = "{\"id\": 1, \"tags\": [\"a\", \"b\"]}\n"
+                             "\n"
+                             "[1, 2\r\n"
+                             "  \"" +
+                             aLongString +
+                             "\"\r\n"
+                             " \t \n"
+                             "{\"id\": 2}";
+  using Reader = NdjsonReader<>;
+  using ErrorHandling = Reader::ParserTy::error_handling;
+  const auto checkRecords = [&](Reader &theReader) {
+    std::vector<size_t> aLineNumbers;
+    for (const Reader::Record &aRecord : theReader) {
+      aLineNumbers.push_back(aRecord.itsLineNumber);
+      if (aRecord.itsLineNumber == 3) {
+        ASSERT_TRUE(ErrorHandling::isError(aRecord.itsResult));
+        EXPECT_EQ(ErrorHandling::getError(aRecord.itsResult).itsCode,
+                  ErrorCode::ARRAY_UNEXPECTED_TOKEN);
+        continue;
+      }
+      ASSERT_FALSE(ErrorHandling::isError(aRecord.itsResult));
+      EXPECT_EQ(ErrorHandling::unwrap(aRecord.itsResult)->getRoot(),
+                parseJson(aRecord.itsLine)->getRoot());
+    }
+    EXPECT_EQ(aLineNumbers, (std::vector<size_t>{1, 3, 4, 6}));
+    EXPECT_FALSE(theReader.hasReadError());
+  };
+  std::istringstream aStream(aInput);
+  Reader aStreamReader(aStream);
+  checkRecords(aStreamReader);
+  Reader aBufferReader(aInput);
+  checkRecords(aBufferReader);
+
+  // Allocations reach a steady state after the first few records
+  std::string aLog;
+  for (int aIdx = 0; aIdx < 2000; ++aIdx)
+    aLog += "{\"seq\": " + std::to_string(aIdx) +
+            ", \"msg\": \"caf\\u00e9 " + std::to_string(aIdx % 7) +
+            "\", \"ok\": [true, null, {}]}\n" + (aIdx % 100 ? "" : "{]\n");
+  std::istringstream aLogStream(aLog);
+  Reader aLogReader(aLogStream);
+  for (int aIdx = 0; aIdx < 10; ++aIdx)
+    ASSERT_TRUE(aLogReader.next());
+  const size_t aNumAllocations = gNumAllocations;
+  size_t aNumRecords = 10, aNumErrors = 0;
+  while (aLogReader.next()) {
+    ++aNumRecords;
+    aNumErrors += ErrorHandling::isError(aLogReader.getRecord().itsResult);
+  }
+  EXPECT_EQ(gNumAllocations.load(), aNumAllocations);
+  EXPECT_EQ(aNumRecords, 2020u);
+  EXPECT_EQ(aNumErrors, 19u);
+}
+
+TEST(cjson_basic, push_parser) {
+  using Parser = PushParser<>;
+  using ErrorHandling = ErrorWillReturnDetail<>;
+  const auto parseChunked = [](const std::string_view theJson,
+                               const size_t theChunkSize) {
+    Parser aParser;
+    for (size_t aPos = 0; aPos < theJson.size(); aPos += theChunkSize)
+      aParser.feed(theJson.substr(aPos, theChunkSize));
+    return aParser.finish();
+  };
+  // Every token is split at every position by some chunk size
+  for (const std::string_view aJson :
+       {"[]", "  {} ", "-12.5e+3", "null", "\"\\\"\u00e9\\\\\"",
+        R"({"a": [1, true, {"b\"\\": null}, "\\"], "c": {}, "":-0})",
+        R"([[[]], [[1, 2], {"x": [false]}], "long string with spaces"])"}) {
+    const auto aExpected = parseJson(aJson);
+    for (size_t aChunkSize = 1; aChunkSize <= aJson.size(); ++aChunkSize) {
+      const auto aResult = parseChunked(aJson, aChunkSize);
+      ASSERT_FALSE(ErrorHandling::isError(aResult)) << aJson << aChunkSize;
+      EXPECT_EQ(ErrorHandling::unwrap(aResult)->getRoot(),
+                aExpected->getRoot());
+    }
+  }
+  // Errors are the same as if the whole input was parsed at once
+  using ParserTy = StreamParser<>::ParserTy;
+  for (const std::string_view aBroken :
+       {"", " ", "[", "[1,", "[1 2]", "[1,]", "{\"a\" 1}", "{\"a\":}", "{,}",
+        "{\"a\":1,}", "nul", "truex", "01", "1.", "-", "\"abc", "\"\\x\"",
+        "\"\\\"", "[\"a\x01\"]", "1 2", "[]]", "{\"a\":1}}", "[#]", "1null",
+        "[ null,", "{\"a\": falsey}", "1.5e+", "-00", "\"\\n \"  1", "{\"a\"",
+        "{\"a\": ", "{\"a", "[1 \xc3\xa9]", "[1 \xff]", "[\xff]",
+        "{\xe2\x82\xac}", "{\xe2\x82}"}) {
+    const auto aExpected = DynamicDocument::parseJson<ParserTy>(aBroken);
+    ASSERT_TRUE(ErrorHandling::isError(aExpected)) << aBroken;
+    const auto expectSameError = [&](const auto &theResult,
+                                     const size_t theChunkSize) {
+      ASSERT_TRUE(ErrorHandling::isError(theResult)) << aBroken << theChunkSize;
+      EXPECT_EQ(ErrorHandling::getError(theResult).itsCode,
+                ErrorHandling::getError(aExpected).itsCode)
+          << aBroken << theChunkSize;
+      EXPECT_EQ(ErrorHandling::getError(theResult).itsPosition,
+                ErrorHandling::getError(aExpected).itsPosition)
+          << aBroken << theChunkSize;
+    };
+    for (size_t aChunkSize = 1; aChunkSize <= aBroken.size() + 1; ++aChunkSize)
+      expectSameError(parseChunked(aBroken, aChunkSize), aChunkSize);
+    std::istringstream aBrokenStream{std::string(aBroken)};
+    const auto aStreamResult = StreamParser<>::parse(aBrokenStream);
+    ASSERT_TRUE(aStreamResult);
+    expectSameError(*aStreamResult, aBroken.size());
+  }
+  const auto aError = ErrorHandling::getError(parseChunked("[1, 2 3]", 2));
+  EXPECT_EQ(aError.itsCode, ErrorCode::ARRAY_EXPECTED_COMMA);
+  EXPECT_EQ(aError.itsPosition, 6);
+
+  // StreamParser feeds the stream to a PushParser while reading it
+  const std::string aLarge = "[" + std::string(100000, ' ') + "\"" +
+                             std::string(100000, 'x') + "\"]";
+  std::istringstream aStream(aLarge);
+  std::string aJsonOut;
+  const auto aStreamResult = StreamParser<>::parse(aStream, &aJsonOut);
+  ASSERT_TRUE(aStreamResult);
+  ASSERT_FALSE(ErrorHandling::isError(*aStreamResult));
+  EXPECT_EQ(ErrorHandling::unwrap(*aStreamResult)->getRoot(),
+            parseJson(aLarge)->getRoot());
+  EXPECT_EQ(aJsonOut, aLarge);
+}
+
+TEST(cjson_basic, property_index) {
+  std::string aJson = "{";
+  for (int aIdx = 0; aIdx < 300; ++aIdx)
+    aJson += "\"key" + std::to_string(aIdx) + "\": " + std::to_string(aIdx) +
+             ", ";
+  aJson += R"("key7": "duplicate", "esc\"aped": {"small": true}})";
+  const auto checkLookups = [](const auto &theDoc) {
+    const auto aRoot = theDoc.getRoot().toObject();
+    for (int aIdx = 0; aIdx < 300; ++aIdx) {
+      const auto aValue = aRoot["key" + std::to_string(aIdx)];
+      ASSERT_TRUE(aValue);
+      EXPECT_EQ(aValue->toNumber(), aIdx);
+    }
+    EXPECT_TRUE((*(*aRoot["esc\"aped"]).toObject()["small"]).toBool());
+    EXPECT_FALSE(aRoot["key300"]);
+    EXPECT_FALSE(aRoot[""]);
+  };
+  auto aDoc = std::move(*parseJson(aJson));
+  EXPECT_EQ(aDoc.itsPropertyIndexPos.size(), 2u);
+  EXPECT_EQ(aDoc.itsPropertyIndexPos[1], -1);
+  checkLookups(aDoc);
+  // The first one of duplicate keys is found, just like without index
+  aDoc.buildPropertyIndex(std::numeric_limits<size_t>::max());
+  EXPECT_TRUE(aDoc.itsPropertyIndexPos.empty());
+  checkLookups(aDoc);
+  aDoc.buildPropertyIndex(0);
+  checkLookups(aDoc);
+  EXPECT_EQ((*aDoc.getRoot().toObject()["key7"]).getType(), Entity::NUMBER);
+
+  const auto aBorrowing = BorrowingDynamicDocument::parseJson(aJson);
+  ASSERT_TRUE(aBorrowing);
+  EXPECT_FALSE((*aBorrowing)->itsPropertyIndexPos.empty());
+  checkLookups(**aBorrowing);
+}
+
+TEST(cjson_basic, interned_keys) {
+  std::string aJson = "[";
+  for (int aIdx = 0; aIdx < 1000; ++aIdx) {
+    aJson += aIdx ? ", " : "";
+    aJson += R"({"id": )" + std::to_string(aIdx) +
+             R"(, "name": "long name", "tags": {"id": [], "name": null}})";
+  }
+  aJson += "]";
+  const auto aExpected = parseJson(aJson);
+  const auto checkDoc = [&](const auto &theResult) {
+    ASSERT_TRUE(theResult);
+    const InterningDynamicDocument &aDoc = **theResult;
+    EXPECT_EQ(aDoc.getRoot(), aExpected->getRoot());
+    // "id", "name", "tags" and the 1000 "long name" values
+    EXPECT_EQ(aDoc.itsStrings.size(), 1003u);
+    EXPECT_EQ(aDoc.itsChars.size(), 1000u * 9 + 10);
+    const Object &aFirst = aDoc.itsObjects[0];
+    const Object &aLast = aDoc.itsObjects[aDoc.itsObjects.size() - 2];
+    for (size_t aProp = 0; aProp < 3; ++aProp)
+      EXPECT_EQ(aDoc.itsObjectProps[aFirst.itsKeysPos + aProp].itsKeyPos,
+                aDoc.itsObjectProps[aLast.itsKeysPos + aProp].itsKeyPos);
+  };
+  checkDoc(InterningDynamicDocument::parseJson(aJson));
+  using Parser3 =
+      DocumentParser<Utf8, Utf8, ErrorWillReturnNone, DocumentParser3>;
+  checkDoc(InterningDynamicDocument::parseJson<Parser3>(aJson));
+
+  // Keys are interned across the parts of parallel parsing, too, so the
+  // result does not depend on the number of threads
+  using Parser4 =
+      DocumentParser<Utf8, Utf8, ErrorWillReturnNone, DocumentParser4>;
+  std::string aObjectJson = "{";
+  for (int aIdx = 0; aIdx < 1000; ++aIdx)
+    aObjectJson += std::string(aIdx ? ", " : "") + R"("key": {"id": )" +
+                   std::to_string(aIdx) + R"(, "name": "long name"})";
+  aObjectJson += "}";
+  for (const std::string &aInput : {aJson, aObjectJson}) {
+    const auto aSingle = Parser4::parseDocument<InterningDynamicDocument>(
+        aInput, ParallelOptions{1, 0});
+    ASSERT_TRUE(aSingle);
+    for (const unsigned aNumThreads : {2u, 4u, 8u}) {
+      const auto aParallel = Parser4::parseDocument<InterningDynamicDocument>(
+          aInput, ParallelOptions{aNumThreads, 0});
+      ASSERT_TRUE(aParallel) << aNumThreads;
+      EXPECT_EQ(aParallel->getRoot(), aSingle->getRoot()) << aNumThreads;
+      EXPECT_EQ(aParallel->itsStrings.size(), aSingle->itsStrings.size())
+          << aNumThreads;
+      EXPECT_EQ(aParallel->itsChars.size(), aSingle->itsChars.size())
+          << aNumThreads;
+    }
+    if (&aInput == &aJson)
+      checkDoc(std::make_optional(
+          std::make_unique<InterningDynamicDocument>(*Parser4::parseDocument<
+              InterningDynamicDocument>(aJson, ParallelOptions{4, 0}))));
+  }
+}
+
+TEST(cjson_basic, compact_document) {
+  static_assert(sizeof(Entity) == 8);
+  static_assert(sizeof(CompactDynamicDocument::String) == 8);
+  const std::string_view aJson =
+      R"({"a": [1, -2.5, "xé", {"b": null, "c": [true, false]}],)"
+      R"( "": {}, "d": [[], [[]]], "e": "tail"})";
+  const auto aExpected = parseJson(aJson);
+  const auto aCompact = CompactDynamicDocument::parseJson(aJson);
+  ASSERT_TRUE(aCompact);
+  EXPECT_EQ((*aCompact)->getRoot(), aExpected->getRoot());
+  using Parser3 =
+      DocumentParser<Utf8, Utf8, ErrorWillReturnNone, DocumentParser3>;
+  const auto aCompact3 = CompactDynamicDocument::parseJson<Parser3>(aJson);
+  ASSERT_TRUE(aCompact3);
+  EXPECT_EQ((*aCompact3)->getRoot(), aExpected->getRoot());
+  EXPECT_EQ(JsonErrorDetail::getErrorCodeDesc(ErrorCode::DOCUMENT_TOO_LARGE),
+            std::string_view{
+                "Document does not fit the index width of its storage"});
+}
+
+TEST(cjson_basic, inline_scalars) {
+  const std::string_view aJson =
+      R"([0, -17, 1e15, 0.5, 0.1, -0.0, "", "seven77", "eight888", "é\n",)"
+      R"( {"short key": "x"}])";
+  const auto checkDoc = [](const auto &theDoc) {
+    const auto aArr = theDoc.getRoot().toArray();
+    EXPECT_EQ(aArr[0].toNumber(), 0.);
+    EXPECT_EQ(aArr[1].toNumber(), -17.);
+    EXPECT_EQ(aArr[2].toNumber(), 1e15);
+    EXPECT_EQ(aArr[3].toNumber(), .5);
+    EXPECT_EQ(aArr[4].toNumber(), .1);
+    EXPECT_TRUE(std::signbit(aArr[5].toNumber()));
+    EXPECT_EQ(aArr[6].toString(), "");
+    EXPECT_EQ(aArr[7].toString(), "seven77");
+    EXPECT_EQ(aArr[8].toString(), "eight888");
+    EXPECT_EQ(aArr[9].toString(), "é\n");
+    EXPECT_EQ(aArr[9].getType(), Entity::STRING);
+    EXPECT_EQ((*aArr[10].toObject()["short key"]).toString(), "x");
+    // Only 0.1 has too many mantissa bits to be inlined
+    EXPECT_EQ(theDoc.itsNumbers.size(), 1u);
+    // The key and "eight888" are the only strings that are not inlined
+    EXPECT_EQ(theDoc.itsStrings.size(), 2u);
+  };
+  checkDoc(*parseJson(aJson));
+  using Parser3 = DocumentParser<Utf8, Utf8, ErrorWillThrow<>, DocumentParser3>;
+  checkDoc(*DynamicDocument::parseJson<Parser3>(aJson));
+  checkDoc(*CompactDynamicDocument::parseJson<Parser3>(aJson));
+
+  // Inline entities are copied along with the documents they are in
+  const auto aDoc = parseJson(aJson);
+  const DynamicDocument aCopy = *aDoc;
+  EXPECT_EQ(aCopy.getRoot(), aDoc->getRoot());
+  EXPECT_NE(aCopy.getRoot().toArray()[7].toString().data(),
+            aDoc->getRoot().toArray()[7].toString().data());
+}
+
+TEST(cjson_basic, interface_view) {
+  // References into runtime documents are bound to the concrete storage
+  static_assert(
+      std::is_same_v<DynamicDocument::EntityRef,
+                     impl::EntityRefImpl<
+                         DocumentBase<impl::DynamicDocumentStorage>>>);
+  static_assert(!std::is_polymorphic_v<DynamicDocument>);
+  static_assert(!std::is_polymorphic_v<DynamicDocumentView>);
+
+  const std::string_view aJson =
+      R"({"a": [1, "long string", null], "b": {"c": true}})";
+  const auto aDoc = parseJson(aJson);
+  const auto aView = DynamicDocumentView::parseJson(aJson);
+  ASSERT_TRUE(aView && *aView);
+  // The type-erased views handle documents of different types alike
+  const DocumentInterfaceView<DynamicDocument> aErased1{*aDoc};
+  const DocumentInterfaceView<DynamicDocumentView> aErased2{**aView};
+  const DocumentInterface &aInterface1 = aErased1;
+  const DocumentInterface &aInterface2 = aErased2;
+  EXPECT_EQ(aInterface1, aInterface2);
+  EXPECT_EQ(aInterface1.getRoot(), aDoc->getRoot());
+  const auto aArr = (*aInterface2.getRoot().toObject()["a"]).toArray();
+  EXPECT_EQ(aArr[1].toString(), "long string");
+  EXPECT_EQ(aArr[1].toString().data(), aJson.data() + aJson.find("long"));
+}
+
+TEST(cjson_basic, binary_image) {
+  std::string aJson = R"({"list": [1, 0.1, "short", "long string", null],)";
+  for (int aIdx = 0; aIdx < 20; ++aIdx)
+    aJson += "\"key" + std::to_string(aIdx) + "\": " + std::to_string(aIdx) +
+             ", ";
+  aJson += R"("esc\"aped": {"nested": [true, false, {}]}})";
+  const auto aDoc = parseJson(aJson);
+  using ErrorHandling = ErrorWillReturnDetail<>;
+  // Images are loaded from words to keep the sections aligned
+  const auto toWords = [](const std::string &theImage) {
+    std::vector<uint64_t> aWords(theImage.size() / sizeof(uint64_t) + 1);
+    std::memcpy(aWords.data(), theImage.data(), theImage.size());
+    return aWords;
+  };
+  std::ostringstream aStream;
+  ASSERT_TRUE(writeBinaryImage(*aDoc, aStream));
+  const std::string aImage = aStream.str();
+  const std::vector<uint64_t> aWords = toWords(aImage);
+  const std::string_view aImageView{
+      reinterpret_cast<const char *>(aWords.data()), aImage.size()};
+  const auto aMapped = MappedDocument::fromImage(aImageView);
+  ASSERT_FALSE(ErrorHandling::isError(aMapped));
+  const MappedDocument &aMappedDoc = *ErrorHandling::unwrap(aMapped);
+  EXPECT_EQ(aMappedDoc.getRoot(), aDoc->getRoot());
+  // The property index is served from the image as well
+  EXPECT_FALSE(aMappedDoc.itsPropertyIndex.empty());
+  EXPECT_EQ((*aMappedDoc.getRoot().toObject()["key17"]).toNumber(), 17.);
+  EXPECT_FALSE(aMappedDoc.getRoot().toObject()["key20"]);
+  EXPECT_EQ(aMappedDoc.getImage().data(), aImageView.data());
+
+  // Borrowed strings are copied into the image
+  const auto aView = DynamicDocumentView::parseJson(aJson);
+  ASSERT_TRUE(aView && *aView);
+  std::ostringstream aViewStream;
+  ASSERT_TRUE(writeBinaryImage(**aView, aViewStream));
+  const std::string aViewImage = aViewStream.str();
+  const std::vector<uint64_t> aViewWords = toWords(aViewImage);
+  const auto aFromView = MappedDocument::fromImage(std::string_view{
+      reinterpret_cast<const char *>(aViewWords.data()), aViewImage.size()});
+  ASSERT_FALSE(ErrorHandling::isError(aFromView));
+  EXPECT_EQ(ErrorHandling::unwrap(aFromView)->getRoot(), aDoc->getRoot());
+
+  // Images are served from files without parsing
+  const std::string aPath = ::testing::TempDir() + "cjson_binary_image.bin";
+  {
+    std::ofstream aFile{aPath, std::ios::binary};
+    ASSERT_TRUE(writeBinaryImage(*aDoc, aFile));
+  }
+  {
+    const auto aFromFile = MappedDocument::mapFile(aPath.c_str());
+    ASSERT_FALSE(ErrorHandling::isError(aFromFile));
+    EXPECT_EQ(ErrorHandling::unwrap(aFromFile)->getRoot(), aDoc->getRoot());
+  }
+  std::remove(aPath.c_str());
+  const auto aMissing = MappedDocument::mapFile(aPath.c_str());
+  ASSERT_TRUE(ErrorHandling::isError(aMissing));
+  EXPECT_EQ(ErrorHandling::getError(aMissing).itsCode,
+            ErrorCode::IMAGE_READ_FAILED);
+
+  // Malformed images and mismatching index widths are rejected
+  const auto isInvalid = [](const auto &theResult) {
+    return ErrorHandling::isError(theResult) &&
+           ErrorHandling::getError(theResult).itsCode ==
+               ErrorCode::IMAGE_INVALID;
+  };
+  EXPECT_TRUE(isInvalid(CompactMappedDocument::fromImage(aImageView)));
+  EXPECT_TRUE(isInvalid(MappedDocument::fromImage(aImageView.substr(0, 64))));
+  EXPECT_TRUE(isInvalid(MappedDocument::fromImage(
+      aImageView.substr(0, aImageView.size() - 8))));
+  std::vector<uint64_t> aCorrupt = aWords;
+  reinterpret_cast<char *>(aCorrupt.data())[0] = 'X';
+  EXPECT_TRUE(isInvalid(MappedDocument::fromImage(std::string_view{
+      reinterpret_cast<const char *>(aCorrupt.data()), aImage.size()})));
+
+  // Narrow images are served by CompactMappedDocument
+  using Parser3 = DocumentParser<Utf8, Utf8, ErrorWillThrow<>, DocumentParser3>;
+  const auto aCompact = CompactDynamicDocument::parseJson<Parser3>(aJson);
+  std::ostringstream aCompactStream;
+  ASSERT_TRUE(writeBinaryImage(*aCompact, aCompactStream));
+  const std::string aCompactImage = aCompactStream.str();
+  EXPECT_LT(aCompactImage.size(), aImage.size());
+  const std::vector<uint64_t> aCompactWords = toWords(aCompactImage);
+  const auto aFromCompact = CompactMappedDocument::fromImage(
+      std::string_view{reinterpret_cast<const char *>(aCompactWords.data()),
+                       aCompactImage.size()});
+  ASSERT_FALSE(ErrorHandling::isError(aFromCompact));
+  EXPECT_EQ(ErrorHandling::unwrap(aFromCompact)->getRoot(), aDoc->getRoot());
+}
+
+TEST(cjson_basic, arena_document) {
+  /// Counts the blocks that an arena gets from upstream
+  struct CountingResource : std::pmr::memory_resource {
+    size_t itsNumAllocated = 0;
+    size_t itsNumDeallocated = 0;
+
+    void *do_allocate(const size_t theSize, const size_t theAlign) override {
+      ++itsNumAllocated;
+      return std::pmr::new_delete_resource()->allocate(theSize, theAlign);
+    }
+    void do_deallocate(void *thePtr, const size_t theSize,
+                       const size_t theAlign) override {
+      ++itsNumDeallocated;
+      std::pmr::new_delete_resource()->deallocate(thePtr, theSize, theAlign);
+    }
+    bool do_is_equal(const memory_resource &theOther) const noexcept override {
+      return this == &theOther;
+    }
+  };
+  const std::string_view aJson =
+      R"({"a": [1, 0.1, "long string", null], "b": {"c": true, "d": []}})";
+  const auto aExpected = parseJson(aJson);
+  CountingResource aUpstream;
+  std::pmr::monotonic_buffer_resource aArena{64 * 1024, &aUpstream};
+  {
+    // All buffers of a batch of documents are carved from one block
+    std::vector<std::unique_ptr<ArenaDynamicDocument>> aDocs;
+    for (int aIdx = 0; aIdx < 10; ++aIdx) {
+      auto aDoc = ArenaDynamicDocument::parseJson(aJson, aArena);
+      ASSERT_TRUE(aDoc && *aDoc);
+      EXPECT_EQ(&(*aDoc)->getArena(), &aArena);
+      EXPECT_EQ((*aDoc)->getRoot(), aExpected->getRoot());
+      aDocs.push_back(std::move(*aDoc));
+    }
+    EXPECT_EQ(aUpstream.itsNumAllocated, 1u);
+    // Copies stay in the arena of their original
+    const ArenaDynamicDocument aCopy = *aDocs.front();
+    EXPECT_EQ(&aCopy.getArena(), &aArena);
+    EXPECT_EQ(aCopy.getRoot(), aExpected->getRoot());
+
+    using Parser3 =
+        DocumentParser<Utf8, Utf8, ErrorWillReturnNone, DocumentParser3>;
+    const auto aDoc3 = ArenaDynamicDocument::parseJson<Parser3>(aJson, aArena);
+    ASSERT_TRUE(aDoc3 && *aDoc3);
+    EXPECT_EQ((*aDoc3)->getRoot(), aExpected->getRoot());
+    EXPECT_EQ(&(*aDoc3)->getArena(), &aArena);
+  }
+  // Freeing the batch is a single release
+  EXPECT_EQ(aUpstream.itsNumDeallocated, 0u);
+  aArena.release();
+  EXPECT_EQ(aUpstream.itsNumDeallocated, aUpstream.itsNumAllocated);
+
+  // Without an arena, the default resource is used
+  const auto aDefault = ArenaDynamicDocument::parseJson(aJson);
+  ASSERT_TRUE(aDefault && *aDefault);
+  EXPECT_EQ(&(*aDefault)->getArena(), std::pmr::get_default_resource());
+  EXPECT_EQ((*aDefault)->getRoot(), aExpected->getRoot());
+}
+
+TEST(cjson_basic, parse_in_place) {
+  using Parser3 =
+      DocumentParser<Utf8, Utf8, ErrorWillReturnNone, DocumentParser3>;
+  std::string aLarge = "{";
+  for (int aIdx = 0; aIdx < 40; ++aIdx)
+    aLarge += "\"key" + std::to_string(aIdx) + "\": [" +
+              std::to_string(aIdx) + ", \"long value\"], ";
+  aLarge += R"("last": {"x": null}})";
+  const std::string_view aMessages[] = {
+      R"({"id": 1, "tags": ["a", "long tag"], "ok": true})", "[]",
+      "[1, 2,]", aLarge, R"("just a long string")",
+      R"([{"a": {"b": [0.1, -2]}}, "café"])"};
+  const auto checkReuse = [&](auto &theDoc) {
+    using DocTy = std::remove_reference_t<decltype(theDoc)>;
+    typename DocTy::template ParseContext<Parser3> aContext;
+    // Warm up with every message, so that the buffers fit all of them
+    for (const std::string_view aMsg : aMessages) {
+      const auto aResult =
+          theDoc.template parseInPlace<Parser3>(aMsg, aContext);
+      const auto aExpected = DocTy::template parseJson<Parser3>(aMsg);
+      ASSERT_EQ(static_cast<bool>(aResult), static_cast<bool>(aExpected));
+      if (!aResult)
+        continue;
+      EXPECT_EQ(*aResult, &theDoc);
+      EXPECT_EQ(theDoc.getRoot(), (*aExpected)->getRoot());
+    }
+    const size_t aNumAllocations = gNumAllocations;
+    size_t aNumParsed = 0;
+    for (int aRound = 0; aRound < 100; ++aRound)
+      for (const std::string_view aMsg : aMessages)
+        aNumParsed += static_cast<bool>(
+            theDoc.template parseInPlace<Parser3>(aMsg, aContext));
+    EXPECT_EQ(gNumAllocations.load(), aNumAllocations);
+    EXPECT_EQ(aNumParsed, 500u);
+    // The index of the large object is rebuilt, too
+    ASSERT_TRUE(theDoc.template parseInPlace<Parser3>(aLarge, aContext));
+    EXPECT_FALSE(theDoc.itsPropertyIndex.empty());
+    EXPECT_EQ((*(*theDoc.getRoot().toObject()["key39"]).toArray().begin())
+                  .toNumber(),
+              39.);
+  };
+  DynamicDocument aDoc{DocumentInfo{}};
+  checkReuse(aDoc);
+  InterningDynamicDocument aInterning{DocumentInfo{}};
+  checkReuse(aInterning);
+  CompactDynamicDocument aCompact{DocumentInfo{}};
+  checkReuse(aCompact);
+}
+
+TEST(cjson_basic, parse_allocations) {
+  std::string aJson = "[";
+  for (int aIdx = 0; aIdx < 100; ++aIdx)
+    aJson += R"({"id": 0.1, "name": "some longer name", "tags": [1, 2]}, )";
+  aJson += "{}]";
+  // parseJson allocates the document itself and nothing but what the parser
+  // allocates to fill it in
+  const auto countAllocations = [](const auto &theFn) {
+    const size_t aNumBefore = gNumAllocations;
+    theFn();
+    return gNumAllocations - aNumBefore;
+  };
+  using Parser2 = DocumentParser<>;
+  const size_t aNumParser2 = countAllocations([&] {
+    const auto aDocInfo = Parser2::computeDocInfo(aJson);
+    ASSERT_TRUE(aDocInfo);
+    EXPECT_TRUE(Parser2::parseDocument<DynamicDocument>(aJson, *aDocInfo));
+  });
+  EXPECT_EQ(countAllocations([&] {
+              EXPECT_TRUE(DynamicDocument::parseJson<Parser2>(aJson));
+            }),
+            aNumParser2 + 1);
+  using Parser3 =
+      DocumentParser<Utf8, Utf8, ErrorWillReturnNone, DocumentParser3>;
+  const size_t aNumParser3 = countAllocations([&] {
+    EXPECT_TRUE(Parser3::parseDocument<DynamicDocument>(aJson));
+  });
+  EXPECT_EQ(countAllocations([&] {
+              EXPECT_TRUE(DynamicDocument::parseJson<Parser3>(aJson));
+            }),
+            aNumParser3 + 1);
+}
+
+namespace {
+struct UnindexedStorage : public impl::DynamicDocumentStorage {
+  static constexpr bool HAS_PROPERTY_INDEX = false;
+};
+using UnindexedDocument = BasicDynamicDocument<UnindexedStorage>;
+} // namespace
+
+TEST(cjson_basic, structural_hash) {
+  std::string aLarge1 = "{", aLarge2 = "{";
+  for (int aIdx = 0; aIdx < 20; ++aIdx) {
+    aLarge1 += (aIdx ? ", \"k" : "\"k") + std::to_string(aIdx) + "\": [" +
+               std::to_string(aIdx) + "]";
+    aLarge2 += (aIdx ? ", \"k" : "\"k") + std::to_string(19 - aIdx) + "\": [" +
+               std::to_string(19 - aIdx) + "]";
+  }
+  aLarge1 += "}";
+  aLarge2 += "}";
+  const std::string aJson1 = R"([{"a": 1, "b": {"c": [true, null]}},
+                                 {"a": 1, "a": 2}, 0, )" +
+                             aLarge1 + "]";
+  const auto aDoc1 = parseJson(aJson1);
+  const auto aDoc2 = parseJson(R"([{"b": {"c": [true, null]}, "a": 1},
+                                   {"a": 1, "a": 2}, -0, )" +
+                               aLarge2 + "]");
+  const auto aDoc3 = parseJson(R"([{"a": 1, "b": {"c": [null, true]}},
+                                   {"a": 2, "a": 1}, 0, )" +
+                               aLarge1 + "]");
+  const auto checkEquality = [&] {
+    const auto aRoot1 = aDoc1->getRoot().toArray();
+    const auto aRoot2 = aDoc2->getRoot().toArray();
+    const auto aRoot3 = aDoc3->getRoot().toArray();
+    // Equal values hash the same regardless of the order of properties
+    for (size_t aIdx = 0; aIdx < aRoot1.size(); ++aIdx) {
+      EXPECT_EQ(aRoot1[aIdx], aRoot2[aIdx]);
+      EXPECT_EQ(aRoot1[aIdx].hash(), aRoot2[aIdx].hash());
+      EXPECT_EQ(aRoot1[aIdx], aRoot1[aIdx]);
+    }
+    EXPECT_EQ(*aDoc1, *aDoc2);
+    // Values of duplicate keys are compared in order
+    EXPECT_NE(aRoot1[0], aRoot3[0]);
+    EXPECT_NE(aRoot1[0].hash(), aRoot3[0].hash());
+    EXPECT_NE(aRoot1[1], aRoot3[1]);
+    EXPECT_NE(aRoot1[2].hash(), aRoot1[3].hash());
+    EXPECT_NE(aRoot1[3], aRoot2[2]);
+    EXPECT_FALSE(*aDoc1 == *aDoc3);
+    // Large objects are compared by sorting their properties
+    std::string aLarge3 = aLarge2;
+    aLarge3.replace(aLarge3.find("[7]"), 3, "[8]");
+    const auto aDoc4 = parseJson(aLarge3);
+    EXPECT_NE(aRoot2[3], aDoc4->getRoot());
+    EXPECT_NE(aRoot2[3].hash(), aDoc4->getRoot().hash());
+    const DocumentInterfaceView<DynamicDocument> aView{*aDoc2};
+    EXPECT_EQ(aRoot1[3], aView.getRoot().toArray()[3]);
+  };
+  checkEquality();
+  const uint64_t aUncached = aDoc1->getRoot().hash();
+  EXPECT_FALSE(aDoc1->findStructuralHash(aDoc1->getRootEntity()));
+  aDoc1->buildStructuralHashes();
+  aDoc2->buildStructuralHashes();
+  aDoc3->buildStructuralHashes();
+  ASSERT_TRUE(aDoc1->findStructuralHash(aDoc1->getRootEntity()));
+  EXPECT_EQ(*aDoc1->findStructuralHash(aDoc1->getRootEntity()), aUncached);
+  EXPECT_EQ(aDoc1->getRoot().hash(), aUncached);
+  checkEquality();
+
+  // Caching hashes does not depend on having a property index
+  const auto aUnindexed =
+      impl::parseDynamicDocument<UnindexedDocument, DocumentParser<>>(
+          aJson1, {}, {});
+  ASSERT_TRUE(aUnindexed);
+  (*aUnindexed)->buildStructuralHashes();
+  const UnindexedDocument &aUnindexedDoc = **aUnindexed;
+  ASSERT_TRUE(aUnindexedDoc.findStructuralHash(aUnindexedDoc.getRootEntity()));
+  EXPECT_EQ(*aUnindexedDoc.findStructuralHash(aUnindexedDoc.getRootEntity()),
+            aUncached);
+}
+
+TEST(cjson_basic, on_demand_document) {
+  const std::string aJson = R"({"id": 12.5, "name": "plain",
+    "esc\"aped": ["line\nbreak", "\u00e4\ud83d\ude00", -0.25e2, true],
+    "nested": {"x": null, "y": [1, 2, 3]}})";
+  auto aResult = OnDemandDocument::parseJson(aJson);
+  ASSERT_TRUE(aResult);
+  const OnDemandDocument &aDoc = **aResult;
+  // Nothing has been decoded or copied but the key with an escape sequence
+  EXPECT_TRUE(aDoc.itsNumbers.empty());
+  EXPECT_EQ(aDoc.itsDecodedNumbers.size(), 5u);
+  for (const double aNumber : aDoc.itsDecodedNumbers)
+    EXPECT_TRUE(std::isnan(aNumber));
+  EXPECT_EQ(aDoc.itsEscapedStrings.size(), 2u);
+  EXPECT_EQ(std::string_view(aDoc.itsChars.data(), aDoc.itsChars.size()),
+            "esc\"aped");
+
+  const auto aRoot = aDoc.getRoot().toObject();
+  EXPECT_EQ((*aRoot["id"]).toNumber(), 12.5);
+  EXPECT_EQ(aDoc.itsDecodedNumbers[0], 12.5);
+  EXPECT_TRUE(std::isnan(aDoc.itsDecodedNumbers[1]));
+  const auto aArray = (*aRoot["esc\"aped"]).toArray();
+  const std::string_view aLineBreak = aArray[0].toString();
+  EXPECT_EQ(aLineBreak, "line\nbreak");
+  EXPECT_EQ(aArray[1].toString(), "\xc3\xa4\xf0\x9f\x98\x80");
+  // Strings stay where they have been decoded to
+  EXPECT_EQ(aArray[0].toString().data(), aLineBreak.data());
+  EXPECT_EQ(aArray[2].toNumber(), -25.);
+  EXPECT_EQ((*aRoot["name"]).toString().data(),
+            aDoc.getSource().data() + aDoc.getSource().find("plain"));
+  // Reads the same as the fully decoded document
+  EXPECT_EQ(aDoc.getRoot(), parseJson(aJson)->getRoot());
+
+  const auto aView = OnDemandDocumentView::parseJson(aJson);
+  ASSERT_TRUE(aView);
+  EXPECT_EQ((*aView)->getSource().data(), aJson.data());
+  EXPECT_EQ((*aView)->getRoot(), aDoc.getRoot());
+
+  // Values which are never read are validated nevertheless
+  for (const char *aInvalid :
+       {"[01]", "[1.]", "[-]", R"(["\x"])", "[\"\x01\"]", R"(["\ud83d"])",
+        "[1 2]", "[nul]"}) {
+    EXPECT_FALSE(OnDemandDocument::parseJson(aInvalid)) << aInvalid;
+  }
+}
+
+TEST(cjson_basic, projection) {
+  const std::string aJson = R"({"id": 1, "name": "first", "items": [
+    {"id": 10, "tags": ["a", "b"], "price": 2.5},
+    {"id": 11, "tags": [], "price": 3.5, "extra": {"deep": [[[]]]}},
+    "not a record"],
+    "meta": {"created": "today", "wei\/rd": [1, 2], "a/b": 3, "~": 4}})";
+  const auto parse = [&](const Projection &theProjection) {
+    auto aDoc = DynamicDocument::parseJsonProjection(aJson, theProjection);
+    return aDoc ? std::move(*aDoc) : nullptr;
+  };
+
+  const auto aIds = parse({"/id", "/items/*/id"});
+  ASSERT_TRUE(aIds);
+  EXPECT_EQ(*aIds, *parseJson(R"({"id": 1,
+    "items": [{"id": 10}, {"id": 11}, null]})"));
+  // Nothing of the skipped values ends up in the document
+  EXPECT_EQ(aIds->itsChars.size(), std::string_view{"iditemsidid"}.size());
+
+  // Specific tokens also get what "*" selects, array indices are kept
+  const auto aMixed = parse({"/items/*/id", "/items/1/tags", "/items/5"});
+  ASSERT_TRUE(aMixed);
+  EXPECT_EQ(*aMixed, *parseJson(R"({"items": [{"id": 10},
+                                 {"id": 11, "tags": []}, null]})"));
+
+  // Whole subtrees, escaped keys and pointers
+  const auto aMeta = parse({"/meta/wei~1rd", "/meta/a~1b", "/meta/~0",
+                            "/items/0/tags/1", "/name/ignored"});
+  ASSERT_TRUE(aMeta);
+  EXPECT_EQ(*aMeta, *parseJson(R"({"items": [{"tags": [null, "b"]}, null, null],
+    "meta": {"wei/rd": [1, 2], "a/b": 3, "~": 4}})"));
+  EXPECT_EQ(*parse({""}), *parseJson(aJson));
+  EXPECT_EQ(*parse({}), *parseJson("{}"));
+  EXPECT_EQ(**DynamicDocument::parseJsonProjection("[1]", {}),
+            *parseJson("[null]"));
+  EXPECT_EQ(**DynamicDocument::parseJsonProjection("42", {}),
+            *parseJson("42"));
+
+  Projection aProjection;
+  EXPECT_TRUE(aProjection.add("/a"));
+  EXPECT_FALSE(aProjection.add("a"));
+  EXPECT_FALSE(aProjection.add("/a~2"));
+
+  // Selected values are validated, skipped ones only for their brackets
+  EXPECT_TRUE(DynamicDocument::parseJsonProjection(R"({"a": 1, "b": [01]})",
+                                                   aProjection));
+  for (const char *aInvalid :
+       {R"({"a": 01})", R"({"a": 1, "b": [}})", R"({"a": 1, "b": 2 3})",
+        R"({"a": 1} 2)", R"({"b": {"c": [}, "a": 1})", R"({"a": 1)"}) {
+    EXPECT_FALSE(DynamicDocument::parseJsonProjection(aInvalid, aProjection))
+        << aInvalid;
+  }
+}
+
+TEST(cjson_basic, extract) {
+  const std::string aJson = R"({"id": 7, "records": [
+    {"name": "a long name", "tags": ["x", "y"], "price": 0.1},
+    {"name": "b", "tags": [], "nested": {"k": [null, true, {"z": 1e300}]}}],
+    "records2": [{"name": "c"}, {"name": "c"}]})";
+  const auto aDoc = parseJson(aJson);
+  const auto aRoot = aDoc->getRoot().toObject();
+  const auto aRecords = *aRoot["records"];
+
+  const auto aCopy = DynamicDocument::extract(aRecords);
+  EXPECT_EQ(aCopy->getRoot(), aRecords);
+  // Only the buffers of the subtree are copied
+  EXPECT_EQ(aCopy->itsObjects.size(), 4u);
+  EXPECT_EQ(aCopy->itsArrays.size(), 4u);
+  const auto aNested = (*(*aCopy->getRoot().toArray()[1].toObject()["nested"])
+                            .toObject()["k"]);
+  EXPECT_EQ(DynamicDocument::extract(aNested)->getRoot(), aNested);
+  EXPECT_EQ(DynamicDocument::extract(aRoot["id"].value())->getRoot().toNumber(),
+            7.);
+  EXPECT_EQ(*DynamicDocument::extract(aDoc->getRoot()), *aDoc);
+
+  // Between documents of different types
+  const auto aInterned = InterningDynamicDocument::extract(aDoc->getRoot());
+  EXPECT_EQ(aInterned->getRoot(), aDoc->getRoot());
+  EXPECT_LT(aInterned->itsStrings.size(), aDoc->itsStrings.size());
+  const auto aCompact = CompactDynamicDocument::extract(aRecords);
+  EXPECT_EQ(aCompact->getRoot(), aRecords);
+  const auto aOnDemand = OnDemandDocument::parseJson(aJson);
+  ASSERT_TRUE(aOnDemand);
+  EXPECT_EQ(DynamicDocument::extract((*aOnDemand)->getRoot())->getRoot(),
+            aDoc->getRoot());
+  const DocumentInterfaceView<DynamicDocument> aErased{*aDoc};
+  const DocumentInterface &aInterface = aErased;
+  EXPECT_EQ(DynamicDocument::extract(aInterface.getRoot())->getRoot(),
+            aDoc->getRoot());
+  static constexpr std::string_view aStaticJson{R"({"a": [1, "two", [3]]})"};
+  static constexpr auto aStaticInfo =
+      DocumentParser<>::computeDocInfo(aStaticJson);
+  using StaticDocTy = CJSON_STATIC_DOCTY(*aStaticInfo);
+  static constexpr auto aStatic =
+      DocumentParser<>::parseDocument<StaticDocTy>(aStaticJson, aStaticInfo);
+  EXPECT_EQ(DynamicDocument::extract(aStatic->getRoot())->getRoot(),
+            parseJson(aStaticJson)->getRoot());
+
+  // Copying does not recurse
+  const std::string aDeep =
+      std::string(100000, '[') + "{}" + std::string(100000, ']');
+  const auto aDeepCopy = DynamicDocument::extract(parseJson(aDeep)->getRoot());
+  EXPECT_EQ(aDeepCopy->itsArrays.size(), 100000u);
+  auto aInner = aDeepCopy->getRoot();
+  while (aInner.getType() == Entity::ARRAY)
+    aInner = aInner.toArray()[0];
+  EXPECT_EQ(aInner.getType(), Entity::OBJECT);
+
+  // DocumentAllocator used to write every array element to the same slot
+  const auto aAllocated = std::make_unique<DynamicDocument>(
+      DocumentInfo::read(aDoc->getRoot()));
+  DocumentAllocator<DynamicDocument, ErrorWillReturnNone> aAlloc;
+  aAllocated->itsEntities[0] =
+      aAlloc.allocateJson(*aAllocated, aDoc->getRoot());
+  EXPECT_EQ(*aAllocated, *aDoc);
+}
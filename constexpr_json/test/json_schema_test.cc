@@ -1,12 +1,14 @@
 
 #include "constexpr_json/document_parser.h"
 #include "constexpr_json/dynamic_document.h"
+#include "constexpr_json/ext/macros.h"
 #include "constexpr_json/ext/printing.h"
 #include "constexpr_json/impl/document_parser1.h"
 #include "constexpr_json/impl/document_parser2.h"
 #include "constexpr_json/static_document.h"
 
 #include <cassert>
+#include <cstring>
 #include <iostream>
 #include <variant>
 
@@ -122,10 +124,36 @@ int main() {
               << DocumentInterfaceImpl<DocTy>{ErrorHandling::unwrap(aDoc)}
               << "\n";
   }
+  { // Test loading the image written by json_to_header at build time
+    using Parser = DocumentParser<Utf8, Utf8, ErrorHandling>;
+    constexpr auto aDoc = Parser::parseDocument<DocTy>(aJsonSV, aDocInfo);
+#define USE_JSON_IMAGE(...) LOAD_STATIC_JSON_IMAGE(aImage, __VA_ARGS__);
+#include "json_schema.image.h"
+    static_assert(std::is_same_v<std::decay_t<decltype(*aImage)>, DocTy>);
+    static_assert(DocumentInfo::read(aImage->getRoot()) == aDocInfo);
+    assert(aImage->getRoot() == aDoc->getRoot());
+  }
+  { // Numbers of images are bit-exact, including the sign of zero
+    const auto aDoc = DynamicDocument::parseJson<>(
+        "[-0, -0.0, 0, 1, -7, 2.5e-3, 1e300, -1e-300]");
+#define USE_JSON_IMAGE(...) LOAD_STATIC_JSON_IMAGE(aImage, __VA_ARGS__);
+#include "image_numbers.image.h"
+    const auto aNumbers = aImage->getRoot().toArray();
+    const auto aExpected = (*aDoc)->getRoot().toArray();
+    assert(aNumbers.size() == aExpected.size());
+    for (size_t aIdx = 0; aIdx < aNumbers.size(); ++aIdx) {
+      const double aNumber = aNumbers[aIdx].toNumber();
+      const double aExpectedNumber = aExpected[aIdx].toNumber();
+      assert(std::memcmp(&aNumber, &aExpectedNumber, sizeof(double)) == 0);
+    }
+  }
   { // Test default DocumentParser with DynamicDocument (parsing at runtime)
     using Parser = DocumentParser<Utf8, Utf8, ErrorHandling>;
     const auto aDoc = Parser::parseDocument<DynamicDocument>(aJsonSV, aDocInfo);
     assert(!ErrorHandling::isError(aDoc));
-    std::cout << "\n" << ErrorHandling::unwrap(aDoc) << "\n";
+    std::cout << "\n"
+              << DocumentInterfaceView<DynamicDocument>{
+                     ErrorHandling::unwrap(aDoc)}
+              << "\n";
   }
 }
@@ -2,6 +2,7 @@
 #include "constexpr_json/ext/base64.h"
 #include "constexpr_json/ext/error_is_detail.h"
 #include "constexpr_json/impl/document_parser1.h"
+#include "constexpr_json/impl/document_parser3.h"
 #include "constexpr_json/static_document.h"
 
 #include <cmath>
@@ -139,10 +140,27 @@ static void test_parseutils() {
   CHECK_PARSE(parseNumber, "1234", 4, 1234.);
   CHECK_PARSE(parseNumber, "-1", 2, -1.);
   CHECK_PARSE(parseNumber, "-1.2", 4, -1.2);
-  CHECK_PARSE(parseNumber, "-1.0e3", 6, -100.);
+  CHECK_PARSE(parseNumber, "-1.0e3", 6, -1000.);
   CHECK_PARSE(parseNumber, "-1.0e-3", 7, -0.001);
   CHECK_PARSE(parseNumber, "-1.0e-03", 8, -0.001);
   CHECK_PARSE(parseNumber, "2]", 1, 2.);
+  CHECK_PARSE(parseNumber, "1.5e1", 5, 15.);
+  CHECK_PARSE(parseNumber, "0.1", 3, 0.1);
+  CHECK_PARSE(parseNumber, "1e", -1, 0.);
+  CHECK_PARSE(parseNumber, "4294967296", 10, 4294967296.);
+  CHECK_PARSE(parseNumber, "18446744073709551615", 20, 18446744073709551615.);
+  CHECK_PARSE(parseNumber, "9007199254740993", 16, 9007199254740992.);
+  CHECK_PARSE(parseNumber, "9007199254740993.0000000000000000001", 36,
+              9007199254740994.);
+  CHECK_PARSE(parseNumber, "2.2250738585072011e-308", 23,
+              2.2250738585072011e-308);
+  CHECK_PARSE(parseNumber, "4.9406564584124654e-324", 23,
+              4.9406564584124654e-324);
+  CHECK_PARSE(parseNumber, "1e-400", 6, 0.);
+  CHECK_PARSE(parseNumber, "-1e400", 6,
+              -std::numeric_limits<double>::infinity());
+  CHECK_PARSE(parseNumber, "1e99999999999999999999", 22,
+              std::numeric_limits<double>::infinity());
 
   CHECK_PARSE(parseEscape, "\\u0001", 6, 1);
   CHECK_PARSE(parseEscape, "\\u000f", 6, 15);
@@ -279,9 +297,43 @@ static void test_parsing() {
     constexpr bool aIsDef = std::string_view{aDefBuf.data(), aDefSize} == "ghi";
     static_assert(aIsDef);
   }
+  {
+    // Keys are looked up in sorted order, but duplicates still resolve to
+    // the first property like a linear search does
+    constexpr std::string_view aJsonStr{
+        R"({"m": 1, "b": 2, "x": {}, "a": 3, "b": 4, "": 5, "z": 6})"};
+    constexpr auto aDocInfoOrError = Parser::computeDocInfo(aJsonStr);
+    using ErrorHandling = typename Parser::error_handling;
+    static_assert(!ErrorHandling::isError(aDocInfoOrError));
+    constexpr DocumentInfo aDocInfo{ErrorHandling::unwrap(aDocInfoOrError)};
+    using DocTy = CJSON_STATIC_DOCTY(aDocInfo);
+    constexpr auto aDocOrError =
+        Parser::template parseDocument<DocTy>(aJsonStr, aDocInfo);
+    static_assert(!ErrorHandling::isError(aDocOrError));
+    constexpr const DocTy aDoc = ErrorHandling::unwrap(aDocOrError);
+    static_assert((*aDoc.getRoot().toObject()["m"]).toNumber() == 1.);
+    static_assert((*aDoc.getRoot().toObject()["b"]).toNumber() == 2.);
+    static_assert((*aDoc.getRoot().toObject()["a"]).toNumber() == 3.);
+    static_assert((*aDoc.getRoot().toObject()[""]).toNumber() == 5.);
+    static_assert((*aDoc.getRoot().toObject()["z"]).toNumber() == 6.);
+    static_assert(!aDoc.getRoot().toObject()["c"]);
+    static_assert(!aDoc.getRoot().toObject()["zz"]);
+    static_assert(!aDoc.getRoot().toObject()[" "]);
+    static_assert((*aDoc.getRoot().toObject()["x"]).toObject().size() == 0);
+    static_assert(!(*aDoc.getRoot().toObject()["x"]).toObject()["a"]);
+  }
 #undef CHECK_DOCPARSE
 }
 
+static void test_index_width() {
+  // Small static documents use 32 bit indices
+  using DocTy = CJSON_STATIC_DOCTY(DocumentInfo{});
+  static_assert(std::is_same_v<DocTy::Indices, NarrowIndices>);
+  static_assert(sizeof(DocTy::Object) == 12);
+  static_assert(!NarrowIndices::fits(intptr_t{1} << 31));
+  static_assert(NarrowIndices::fits((intptr_t{1} << 31) - 1));
+}
+
 int main() {
   test_base64();
   test_utf8();
@@ -291,6 +343,8 @@ int main() {
   using ErrorHandling = ErrorWillReturnNone;
   test_parsing<DocumentParser<Utf8, Utf8, ErrorHandling, DocumentParser1>>();
   test_parsing<DocumentParser<Utf8, Utf8, ErrorHandling, DocumentParser2>>();
+  test_parsing<DocumentParser<Utf8, Utf8, ErrorHandling, DocumentParser3>>();
   test_parsing();
+  test_index_width();
   return 0;
 }
@@ -0,0 +1,61 @@
+#ifndef CONSTEXPR_JSON_TOOLS_BENCH_INPUT_H
+#define CONSTEXPR_JSON_TOOLS_BENCH_INPUT_H
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "cli_args/cli_args.h"
+
+/// Options and input shared by the benchmark tools
+
+static ::cli_args::opt<std::string> gInput(
+    ::cli_args::name("f"), ::cli_args::name("file"),
+    ::cli_args::desc("File to be parsed. A synthetic document is generated "
+                     "if none is given"),
+    ::cli_args::init(""));
+
+static ::cli_args::opt<unsigned> gRepetitions(
+    ::cli_args::name("r"), ::cli_args::name("repetitions"),
+    ::cli_args::desc("Parse the document this many times per measurement "
+                     "and report the fastest run"),
+    ::cli_args::init(3));
+
+static ::cli_args::opt<unsigned>
+    gSyntheticSize(::cli_args::name("s"), ::cli_args::name("size"),
+                   ::cli_args::desc("Size of the synthetic document in MiB"),
+                   ::cli_args::init(64));
+
+/// @return an array of small records of roughly theSize bytes
+static std::string generateDocument(const size_t theSize) {
+  std::string aJson = "[";
+  for (size_t aIdx = 0; aJson.size() < theSize; ++aIdx) {
+    if (aIdx)
+      aJson += ",\n";
+    const std::string aId = std::to_string(aIdx);
+    aJson += "{\"id\": " + aId + ", \"name\": \"item \\\"" + aId +
+             "\\\"\", \"price\": " + aId + ".75, \"tags\": [\"a\", \"b\\n\"]," +
+             " \"available\": " + (aIdx % 2 ? "true" : "false") + "}";
+  }
+  aJson += "]";
+  return aJson;
+}
+
+/// Reads the file given by gInput into theJson or generates a synthetic
+/// document of gSyntheticSize MiB if there is none
+/// @return false if the file could not be opened
+static bool loadInput(std::string &theJson) {
+  if (gInput == "") {
+    theJson = generateDocument(size_t{gSyntheticSize} << 20);
+    return true;
+  }
+  std::ifstream aFileIn(gInput, std::ios::binary);
+  if (!aFileIn)
+    return false;
+  std::stringstream aBuffer;
+  aBuffer << aFileIn.rdbuf();
+  theJson = aBuffer.str();
+  return true;
+}
+
+#endif // CONSTEXPR_JSON_TOOLS_BENCH_INPUT_H
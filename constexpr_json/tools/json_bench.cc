@@ -0,0 +1,64 @@
+#include "constexpr_json/dynamic_document.h"
+#include "constexpr_json/impl/document_parser4.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "bench_input.h"
+#include "cli_args/cli_args.h"
+
+namespace cl = ::cli_args;
+
+const char *const TOOLNAME = "json_bench";
+const char *const TOOLDESC =
+    "Measure how parsing a single large document scales with the number of "
+    "threads";
+
+static constexpr int ERROR_INVALID_JSON = 1;
+static constexpr int ERROR_OPEN_FAILED = 11;
+
+static cl::opt<unsigned>
+    gMaxThreads(cl::name("t"), cl::name("threads"),
+                cl::desc("Highest number of threads to measure"),
+                cl::init(32));
+
+int main(int argc, const char **argv) {
+  if (!cl::ParseArgs(argc, argv)) {
+    cl::PrintHelp(TOOLNAME, TOOLDESC, std::cout);
+    return 1;
+  }
+  std::string aJson;
+  if (!loadInput(aJson))
+    return ERROR_OPEN_FAILED;
+
+  using Parser = cjson::DocumentParser<cjson::Utf8, cjson::Utf8,
+                                       cjson::ErrorWillReturnNone,
+                                       cjson::DocumentParser4>;
+  std::cout << "Document size: " << (aJson.size() >> 20) << " MiB\n";
+  double aSingleThreaded = 0.;
+  for (unsigned aNumThreads = 1; aNumThreads <= gMaxThreads;
+       aNumThreads *= 2) {
+    double aFastest = 0.;
+    for (unsigned aRun = 0; aRun < std::max(1u, *gRepetitions); ++aRun) {
+      const auto aStart = std::chrono::steady_clock::now();
+      const auto aDoc = Parser::parseDocument<cjson::DynamicDocument>(
+          aJson, cjson::ParallelOptions{aNumThreads, 0});
+      const std::chrono::duration<double> aDuration =
+          std::chrono::steady_clock::now() - aStart;
+      if (!aDoc) {
+        std::cerr << "Document is invalid\n";
+        return ERROR_INVALID_JSON;
+      }
+      if (!aRun || aDuration.count() < aFastest)
+        aFastest = aDuration.count();
+    }
+    if (aNumThreads == 1)
+      aSingleThreaded = aFastest;
+    std::cout << aNumThreads << " thread(s): " << aFastest << "s, "
+              << (aJson.size() / aFastest / (1 << 20)) << " MiB/s, speedup "
+              << (aSingleThreaded / aFastest) << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,115 @@
+#include "constexpr_json/dynamic_document.h"
+#include "constexpr_json/ext/on_demand_document.h"
+#include "constexpr_json/impl/document_parser3.h"
+#include "constexpr_json/impl/document_parser4.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+#include "bench_input.h"
+#include "cli_args/cli_args.h"
+
+namespace cl = ::cli_args;
+
+const char *const TOOLNAME = "json_parse_bench";
+const char *const TOOLDESC =
+    "Measure time and memory that DynamicDocument::parseJson needs with each "
+    "parser, and OnDemandDocumentView::parseJson for comparison";
+
+static constexpr int ERROR_INVALID_JSON = 1;
+static constexpr int ERROR_OPEN_FAILED = 11;
+
+/// Allocations made since the start of the program, including those of the
+/// worker threads of DocumentParser4
+static std::atomic<size_t> gNumAllocations = 0;
+static std::atomic<size_t> gNumAllocatedBytes = 0;
+
+void *operator new(const size_t theSize) {
+  gNumAllocations.fetch_add(1, std::memory_order_relaxed);
+  gNumAllocatedBytes.fetch_add(theSize, std::memory_order_relaxed);
+  if (void *aPtr = std::malloc(theSize ? theSize : 1))
+    return aPtr;
+  throw std::bad_alloc{};
+}
+void operator delete(void *thePtr) noexcept { std::free(thePtr); }
+void operator delete(void *thePtr, size_t) noexcept { std::free(thePtr); }
+
+/// @return the number of bytes in the buffers of theDoc
+template <typename DocTy>
+static size_t getDocumentBytes(const DocTy &theDoc) {
+  const auto bytes = [](const auto &theBuffer) {
+    return theBuffer.capacity() * sizeof(theBuffer[0]);
+  };
+  size_t aBytes = bytes(theDoc.itsNumbers) + bytes(theDoc.itsChars) +
+                  bytes(theDoc.itsEntities) + bytes(theDoc.itsArrays) +
+                  bytes(theDoc.itsObjects) + bytes(theDoc.itsObjectProps) +
+                  bytes(theDoc.itsStrings) + bytes(theDoc.itsPropertyIndex) +
+                  bytes(theDoc.itsPropertyIndexPos);
+  if constexpr (DocTy::Storage::DECODES_LAZILY)
+    aBytes += bytes(theDoc.itsNumberPositions) +
+              bytes(theDoc.itsDecodedNumbers) +
+              bytes(theDoc.itsEscapedStrings) + bytes(theDoc.itsDecodedChars);
+  return aBytes;
+}
+
+/// Parses theJson into a DocTy with Parser and prints how long it took and how
+/// much memory was allocated compared to the size of the resulting document
+/// @return false if theJson is invalid
+template <typename Parser, typename DocTy = cjson::DynamicDocument>
+static bool measure(const char *const theName, const std::string &theJson) {
+  double aFastest = 0.;
+  size_t aNumAllocations = 0;
+  size_t aNumAllocatedBytes = 0;
+  size_t aDocBytes = 0;
+  for (unsigned aRun = 0; aRun < std::max(1u, *gRepetitions); ++aRun) {
+    const size_t aAllocationsBefore = gNumAllocations;
+    const size_t aBytesBefore = gNumAllocatedBytes;
+    const auto aStart = std::chrono::steady_clock::now();
+    // Worker threads have been joined once parseJson returns
+    const auto aDoc = DocTy::template parseJson<Parser>(theJson);
+    const std::chrono::duration<double> aDuration =
+        std::chrono::steady_clock::now() - aStart;
+    if (!aDoc) {
+      std::cerr << "Document is invalid\n";
+      return false;
+    }
+    aNumAllocations = gNumAllocations - aAllocationsBefore;
+    aNumAllocatedBytes = gNumAllocatedBytes - aBytesBefore;
+    aDocBytes = getDocumentBytes(**aDoc);
+    if (!aRun || aDuration.count() < aFastest)
+      aFastest = aDuration.count();
+  }
+  std::cout << theName << ": " << aFastest << "s, "
+            << (theJson.size() / aFastest / (1 << 20)) << " MiB/s, "
+            << aNumAllocations << " allocations, "
+            << (aNumAllocatedBytes >> 20) << " MiB allocated for a "
+            << (aDocBytes >> 20) << " MiB document\n";
+  return true;
+}
+
+int main(int argc, const char **argv) {
+  if (!cl::ParseArgs(argc, argv)) {
+    cl::PrintHelp(TOOLNAME, TOOLDESC, std::cout);
+    return 1;
+  }
+  std::string aJson;
+  if (!loadInput(aJson))
+    return ERROR_OPEN_FAILED;
+
+  using namespace cjson;
+  std::cout << "Document size: " << (aJson.size() >> 20) << " MiB\n";
+  using Parser3 =
+      DocumentParser<Utf8, Utf8, ErrorWillReturnNone, DocumentParser3>;
+  if (!measure<DocumentParser<>>("DocumentParser2", aJson) ||
+      !measure<Parser3>("DocumentParser3", aJson) ||
+      !measure<DocumentParser<Utf8, Utf8, ErrorWillReturnNone,
+                              DocumentParser4>>("DocumentParser4", aJson) ||
+      !measure<Parser3, OnDemandDocumentView>("OnDemandDocumentView", aJson))
+    return ERROR_INVALID_JSON;
+  return 0;
+}
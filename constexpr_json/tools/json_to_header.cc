@@ -0,0 +1,220 @@
+#include "constexpr_json/document_info.h"
+#include "constexpr_json/dynamic_document.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "cli_args/cli_args.h"
+
+namespace cl = ::cli_args;
+
+const char *const TOOLNAME = "json_to_header";
+const char *const TOOLDESC =
+    "Parse a JSON document and write a header with the buffers of the "
+    "equivalent StaticDocument, to be loaded with LOAD_STATIC_JSON_IMAGE";
+
+static constexpr int ERROR_INVALID_JSON = 1;
+static constexpr int ERROR_OPEN_FAILED = 11;
+static constexpr int ERROR_WRITE_FAILED = 14;
+static constexpr int ERROR_LAYOUT_MISMATCH = 15;
+
+static cl::opt<std::string> gInput(cl::name("f"), cl::name("file"),
+                                   cl::desc("JSON file to be converted"),
+                                   cl::init("-"));
+
+static cl::opt<std::string> gOutput(cl::name("o"), cl::name("output"),
+                                    cl::desc("Header file to be written"),
+                                    cl::init("-"));
+
+/// Lays out documents exactly like StaticDocument, so that their buffers can
+/// be written out as they are. The property index is not part of the image.
+struct ImageStorage : public cjson::impl::DynamicDocumentStorage {
+  static constexpr bool INLINES_SCALARS = false;
+};
+using ImageDocument = cjson::BasicDynamicDocument<ImageStorage>;
+
+/// Maximum width of the lines of the string literal of itsChars
+static constexpr size_t MAX_LITERAL_WIDTH = 76;
+
+/// Writes theBuffer as an initializer of a std::array, with theWrite
+/// printing each element
+template <typename BufferTy, typename WriteFnTy>
+static void writeBuffer(std::ostream &theOS, const BufferTy &theBuffer,
+                        WriteFnTy &&theWrite) {
+  if (theBuffer.empty()) {
+    theOS << "    {}";
+    return;
+  }
+  theOS << "    {{";
+  for (size_t aIdx = 0; aIdx < theBuffer.size(); ++aIdx) {
+    theOS << (aIdx ? ",\n      " : "\n      ");
+    theWrite(theBuffer[aIdx]);
+  }
+  theOS << "\n    }}";
+}
+
+static void writeNumber(std::ostream &theOS, const double theNumber) {
+  if (std::isinf(theNumber)) {
+    theOS << (theNumber < 0 ? "-" : "")
+          << "std::numeric_limits<double>::infinity()";
+    return;
+  }
+  char aBuffer[32];
+  std::snprintf(aBuffer, sizeof(aBuffer), "%.17g", theNumber);
+  theOS << aBuffer;
+  // Integer literals would turn -0.0 into 0.0
+  if (!std::strpbrk(aBuffer, ".e"))
+    theOS << ".0";
+}
+
+/// Writes theChars as a string literal, escaping everything which is not
+/// printable ASCII with octal escape sequences of three digits, so that they
+/// cannot swallow the following characters
+static void writeChars(std::ostream &theOS, const std::vector<char> &theChars) {
+  std::string aLine;
+  theOS << "    \"";
+  for (const char aChar : theChars) {
+    const auto aByte = static_cast<unsigned char>(aChar);
+    if (aByte >= 0x20 && aByte < 0x7f && aChar != '"' && aChar != '\\') {
+      aLine += aChar;
+    } else {
+      char aEscape[5];
+      std::snprintf(aEscape, sizeof(aEscape), "\\%03o", aByte);
+      aLine += aEscape;
+    }
+    if (aLine.size() >= MAX_LITERAL_WIDTH) {
+      theOS << aLine << "\"\n    \"";
+      aLine.clear();
+    }
+  }
+  theOS << aLine << "\"";
+}
+
+static const char *getKindName(const cjson::Entity &theEntity) {
+  using cjson::Entity;
+  switch (theEntity.getKind()) {
+  case Entity::NUL:
+    return "cjson::Entity::NUL";
+  case Entity::ARRAY:
+    return "cjson::Entity::ARRAY";
+  case Entity::BOOL:
+    return "cjson::Entity::BOOL";
+  case Entity::NUMBER:
+    return "cjson::Entity::NUMBER";
+  case Entity::OBJECT:
+    return "cjson::Entity::OBJECT";
+  case Entity::STRING:
+    return "cjson::Entity::STRING";
+  }
+  return "";
+}
+
+static void writeHeader(std::ostream &theOS, const ImageDocument &theDoc,
+                        const cjson::DocumentInfo &theDocInfo) {
+  theOS << "// Generated by " << TOOLNAME << " from " << *gInput
+        << ", do not edit\n"
+        << "#ifndef USE_JSON_IMAGE\n"
+        << "#define USE_JSON_IMAGE(theDocInfo, ...)\n"
+        << "#endif\n"
+        << "USE_JSON_IMAGE(\n"
+        << "    (cjson::DocumentInfo{" << theDocInfo.itsNumNulls << ", "
+        << theDocInfo.itsNumBools << ", " << theDocInfo.itsNumNumbers << ", "
+        << theDocInfo.itsNumChars << ", " << theDocInfo.itsNumStrings << ", "
+        << theDocInfo.itsNumArrays << ", " << theDocInfo.itsNumArrayEntries
+        << ", " << theDocInfo.itsNumObjects << ", "
+        << theDocInfo.itsNumObjectProperties << "}),\n";
+  writeBuffer(theOS, theDoc.itsNumbers,
+              [&](const double theNumber) { writeNumber(theOS, theNumber); });
+  theOS << ",\n";
+  writeChars(theOS, theDoc.itsChars);
+  theOS << ",\n";
+  writeBuffer(theOS, theDoc.itsEntities, [&](const cjson::Entity &theEntity) {
+    theOS << "{" << getKindName(theEntity) << ", " << theEntity.itsPayload
+          << "}";
+  });
+  theOS << ",\n";
+  writeBuffer(theOS, theDoc.itsArrays, [&](const cjson::Array &theArray) {
+    theOS << "{" << theArray.itsPosition << ", " << theArray.itsNumElements
+          << "}";
+  });
+  theOS << ",\n";
+  writeBuffer(theOS, theDoc.itsObjects, [&](const cjson::Object &theObject) {
+    theOS << "{" << theObject.itsKeysPos << ", " << theObject.itsValuesPos
+          << ", " << theObject.itsNumProperties << "}";
+  });
+  theOS << ",\n";
+  writeBuffer(theOS, theDoc.itsObjectProps,
+              [&](const cjson::Property &theProperty) {
+                theOS << "{" << theProperty.itsKeyPos << "}";
+              });
+  theOS << ",\n";
+  writeBuffer(theOS, theDoc.itsStrings, [&](const cjson::String &theString) {
+    theOS << "{" << theString.itsPosition << ", " << theString.itsSize << "}";
+  });
+  theOS << ")\n"
+        << "#undef USE_JSON_IMAGE\n";
+}
+
+int main(int argc, const char **argv) {
+  if (!cl::ParseArgs(argc, argv)) {
+    cl::PrintHelp(TOOLNAME, TOOLDESC, std::cout);
+    return 1;
+  }
+
+  std::stringstream aBuffer;
+  if (gInput == "-") {
+    aBuffer << std::cin.rdbuf();
+  } else {
+    std::ifstream aFileIn(gInput, std::ios::binary);
+    if (!aFileIn) {
+      std::cerr << "Failed to open " << *gInput << "\n";
+      return ERROR_OPEN_FAILED;
+    }
+    aBuffer << aFileIn.rdbuf();
+  }
+  const std::string aJson = aBuffer.str();
+
+  // Parse like LOAD_STATIC_JSON does, only at runtime
+  const auto aDoc = ImageDocument::parseJson<cjson::DocumentParser<>>(aJson);
+  if (!aDoc) {
+    std::cerr << "Failed to parse " << *gInput << "\n";
+    return ERROR_INVALID_JSON;
+  }
+  const ImageDocument &aImage = **aDoc;
+  const cjson::DocumentInfo aDocInfo =
+      cjson::DocumentInfo::read(aImage.getRoot());
+  // The buffers must have exactly the sizes the StaticDocument will have
+  if (static_cast<intptr_t>(aImage.itsNumbers.size()) !=
+          aDocInfo.itsNumNumbers ||
+      static_cast<intptr_t>(aImage.itsChars.size()) != aDocInfo.itsNumChars ||
+      static_cast<intptr_t>(aImage.itsEntities.size()) !=
+          aDocInfo.itsNumArrayEntries + aDocInfo.itsNumObjectProperties + 1 ||
+      static_cast<intptr_t>(aImage.itsArrays.size()) !=
+          aDocInfo.itsNumArrays ||
+      static_cast<intptr_t>(aImage.itsObjects.size()) !=
+          aDocInfo.itsNumObjects ||
+      static_cast<intptr_t>(aImage.itsObjectProps.size()) !=
+          aDocInfo.itsNumObjectProperties ||
+      static_cast<intptr_t>(aImage.itsStrings.size()) !=
+          aDocInfo.itsNumStrings) {
+    std::cerr << "Document layout does not match its DocumentInfo\n";
+    return ERROR_LAYOUT_MISMATCH;
+  }
+
+  if (gOutput == "-") {
+    writeHeader(std::cout, aImage, aDocInfo);
+    return std::cout ? 0 : ERROR_WRITE_FAILED;
+  }
+  std::ofstream aFileOut(gOutput, std::ios::binary);
+  writeHeader(aFileOut, aImage, aDocInfo);
+  if (!aFileOut) {
+    std::cerr << "Failed to write " << *gOutput << "\n";
+    return ERROR_WRITE_FAILED;
+  }
+  return 0;
+}
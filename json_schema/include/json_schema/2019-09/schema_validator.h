@@ -1,11 +1,15 @@
 #ifndef JSON_SCHEMA_SCHEMA_VALIDATOR_H
 #define JSON_SCHEMA_SCHEMA_VALIDATOR_H
 
+#include <algorithm>
 #include <cmath>
 #include <regex>
+#include <utility>
+#include <vector>
 
 #include "constexpr_json/ext/error_is_nullopt.h"
 #include "constexpr_json/ext/utf-8.h"
+#include "constexpr_json/impl/compiler_support.h"
 #include "json_schema/2019-09/model/applicator.h"
 #include "json_schema/2019-09/model/content.h"
 #include "json_schema/2019-09/model/core.h"
@@ -356,15 +360,9 @@ public:
       }
 
       // uniqueItems
-      if (aValidation.getUniqueItems()) {
-        size_t aPos = 0;
-        for (const auto &aElm1 : aJsonArray) {
-          for (size_t aIdx = ++aPos; aIdx < aJsonArray.size(); ++aIdx)
-            if (aElm1 == aJsonArray[aIdx])
-              return makeError(ErrorCode::UNKNOWN,
-                               "Found duplicate item (uniqueItems)");
-        }
-      }
+      if (aValidation.getUniqueItems() && hasDuplicateItems(aJsonArray))
+        return makeError(ErrorCode::UNKNOWN,
+                         "Found duplicate item (uniqueItems)");
 
       if (aValidation.getMaxContains() < aValidation.getMinContains()) {
         return makeError(
@@ -411,6 +409,35 @@ private:
                                   const ErrorDetail &theSubError) const {
     return theSubError;
   }
+  /// At runtime, only items with the same hash are compared with each other
+  template <typename ArrayTy>
+  static constexpr bool hasDuplicateItems(const ArrayTy &theArray) {
+    if (!CJSON_IS_CONSTANT_EVALUATED()) {
+      std::vector<std::pair<uint64_t, size_t>> aHashes;
+      aHashes.reserve(theArray.size());
+      for (size_t aIdx = 0; aIdx < theArray.size(); ++aIdx)
+        aHashes.emplace_back(theArray[aIdx].hash(), aIdx);
+      std::sort(aHashes.begin(), aHashes.end());
+      for (size_t aIdx = 0; aIdx < aHashes.size(); ++aIdx) {
+        const uint64_t aHash = aHashes[aIdx].first;
+        for (size_t aNext = aIdx + 1;
+             aNext < aHashes.size() && aHashes[aNext].first == aHash;
+             ++aNext) {
+          if (theArray[aHashes[aIdx].second] ==
+              theArray[aHashes[aNext].second])
+            return true;
+        }
+      }
+      return false;
+    }
+    size_t aPos = 0;
+    for (const auto &aElm1 : theArray) {
+      for (size_t aIdx = ++aPos; aIdx < theArray.size(); ++aIdx)
+        if (aElm1 == theArray[aIdx])
+          return true;
+    }
+    return false;
+  }
   using DecodeLengthResult = typename ErrorHandling::template ErrorOr<size_t>;
   constexpr DecodeLengthResult
   decodeLength(const std::string_view theStr) const {
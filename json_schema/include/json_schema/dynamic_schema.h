@@ -3,7 +3,6 @@
 
 #include "constexpr_json/dynamic_document.h"
 #include "constexpr_json/ext/error_is_except.h"
-#include "constexpr_json/impl/document_allocator.h"
 #include "json_schema/schema_object.h"
 #include "json_schema/util.h"
 #include <any>
@@ -146,10 +145,7 @@ template <typename Standard_> struct DynamicSchemaContext {
     template <typename JSON>
     JsonRef allocateJson(DynamicSchemaContext &theContext,
                          const JSON &theJson) {
-      cjson::DocumentInfo aDocInfo = cjson::DocumentInfo::read(theJson);
-      auto aJson = std::make_shared<JsonStorage>(aDocInfo);
-      cjson::DocumentAllocator<JsonStorage, ErrorHandling> aAlloc;
-      aJson->itsEntities[0] = aAlloc.allocateJson(*aJson, theJson);
+      std::shared_ptr<JsonStorage> aJson = JsonStorage::extract(theJson);
       JsonRef aJsonRef = *aJson;
       theContext.itsAllocations.emplace_back(std::move(aJson));
       return aJsonRef;
@@ -3,7 +3,7 @@
 #error schema_loading_helper expects argument NAME ()
 #endif
 #if !defined(HEADER)
-#error schema_loading_helper expects argument HEADER (JSON input file)
+#error schema_loading_helper expects argument HEADER (JSON image header)
 #endif
 
 /// Optional Parameters:
@@ -11,9 +11,6 @@
 #define JSON_SCHEMA_STD Standard_2019_09
 #endif
 /// Optional Output Parameters:
-#ifndef JSONNAME
-#define JSONNAME(theName) a##theName##Json
-#endif
 #ifndef DOCNAME
 #define DOCNAME(theName) a##theName##Doc
 #endif
@@ -22,38 +19,31 @@
 #endif
 
 /// Implementation:
-#define _JSONNAME(theName) JSONNAME(theName)
 #define _DOCNAME(theName) DOCNAME(theName)
 #define _INFONAME(theName) INFONAME(theName)
 #define STRINGIFY(Arg) _STRINGIFY(Arg)
 #define _STRINGIFY(Arg) #Arg
 
-// 1. Put the json into a string_view
-#define USE_JSON_STRING(STR)                                                   \
-  constexpr auto _JSONNAME(NAME) = std::string_view{STR};
-#include HEADER
-
-// 2. Load the string_view into a JSON
+// 1. Load the document from the buffers in the header, which
+// generate_json_image_header has parsed at build time
 #include "constexpr_json/ext/macros.h"
-LOAD_STATIC_JSON(_DOCNAME(NAME), _JSONNAME(NAME),
-                 STRINGIFY(NAME) " schema JSON definition");
+#define USE_JSON_IMAGE(...) LOAD_STATIC_JSON_IMAGE(_DOCNAME(NAME), __VA_ARGS__);
+#include HEADER
 
-// 3. Compute the SchemaInfos required for static loading
+// 2. Compute the SchemaInfos required for static loading
 // This is all this helper header does to allow for statically resolvable
 // schema hyperlinks (multiple schemas loaded into same schema context)
 constexpr auto _INFONAME(NAME) = JSON_SCHEMA_STD::SchemaInfoReader<
     std::decay_t<decltype(_DOCNAME(NAME)->getRoot())>,
     cjson::ErrorWillReturnNone>::read(_DOCNAME(NAME)->getRoot());
 
-// 4. Assure successful loading
+// 3. Assure successful loading
 static_assert(_INFONAME(NAME),
               STRINGIFY(NAME) " SchemaInfo computation unsuccessful");
 
 /// Cleanup
 #undef _INFONAME
 #undef INFONAME
-#undef _JSONNAME
-#undef JSONNAME
 #undef _DOCNAME
 #undef DOCNAME
 #undef _STRINGIFY